@@ -96,6 +96,24 @@ curlpp::Multi::fdset(fd_set * read, fd_set * write, fd_set * exc, int * max)
   }
 }
 
+void
+curlpp::Multi::timeout(long * timeout_ms)
+{
+  CURLMcode code = curl_multi_timeout(mMultiHandle, timeout_ms);
+  if(code != CURLM_OK) {
+    throw curlpp::RuntimeError(curl_multi_strerror(code));
+  }
+}
+
+void
+curlpp::Multi::poll(int timeout_ms, int * numfds)
+{
+  CURLMcode code = curl_multi_poll(mMultiHandle, NULL, 0, timeout_ms, numfds);
+  if(code != CURLM_OK) {
+    throw curlpp::RuntimeError(curl_multi_strerror(code));
+  }
+}
+
 curlpp::Multi::Msgs
 curlpp::Multi::info()
 {
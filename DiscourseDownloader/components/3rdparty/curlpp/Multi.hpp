@@ -61,6 +61,8 @@ namespace curlpp
 								fd_set * write_fd_set,
 								fd_set * exc_fd_set,
 								int * max_fd);
+		void timeout(long * timeout_ms);
+		void poll(int timeout_ms, int * numfds);
 
 		typedef std::list<std::pair<const curlpp::Easy *, Multi::Info> >
 			Msgs;
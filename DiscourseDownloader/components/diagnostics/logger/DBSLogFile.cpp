@@ -1,35 +1,101 @@
 #include "logger.h"
 
-#include <fstream>
+#include <chrono>
 
 #include "components/utils/io/io.h"
 
+// The maximum number of messages written to the file at once
+#define LOG_WRITE_BATCH_SIZE 1024
+
 DDLLogFile::DDLLogFile(std::string _filename)
 {
 	filename = _filename;
 
-	if (!DDL::Utils::IO::FileExists(filename))
+	file_stream = std::ofstream(filename, std::ios::out | std::ios::app);
+
+	if (file_stream.fail())
 	{
-		if (!DDL::Utils::IO::CreateNewFile(filename, ""))
-		{
-			DDL::Logger::LogEvent("Could not create new log file!", DDLLogLevel::Error);
-		}
+		// Can't use LogEvent here, as the logger isn't ready yet
+		DDL::Logger::PrintMessageToStdout("Could not open log file '" + filename + "'!", TerminalColor::BrightRed);
 	}
+
+	writer_thread = std::thread(&DDLLogFile::write_queued_messages, this);
 }
 
-DDLResult DDLLogFile::AppendMessageToFile(DDLLogMessage message)
+DDLLogFile::~DDLLogFile()
 {
-	history.push_back(message);
+	running = false;
+	writer_condition.notify_one();
 
-	std::ofstream file = std::ofstream(filename, std::ios::out | std::ios::app);
+	if (writer_thread.joinable())
+	{
+		writer_thread.join();
+	}
 
-	if (file.fail())
+	file_stream.close();
+}
+
+DDLResult DDLLogFile::AppendMessageToFile(DDLLogMessage message)
+{
+	while (!queue.TryPush(&message))
 	{
-		return DDLResult::Error_Generic;
+		// Queue is full, give the writer thread a chance to catch up
+		writer_condition.notify_one();
+		std::this_thread::yield();
 	}
 
-	file << message.GenerateLogLine() << std::endl;
-	file.close();
+	writer_condition.notify_one();
 
 	return DDLResult::Success_OK;
-}
\ No newline at end of file
+}
+
+void DDLLogFile::write_queued_messages()
+{
+	DDLLogMessage message = DDLLogMessage();
+	std::string batch = "";
+
+	while (true)
+	{
+		// Check before draining, so that anything queued before shutdown is still written
+		bool should_exit = !running;
+		int batch_count = 0;
+
+		batch.clear();
+
+		while (batch_count < LOG_WRITE_BATCH_SIZE && queue.TryPop(&message))
+		{
+			std::string log_line = message.GenerateLogLine();
+
+			DDL::Logger::PrintMessageToStdout(log_line, DDL::Logger::TranslateLogLevelAsColor(message.log_level));
+
+			batch += log_line;
+			batch += "\n";
+			batch_count++;
+
+			if (history_limit > 0)
+			{
+				history.push_back(std::move(message));
+
+				while (history.size() > (size_t)history_limit.load())
+				{
+					history.pop_front();
+				}
+			}
+		}
+
+		if (batch_count > 0)
+		{
+			file_stream << batch;
+			file_stream.flush();
+			continue;
+		}
+
+		if (should_exit)
+		{
+			break;
+		}
+
+		std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(writer_mutex);
+		writer_condition.wait_for(lock, std::chrono::milliseconds(50));
+	}
+}
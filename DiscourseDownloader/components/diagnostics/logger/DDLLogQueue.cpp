@@ -0,0 +1,78 @@
+#include "logger.h"
+
+DDLLogQueue::DDLLogQueue(size_t _capacity)
+{
+	capacity = 1;
+
+	while (capacity < _capacity)
+	{
+		capacity *= 2;
+	}
+
+	mask = capacity - 1;
+	slots = new DDLLogQueueSlot[capacity];
+
+	for (size_t i = 0; i < capacity; i++)
+	{
+		slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+}
+
+DDLLogQueue::~DDLLogQueue()
+{
+	delete[] slots;
+}
+
+bool DDLLogQueue::TryPush(DDLLogMessage* message)
+{
+	DDLLogQueueSlot* slot = nullptr;
+	size_t position = enqueue_position.load(std::memory_order_relaxed);
+
+	while (true)
+	{
+		slot = &slots[position & mask];
+
+		size_t sequence = slot->sequence.load(std::memory_order_acquire);
+		intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+		if (difference == 0)
+		{
+			// Slot is free, try to claim it before another producer does
+			if (enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// Slot still holds a message the consumer hasn't read yet, so the queue is full
+			return false;
+		}
+		else
+		{
+			position = enqueue_position.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->message = std::move(*message);
+	slot->sequence.store(position + 1, std::memory_order_release);
+
+	return true;
+}
+
+bool DDLLogQueue::TryPop(DDLLogMessage* message)
+{
+	DDLLogQueueSlot* slot = &slots[dequeue_position & mask];
+
+	if (slot->sequence.load(std::memory_order_acquire) != dequeue_position + 1)
+	{
+		return false;
+	}
+
+	*message = std::move(slot->message);
+	slot->sequence.store(dequeue_position + capacity, std::memory_order_release);
+
+	dequeue_position++;
+
+	return true;
+}
@@ -3,10 +3,18 @@
 #include <iostream>
 
 DDLLogFile* active_log = nullptr;
+std::once_flag logger_init_flag;
+
+std::atomic<DDLLogLevel> minimum_log_level = DDLLogLevel::Info;
+std::atomic<int> log_history_limit = 0;
 
 void DDL::Logger::StartLogger()
 {
-	active_log = new DDLLogFile("discoursedl.log");
+	std::call_once(logger_init_flag, []()
+	{
+		active_log = new DDLLogFile("discoursedl.log");
+		active_log->history_limit = log_history_limit.load();
+	});
 }
 
 void DDL::Logger::ShutdownLogger()
@@ -14,6 +22,27 @@ void DDL::Logger::ShutdownLogger()
 	if (active_log)
 	{
 		delete active_log;
+		active_log = nullptr;
+	}
+}
+
+void DDL::Logger::SetMinimumLogLevel(DDLLogLevel log_level)
+{
+	minimum_log_level = log_level;
+}
+
+bool DDL::Logger::IsLogLevelEnabled(DDLLogLevel log_level)
+{
+	return log_level >= minimum_log_level.load(std::memory_order_relaxed);
+}
+
+void DDL::Logger::SetHistoryLimit(int history_limit)
+{
+	log_history_limit = history_limit;
+
+	if (active_log)
+	{
+		active_log->history_limit = history_limit;
 	}
 }
 
@@ -24,10 +53,15 @@ void DDL::Logger::LogEvent(std::string message)
 
 void DDL::Logger::LogEvent(std::string message, DDLLogLevel log_level)
 {
+	if (!IsLogLevelEnabled(log_level))
+	{
+		return;
+	}
+
 	DDLLogMessage log_message =
 	{
 		DDL::Logger::Utils::GetCurrentTimestamp(),
-		message,
+		std::move(message),
 		log_level
 	};
 
@@ -36,24 +70,12 @@ void DDL::Logger::LogEvent(std::string message, DDLLogLevel log_level)
 		DDL::Logger::StartLogger();
 	}
 
-	active_log->AppendMessageToFile(log_message);
-
-	std::string formatted_log_message = log_message.GenerateLogLine();
-
-	if (log_level == DDLLogLevel::Info)
-	{
-		DDL::Logger::PrintMessageToStdout(formatted_log_message, TerminalColor::Reset);
-	}
-	else if (log_level == DDLLogLevel::Warning)
-	{
-		DDL::Logger::PrintMessageToStdout(formatted_log_message, TerminalColor::Yellow);
-	}
-	else if (log_level == DDLLogLevel::Error)
-	{
-		DDL::Logger::PrintMessageToStdout(formatted_log_message, TerminalColor::BrightRed);
-	}
-	else
+	// Shutdown has already happened, there's nowhere left to write to
+	if (!active_log)
 	{
-		DDL::Logger::PrintMessageToStdout(formatted_log_message, TerminalColor::Reset);
+		DDL::Logger::PrintMessageToStdout(log_message.GenerateLogLine(), TranslateLogLevelAsColor(log_level));
+		return;
 	}
-}
\ No newline at end of file
+
+	active_log->AppendMessageToFile(std::move(log_message));
+}
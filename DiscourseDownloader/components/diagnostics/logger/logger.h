@@ -1,7 +1,12 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
 
 #include "components/diagnostics/errors/errors.h"
 
@@ -61,28 +66,107 @@ public:
 	std::string GenerateLogLine();
 };
 
+/**
+* Structure representing a single slot in a DDLLogQueue.
+*/
+struct DDLLogQueueSlot
+{
+	std::atomic<size_t> sequence = 0; //!< Used to determine whether the slot is ready to be written to or read from.
+	DDLLogMessage message = DDLLogMessage(); //!< The message stored in this slot.
+};
+
+/**
+* Class representing a bounded, lock-free queue of log messages.
+*
+* Any number of threads may push messages, but only a single thread may pop them. Each slot carries a sequence
+* number, which tells producers whether the slot is free and tells the consumer whether it has been filled, so
+* neither side ever needs to take a lock.
+*/
+class DDLLogQueue
+{
+private:
+	DDLLogQueueSlot* slots = nullptr; //!< The ring buffer of message slots.
+	size_t capacity = 0; //!< The number of slots. Always a power of two.
+	size_t mask = 0;     //!< Mask used to wrap a position into the ring buffer.
+
+	alignas(64) std::atomic<size_t> enqueue_position = 0; //!< The next position to be claimed by a producer.
+	alignas(64) size_t dequeue_position = 0; //!< The next position to be read by the consumer.
+
+public:
+	/**
+	* Creates a new log queue.
+	*
+	* @param _capacity - The number of messages the queue can hold. Rounded up to the next power of two.
+	*/
+	DDLLogQueue(size_t _capacity);
+
+	~DDLLogQueue();
+
+	/**
+	* Attempts to add a message to the queue. Safe to call from any thread.
+	*
+	* @param message - The message to add. Its contents are moved into the queue if successful.
+	*
+	* @returns `true` if the message was added, or `false` if the queue is full.
+	*/
+	bool TryPush(DDLLogMessage* message);
+
+	/**
+	* Attempts to remove the oldest message from the queue. Must only be called from the consumer thread.
+	*
+	* @param message - Pointer to a message, which the removed message will be moved into.
+	*
+	* @returns `true` if a message was removed, or `false` if the queue is empty.
+	*/
+	bool TryPop(DDLLogMessage* message);
+};
+
 /**
 * Class representing a log file.
+*
+* Messages are handed to a background thread through a DDLLogQueue, which writes them to the console and to the
+* log file in batches. The log file is kept open for the lifetime of this object, rather than being reopened for
+* every message.
 */
 class DDLLogFile
 {
+private:
+	DDLLogQueue queue = DDLLogQueue(8192); //!< Messages waiting to be written.
+	std::ofstream file_stream; //!< Output stream for the log file.
+	std::thread writer_thread; //!< Background thread which writes queued messages.
+	std::atomic<bool> running = true; //!< Whether or not the writer thread should keep running.
+	std::mutex writer_mutex; //!< Mutex used to wait on writer_condition.
+	std::condition_variable writer_condition; //!< Used to wake the writer thread when new messages are queued.
+
+	/**
+	* Writes queued messages until the log file is closed. Runs on the writer thread.
+	*/
+	void write_queued_messages();
+
 public:
-	std::vector<DDLLogMessage> history = std::vector<DDLLogMessage>(); //!< The complete log history of this file.
+	std::deque<DDLLogMessage> history = std::deque<DDLLogMessage>(); //!< The most recent messages written to this file. Only accessed by the writer thread.
+	std::atomic<int> history_limit = 0; //!< The maximum number of messages to keep in #history. If 0, no history is kept.
 	std::string filename = ""; //!< The filename/path of this log file.
 
 	/**
-	* Prepares a new log file.
+	* Prepares a new log file, and starts its writer thread.
 	* 
 	* @param _filename - The filename/path of the new log file.
 	*/
 	DDLLogFile(std::string _filename);
 
 	/**
-	* Adds a new message to this log file.
+	* Writes any remaining messages, then stops the writer thread and closes the file.
+	*/
+	~DDLLogFile();
+
+	/**
+	* Queues a new message to be written to this log file. If the queue is full, this will wait until the writer
+	* thread has made room for it.
 	* 
 	* @param message - The message to append to the file.
 	* 
-	* @returns `Success_OK` if the message was appended successfully, otherwise returns an error code.
+	* @returns `Success_OK` if the message was queued successfully, otherwise returns an error code.
 	*/
 	DDLResult AppendMessageToFile(DDLLogMessage message);
 };
@@ -114,6 +198,15 @@ namespace DDL::Logger
 		* @returns A string containing the current log timestamp.
 		*/
 		std::string GetCurrentTimestamp();
+
+		/**
+		* Parses a log level name, as used in website.cfg.
+		*
+		* @param log_level - The name of the log level - either `info`, `warning` or `error`.
+		*
+		* @returns The matching log level. If the name is not recognized, `Info` is returned.
+		*/
+		DDLLogLevel ParseLogLevel(std::string log_level);
 	}
 
 	/**
@@ -126,6 +219,31 @@ namespace DDL::Logger
 	*/
 	void ShutdownLogger();
 
+	/**
+	* Sets the lowest log level which will be logged. Messages below this level are discarded before they are
+	* timestamped or queued.
+	*
+	* @param log_level - The minimum log level.
+	*/
+	void SetMinimumLogLevel(DDLLogLevel log_level);
+
+	/**
+	* Checks whether messages of a given log level will be logged. Can be used to skip building expensive
+	* messages which would be discarded anyway.
+	*
+	* @param log_level - The log level to check.
+	*
+	* @returns `true` if messages of this log level are logged, otherwise returns `false`.
+	*/
+	bool IsLogLevelEnabled(DDLLogLevel log_level);
+
+	/**
+	* Sets the maximum number of messages kept in the log history.
+	*
+	* @param history_limit - The maximum number of messages. If 0, no history is kept.
+	*/
+	void SetHistoryLimit(int history_limit);
+
 	/**
 	* Logs a new message, with the `Info` log level.
 	* 
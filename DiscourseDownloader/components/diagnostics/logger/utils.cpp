@@ -37,6 +37,22 @@ std::string DDL::Logger::Utils::GenerateLogLevelPrefix(DDLLogLevel log_level)
 	return format;
 }
 
+DDLLogLevel DDL::Logger::Utils::ParseLogLevel(std::string log_level)
+{
+	std::string level_name = DDL::Utils::String::ToLower(log_level);
+
+	if (level_name == "warning" || level_name == "warn")
+	{
+		return DDLLogLevel::Warning;
+	}
+	else if (level_name == "error")
+	{
+		return DDLLogLevel::Error;
+	}
+
+	return DDLLogLevel::Info;
+}
+
 TerminalColor DDL::Logger::TranslateLogLevelAsColor(DDLLogLevel log_level)
 {
 	if (log_level == DDLLogLevel::Warning)
@@ -0,0 +1,35 @@
+#include "metrics.h"
+
+void DDLMetric::append_sample(std::string* output, std::string_view name, std::string_view labels, double value)
+{
+	char value_text[32] = { 0 };
+	sprintf_s(value_text, sizeof(value_text), "%.15g", value);
+
+	output->append(name);
+
+	if (labels.length() > 0)
+	{
+		output->append("{");
+		output->append(labels);
+		output->append("}");
+	}
+
+	output->append(" ");
+	output->append(value_text);
+	output->append("\n");
+}
+
+void DDLMetricCounter::Increment(int64_t amount)
+{
+	value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+int64_t DDLMetricCounter::GetValue()
+{
+	return value.load(std::memory_order_relaxed);
+}
+
+void DDLMetricCounter::Format(std::string* output, std::string_view name, std::string_view labels)
+{
+	append_sample(output, name, labels, (double)GetValue());
+}
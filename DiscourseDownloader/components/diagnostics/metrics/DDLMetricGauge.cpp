@@ -0,0 +1,21 @@
+#include "metrics.h"
+
+void DDLMetricGauge::Set(double _value)
+{
+	value.store(_value, std::memory_order_relaxed);
+}
+
+void DDLMetricGauge::Add(double amount)
+{
+	value.fetch_add(amount, std::memory_order_relaxed);
+}
+
+double DDLMetricGauge::GetValue()
+{
+	return value.load(std::memory_order_relaxed);
+}
+
+void DDLMetricGauge::Format(std::string* output, std::string_view name, std::string_view labels)
+{
+	append_sample(output, name, labels, GetValue());
+}
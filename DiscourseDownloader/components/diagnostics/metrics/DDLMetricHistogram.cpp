@@ -0,0 +1,99 @@
+#include "metrics.h"
+
+#include <bit>
+#include <cmath>
+
+int DDLMetricHistogram::get_bucket_index(uint64_t value_us)
+{
+	// Small values get a bucket each, as there is nothing to split them into
+	if (value_us < METRICS_HISTOGRAM_SUB_BUCKET_COUNT)
+	{
+		return (int)value_us;
+	}
+
+	int exponent = std::bit_width(value_us) - 1;
+
+	if (exponent > METRICS_HISTOGRAM_MAX_EXPONENT)
+	{
+		return METRICS_HISTOGRAM_BUCKET_COUNT - 1;
+	}
+
+	int sub_bucket = (int)((value_us >> (exponent - METRICS_HISTOGRAM_SUB_BUCKET_BITS)) & (METRICS_HISTOGRAM_SUB_BUCKET_COUNT - 1));
+	return (exponent - METRICS_HISTOGRAM_SUB_BUCKET_BITS + 1) * METRICS_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket;
+}
+
+uint64_t DDLMetricHistogram::get_bucket_value(int index)
+{
+	if (index < METRICS_HISTOGRAM_SUB_BUCKET_COUNT)
+	{
+		return index;
+	}
+
+	int exponent = index / METRICS_HISTOGRAM_SUB_BUCKET_COUNT + METRICS_HISTOGRAM_SUB_BUCKET_BITS - 1;
+	int sub_bucket = index % METRICS_HISTOGRAM_SUB_BUCKET_COUNT;
+
+	uint64_t bucket_width = 1ull << (exponent - METRICS_HISTOGRAM_SUB_BUCKET_BITS);
+	uint64_t bucket_start = (uint64_t)(METRICS_HISTOGRAM_SUB_BUCKET_COUNT + sub_bucket) * bucket_width;
+
+	return bucket_start + bucket_width / 2;
+}
+
+void DDLMetricHistogram::Record(double seconds)
+{
+	uint64_t value_us = (seconds > 0) ? (uint64_t)(seconds * 1000000.0) : 0;
+
+	buckets[get_bucket_index(value_us)].fetch_add(1, std::memory_order_relaxed);
+	count.fetch_add(1, std::memory_order_relaxed);
+	sum_us.fetch_add(value_us, std::memory_order_relaxed);
+}
+
+double DDLMetricHistogram::GetQuantile(double quantile)
+{
+	uint64_t total = count.load(std::memory_order_relaxed);
+
+	if (total == 0)
+	{
+		return 0.0;
+	}
+
+	uint64_t target = (uint64_t)std::ceil(quantile * total);
+
+	if (target == 0)
+	{
+		target = 1;
+	}
+
+	uint64_t seen = 0;
+
+	for (int i = 0; i < METRICS_HISTOGRAM_BUCKET_COUNT; i++)
+	{
+		seen += buckets[i].load(std::memory_order_relaxed);
+
+		if (seen >= target)
+		{
+			return get_bucket_value(i) / 1000000.0;
+		}
+	}
+
+	// Only reachable if a duration is recorded while the buckets are being read
+	return get_bucket_value(METRICS_HISTOGRAM_BUCKET_COUNT - 1) / 1000000.0;
+}
+
+uint64_t DDLMetricHistogram::GetCount()
+{
+	return count.load(std::memory_order_relaxed);
+}
+
+void DDLMetricHistogram::Format(std::string* output, std::string_view name, std::string_view labels)
+{
+	const char* quantiles[] = { "0.5", "0.9", "0.99", "0.999" };
+
+	for (const char* quantile : quantiles)
+	{
+		std::string quantile_labels = std::string(labels) + (labels.length() > 0 ? "," : "") + "quantile=\"" + quantile + "\"";
+		append_sample(output, name, quantile_labels, GetQuantile(atof(quantile)));
+	}
+
+	append_sample(output, std::string(name) + "_sum", labels, sum_us.load(std::memory_order_relaxed) / 1000000.0);
+	append_sample(output, std::string(name) + "_count", labels, (double)GetCount());
+}
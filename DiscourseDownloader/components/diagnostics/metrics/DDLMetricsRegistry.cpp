@@ -0,0 +1,59 @@
+#include "metrics.h"
+
+template <typename T>
+T* DDLMetricsRegistry::get_metric(std::string name, std::string help, std::string type, std::string labels)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(registry_mutex);
+
+	metric_family& family = families[name];
+
+	if (family.type == "")
+	{
+		family.help = help;
+		family.type = type;
+	}
+
+	std::unique_ptr<DDLMetric>& metric = family.metrics[labels];
+
+	if (!metric)
+	{
+		metric = std::make_unique<T>();
+	}
+
+	return (T*)metric.get();
+}
+
+DDLMetricCounter* DDLMetricsRegistry::GetCounter(std::string name, std::string help, std::string labels)
+{
+	return get_metric<DDLMetricCounter>(name, help, "counter", labels);
+}
+
+DDLMetricGauge* DDLMetricsRegistry::GetGauge(std::string name, std::string help, std::string labels)
+{
+	return get_metric<DDLMetricGauge>(name, help, "gauge", labels);
+}
+
+DDLMetricHistogram* DDLMetricsRegistry::GetHistogram(std::string name, std::string help, std::string labels)
+{
+	return get_metric<DDLMetricHistogram>(name, help, "summary", labels);
+}
+
+std::string DDLMetricsRegistry::Format()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(registry_mutex);
+
+	std::string output = "";
+
+	for (std::pair<const std::string, metric_family>& family : families)
+	{
+		output += "# HELP " + family.first + " " + family.second.help + "\n";
+		output += "# TYPE " + family.first + " " + family.second.type + "\n";
+
+		for (std::pair<const std::string, std::unique_ptr<DDLMetric>>& metric : family.second.metrics)
+		{
+			metric.second->Format(&output, family.first, metric.first);
+		}
+	}
+
+	return output;
+}
@@ -0,0 +1,160 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <thread>
+#include <fstream>
+#include <condition_variable>
+#include <filesystem>
+
+#include "components/settings/settings.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/trace/trace.h"
+
+DDLMetricsRegistry metrics_registry;
+
+std::thread export_thread;
+std::mutex export_mutex;
+std::condition_variable export_condition;
+bool export_running = false;
+std::string export_path = "";
+
+DDLMetricCounter* DDL::Metrics::GetCounter(std::string name, std::string help, std::string labels)
+{
+	return metrics_registry.GetCounter(name, help, labels);
+}
+
+DDLMetricGauge* DDL::Metrics::GetGauge(std::string name, std::string help, std::string labels)
+{
+	return metrics_registry.GetGauge(name, help, labels);
+}
+
+DDLMetricHistogram* DDL::Metrics::GetHistogram(std::string name, std::string help, std::string labels)
+{
+	return metrics_registry.GetHistogram(name, help, labels);
+}
+
+std::string DDL::Metrics::FormatLabel(std::string name, std::string value)
+{
+	std::string escaped_value = "";
+	escaped_value.reserve(value.length());
+
+	for (char c : value)
+	{
+		if (c == '\\' || c == '"')
+		{
+			escaped_value += '\\';
+			escaped_value += c;
+		}
+		else if (c == '\n')
+		{
+			escaped_value += "\\n";
+		}
+		else
+		{
+			escaped_value += c;
+		}
+	}
+
+	return name + "=\"" + escaped_value + "\"";
+}
+
+std::chrono::steady_clock::time_point DDL::Metrics::StartPhase(std::string phase)
+{
+	GetGauge("ddl_phase_running", "Whether or not a phase of the application is currently running.", FormatLabel("phase", phase))->Set(1);
+	return std::chrono::steady_clock::now();
+}
+
+void DDL::Metrics::FinishPhase(std::string phase, std::chrono::steady_clock::time_point start_time)
+{
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	GetGauge("ddl_phase_running", "Whether or not a phase of the application is currently running.", FormatLabel("phase", phase))->Set(0);
+	GetGauge("ddl_phase_duration_seconds", "How long a phase of the application took to finish.", FormatLabel("phase", phase))->Set(seconds);
+
+	DDL::Trace::RecordSpan(phase, "phase", start_time);
+}
+
+bool DDL::Metrics::WriteMetricsFile(std::string path)
+{
+	// Lets the scraper tell a stalled crawl apart from a slow one
+	double unix_time = std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+	GetGauge("ddl_metrics_last_write_timestamp_seconds", "The time this file was last written, in seconds since the unix epoch.")->Set(unix_time);
+
+	std::string contents = metrics_registry.Format();
+
+	// Written directly, so that the file doesn't count towards the files written by the crawl
+	{
+		std::ofstream stream = std::ofstream(path + ".tmp", std::ios::binary | std::ios::trunc);
+		stream.write(contents.data(), contents.length());
+
+		if (!stream.good())
+		{
+			return false;
+		}
+	}
+
+	std::error_code rename_error;
+	std::filesystem::rename(path + ".tmp", path, rename_error);
+
+	return !rename_error;
+}
+
+void DDL::Metrics::StartMetricsExport()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config || !config->metrics_enabled)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(export_mutex);
+
+	if (export_running)
+	{
+		return;
+	}
+
+	export_path = config->metrics_textfile_path;
+	export_running = true;
+
+	int flush_interval = std::max(config->metrics_flush_interval, 1);
+
+	GetGauge("ddl_start_time_seconds", "The time the application was started, in seconds since the unix epoch.")
+		->Set(std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count());
+
+	DDL::Logger::LogEvent("writing metrics to '" + export_path + "' every " + std::to_string(flush_interval) + "s");
+
+	export_thread = std::thread([flush_interval]()
+	{
+		std::unique_lock<std::mutex> export_lock = std::unique_lock<std::mutex>(export_mutex);
+
+		while (export_running)
+		{
+			export_condition.wait_for(export_lock, std::chrono::seconds(flush_interval));
+
+			if (!WriteMetricsFile(export_path))
+			{
+				DDL::Logger::LogEvent("could not write metrics to '" + export_path + "'", DDLLogLevel::Warning);
+			}
+		}
+	});
+}
+
+void DDL::Metrics::StopMetricsExport()
+{
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(export_mutex);
+
+		if (!export_running)
+		{
+			return;
+		}
+
+		export_running = false;
+	}
+
+	// The thread writes the file once more on its way out
+	export_condition.notify_all();
+	export_thread.join();
+}
@@ -0,0 +1,223 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+#define METRICS_HISTOGRAM_SUB_BUCKET_BITS 4 //!< Each power of two is split into 2^this many buckets, giving a relative error of at most 1/16th.
+#define METRICS_HISTOGRAM_SUB_BUCKET_COUNT (1 << METRICS_HISTOGRAM_SUB_BUCKET_BITS)
+#define METRICS_HISTOGRAM_MAX_EXPONENT 40 //!< Values of 2^40 microseconds (around 12 days) or more are placed in the last bucket.
+#define METRICS_HISTOGRAM_BUCKET_COUNT ((METRICS_HISTOGRAM_MAX_EXPONENT - METRICS_HISTOGRAM_SUB_BUCKET_BITS + 2) * METRICS_HISTOGRAM_SUB_BUCKET_COUNT)
+
+/**
+* Base class for a single metric in a DDLMetricsRegistry. Metrics are updated with atomics, so they can be updated from
+* any thread without taking a lock.
+*/
+class DDLMetric
+{
+protected:
+	/**
+	* Appends a single sample line to an output string, ie `name{labels} value`.
+	*/
+	static void append_sample(std::string* output, std::string_view name, std::string_view labels, double value);
+
+public:
+	virtual ~DDLMetric() = default;
+
+	/**
+	* Appends the current value of this metric to an output string, in the Prometheus text format.
+	*
+	* @param output - The string to append to.
+	* @param name - The name of the metric.
+	* @param labels - The labels of the metric, formatted as `name="value",...`, or an empty string.
+	*/
+	virtual void Format(std::string* output, std::string_view name, std::string_view labels) = 0;
+};
+
+/**
+* Class representing a metric whose value only ever increases, such as a number of requests.
+*/
+class DDLMetricCounter : public DDLMetric
+{
+private:
+	std::atomic<int64_t> value = 0;
+
+public:
+	void Increment(int64_t amount = 1);
+	int64_t GetValue();
+
+	void Format(std::string* output, std::string_view name, std::string_view labels) override;
+};
+
+/**
+* Class representing a metric which may go up and down, such as the length of a queue.
+*/
+class DDLMetricGauge : public DDLMetric
+{
+private:
+	std::atomic<double> value = 0.0;
+
+public:
+	void Set(double _value);
+	void Add(double amount);
+	double GetValue();
+
+	void Format(std::string* output, std::string_view name, std::string_view labels) override;
+};
+
+/**
+* Class representing a distribution of durations, such as request latencies.
+*
+* Durations are counted in log-linear buckets, in the style of an HDR histogram - every power of two microseconds is
+* split into #METRICS_HISTOGRAM_SUB_BUCKET_COUNT equal buckets, so any quantile can be estimated to within a few percent
+* from a fixed amount of memory. Recording a duration is a single atomic increment.
+*
+* Histograms are exported as a Prometheus summary, with the 50th, 90th, 99th and 99.9th percentiles.
+*/
+class DDLMetricHistogram : public DDLMetric
+{
+private:
+	std::atomic<uint64_t> buckets[METRICS_HISTOGRAM_BUCKET_COUNT] = {}; //!< The number of durations counted in each bucket.
+	std::atomic<uint64_t> count = 0;  //!< The number of durations recorded.
+	std::atomic<uint64_t> sum_us = 0; //!< The total of every duration recorded, in microseconds.
+
+	/**
+	* Retrieves the bucket a duration is counted in.
+	*/
+	static int get_bucket_index(uint64_t value_us);
+
+	/**
+	* Retrieves the value in the middle of a bucket, which is used to represent every duration counted in it.
+	*/
+	static uint64_t get_bucket_value(int index);
+
+public:
+	/**
+	* Records a duration.
+	*
+	* @param seconds - The duration, in seconds.
+	*/
+	void Record(double seconds);
+
+	/**
+	* Estimates a quantile of the recorded durations.
+	*
+	* @param quantile - The quantile to estimate, between 0 and 1.
+	*
+	* @returns The estimated duration in seconds, or 0 if nothing has been recorded.
+	*/
+	double GetQuantile(double quantile);
+
+	uint64_t GetCount();
+
+	void Format(std::string* output, std::string_view name, std::string_view labels) override;
+};
+
+/**
+* Class holding a set of named metrics, which can be exported together in the Prometheus text format.
+*
+* Metrics are created on first use and live as long as the registry, so the returned pointers may be kept and updated
+* without going through the registry again. Metrics with the same name but different labels belong to the same family,
+* and share its help text and type.
+*/
+class DDLMetricsRegistry
+{
+private:
+	/**
+	* Structure holding every metric with the same name.
+	*/
+	struct metric_family
+	{
+		std::string help = ""; //!< Description of the metric.
+		std::string type = ""; //!< The Prometheus type of the metric, ie `counter`.
+		std::map<std::string, std::unique_ptr<DDLMetric>> metrics = std::map<std::string, std::unique_ptr<DDLMetric>>(); //!< Metrics in this family, keyed by their labels.
+	};
+
+	std::mutex registry_mutex;
+	std::map<std::string, metric_family> families = std::map<std::string, metric_family>(); //!< Metric families, keyed by name.
+
+	/**
+	* Retrieves a metric, creating it if it does not already exist.
+	*/
+	template <typename T>
+	T* get_metric(std::string name, std::string help, std::string type, std::string labels);
+
+public:
+	DDLMetricCounter* GetCounter(std::string name, std::string help, std::string labels = "");
+	DDLMetricGauge* GetGauge(std::string name, std::string help, std::string labels = "");
+	DDLMetricHistogram* GetHistogram(std::string name, std::string help, std::string labels = "");
+
+	/**
+	* Formats every metric in the registry.
+	*
+	* @returns The metrics in the Prometheus text format.
+	*/
+	std::string Format();
+};
+
+/**
+* Namespace containing the global metrics registry, used to report the progress and health of a crawl.
+*
+* If `enabled` is set in the `(metrics)` section of website.cfg, the registry is periodically written to a Prometheus
+* textfile (for node_exporter's textfile collector) by a background thread. Metrics are always collected, as updating
+* one costs no more than an atomic increment.
+*/
+namespace DDL::Metrics
+{
+	DDLMetricCounter* GetCounter(std::string name, std::string help, std::string labels = "");
+	DDLMetricGauge* GetGauge(std::string name, std::string help, std::string labels = "");
+	DDLMetricHistogram* GetHistogram(std::string name, std::string help, std::string labels = "");
+
+	/**
+	* Formats a label for use with a metric, escaping its value as needed. Multiple labels should be joined with commas.
+	*
+	* @param name - The name of the label.
+	* @param value - The value of the label.
+	*
+	* @returns The formatted label, ie `status="200"`.
+	*/
+	std::string FormatLabel(std::string name, std::string value);
+
+	/**
+	* Marks the start of a phase of the application, such as downloading users.
+	*
+	* @param phase - The name of the phase.
+	*
+	* @returns The time the phase started, to be passed to #FinishPhase.
+	*/
+	std::chrono::steady_clock::time_point StartPhase(std::string phase);
+
+	/**
+	* Marks the end of a phase of the application, and records how long it took. The phase is also added to the trace, if
+	* one is being recorded.
+	*
+	* @param phase - The name of the phase.
+	* @param start_time - The time returned by #StartPhase.
+	*/
+	void FinishPhase(std::string phase, std::chrono::steady_clock::time_point start_time);
+
+	/**
+	* Starts writing the registry to the textfile set in website.cfg, if metrics are enabled.
+	*/
+	void StartMetricsExport();
+
+	/**
+	* Writes the registry out one last time, then stops the export thread.
+	*/
+	void StopMetricsExport();
+
+	/**
+	* Writes the registry to a textfile. The file is written alongside the path first and then renamed into place, so that
+	* node_exporter never reads a partially written file.
+	*
+	* @param path - The path of the textfile.
+	*
+	* @returns `true` if the file was written, otherwise returns `false`.
+	*/
+	bool WriteMetricsFile(std::string path);
+}
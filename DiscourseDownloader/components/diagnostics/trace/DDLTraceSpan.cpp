@@ -0,0 +1,45 @@
+#include "trace.h"
+
+DDLTraceSpan::DDLTraceSpan(const char* _name, const char* _category)
+{
+	active = DDL::Trace::IsTracing();
+
+	if (!active)
+	{
+		return;
+	}
+
+	name = _name;
+	category = _category;
+	start_time = std::chrono::steady_clock::now();
+}
+
+DDLTraceSpan::~DDLTraceSpan()
+{
+	if (!active)
+	{
+		return;
+	}
+
+	DDL::Trace::RecordSpan(name, category, start_time, std::move(args));
+}
+
+void DDLTraceSpan::AddArg(const char* key, std::string value)
+{
+	if (!active)
+	{
+		return;
+	}
+
+	args.push_back(std::pair<std::string, std::string>(key, value));
+}
+
+void DDLTraceSpan::AddArg(const char* key, int64_t value)
+{
+	if (!active)
+	{
+		return;
+	}
+
+	args.push_back(std::pair<std::string, std::string>(key, std::to_string(value)));
+}
@@ -0,0 +1,310 @@
+#include "trace.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <cstdio>
+
+#include "components/3rdparty/rapidjson/writer.h"
+#include "components/3rdparty/rapidjson/stringbuffer.h"
+
+#include "components/diagnostics/logger/logger.h"
+
+std::atomic<bool> tracing = false;
+std::mutex trace_mutex;
+std::string trace_path = "";
+std::chrono::steady_clock::time_point trace_start_time = std::chrono::steady_clock::time_point();
+std::chrono::steady_clock::time_point trace_last_flush_time = std::chrono::steady_clock::time_point();
+
+FILE* trace_file = nullptr;
+rapidjson::StringBuffer trace_buffer = rapidjson::StringBuffer(); //!< Events waiting to be written to the trace file.
+rapidjson::Writer<rapidjson::StringBuffer> trace_writer = rapidjson::Writer<rapidjson::StringBuffer>(trace_buffer);
+int64_t trace_event_count = 0;
+std::unordered_set<uint32_t> named_threads = std::unordered_set<uint32_t>();
+
+std::atomic<uint32_t> next_thread_id = 1;
+std::atomic<uint64_t> next_async_id = 1;
+uint32_t main_thread_id = 0;
+
+thread_local uint32_t current_thread_id = 0;
+
+/**
+* Retrieves the ID of the calling thread within the trace. Threads are numbered in the order they first record a span,
+* which keeps the IDs small and stable between runs.
+*/
+uint32_t get_trace_thread_id()
+{
+	if (current_thread_id == 0)
+	{
+		current_thread_id = next_thread_id++;
+	}
+
+	return current_thread_id;
+}
+
+/**
+* Starts a new event in the trace file, separating it from the previous one. The trace mutex must be held when calling
+* this.
+*/
+void begin_trace_event()
+{
+	if (trace_event_count > 0)
+	{
+		trace_buffer.Put(',');
+	}
+
+	trace_buffer.Put('\n');
+	trace_writer.Reset(trace_buffer);
+	trace_event_count++;
+}
+
+/**
+* Writes the fields shared by every kind of trace event.
+*/
+void write_event_header(rapidjson::Writer<rapidjson::StringBuffer>* writer, DDLTraceEvent* event, const char* phase, int64_t timestamp_us)
+{
+	writer->Key("name");
+	writer->String(event->name.c_str(), event->name.length());
+	writer->Key("cat");
+	writer->String(event->category);
+	writer->Key("ph");
+	writer->String(phase);
+	writer->Key("ts");
+	writer->Int64(timestamp_us);
+	writer->Key("pid");
+	writer->Int(1);
+	writer->Key("tid");
+	writer->Uint(event->thread_id);
+}
+
+/**
+* Writes a metadata event, which names the process or one of its threads in the trace viewer. The trace mutex must be
+* held when calling this.
+*/
+void write_name_event(const char* type, uint32_t thread_id, std::string name)
+{
+	begin_trace_event();
+
+	trace_writer.StartObject();
+	trace_writer.Key("name");
+	trace_writer.String(type);
+	trace_writer.Key("ph");
+	trace_writer.String("M");
+	trace_writer.Key("pid");
+	trace_writer.Int(1);
+	trace_writer.Key("tid");
+	trace_writer.Uint(thread_id);
+	trace_writer.Key("args");
+	trace_writer.StartObject();
+	trace_writer.Key("name");
+	trace_writer.String(name.c_str(), name.length());
+	trace_writer.EndObject();
+	trace_writer.EndObject();
+}
+
+/**
+* Writes a finished span to the trace file. The trace mutex must be held when calling this.
+*/
+void write_trace_event(DDLTraceEvent* event)
+{
+	// Threads are named the first time they appear, so the viewer doesn't label them by number alone
+	if (!named_threads.contains(event->thread_id))
+	{
+		named_threads.insert(event->thread_id);
+		write_name_event("thread_name", event->thread_id, (event->thread_id == main_thread_id) ? "main" : "thread " + std::to_string(event->thread_id));
+	}
+
+	begin_trace_event();
+
+	trace_writer.StartObject();
+	write_event_header(&trace_writer, event, event->async ? "b" : "X", event->start_us);
+
+	if (event->async)
+	{
+		trace_writer.Key("id");
+		trace_writer.Uint64(event->id);
+	}
+	else
+	{
+		trace_writer.Key("dur");
+		trace_writer.Int64(event->duration_us);
+	}
+
+	if (event->args.size() > 0)
+	{
+		trace_writer.Key("args");
+		trace_writer.StartObject();
+
+		for (std::pair<std::string, std::string>& arg : event->args)
+		{
+			trace_writer.Key(arg.first.c_str(), arg.first.length());
+			trace_writer.String(arg.second.c_str(), arg.second.length());
+		}
+
+		trace_writer.EndObject();
+	}
+
+	trace_writer.EndObject();
+
+	// Async spans are written as a separate begin and end event
+	if (event->async)
+	{
+		begin_trace_event();
+
+		trace_writer.StartObject();
+		write_event_header(&trace_writer, event, "e", event->start_us + event->duration_us);
+		trace_writer.Key("id");
+		trace_writer.Uint64(event->id);
+		trace_writer.EndObject();
+	}
+}
+
+/**
+* Writes every buffered event out to the trace file. Events are only ever written whole, so the file holds a readable
+* trace even if the application is closed part way through.
+*
+* The trace mutex must be held when calling this.
+*
+* @returns `true` if the events were written, otherwise returns `false`.
+*/
+bool flush_trace_file()
+{
+	size_t write_size = trace_buffer.GetSize();
+	bool write_result = fwrite(trace_buffer.GetString(), 1, write_size, trace_file) == write_size;
+
+	trace_buffer.Clear();
+	trace_last_flush_time = std::chrono::steady_clock::now();
+
+	return write_result;
+}
+
+/**
+* Adds a finished span to the trace.
+*/
+void add_trace_event(std::string name, const char* category, bool async, std::chrono::steady_clock::time_point start_time, DDLTraceArgs* args)
+{
+	std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+
+	DDLTraceEvent event = DDLTraceEvent();
+	event.name = std::move(name);
+	event.category = category;
+	event.async = async;
+	event.id = async ? next_async_id++ : 0;
+	event.thread_id = get_trace_thread_id();
+	event.start_us = std::chrono::duration_cast<std::chrono::microseconds>(start_time - trace_start_time).count();
+	event.duration_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+
+	if (args)
+	{
+		event.args = std::move(*args);
+	}
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(trace_mutex);
+
+	if (!tracing)
+	{
+		return;
+	}
+
+	write_trace_event(&event);
+
+	bool flush_due = trace_buffer.GetSize() >= TRACE_FLUSH_SIZE || end_time - trace_last_flush_time >= std::chrono::seconds(TRACE_FLUSH_INTERVAL);
+
+	if (flush_due && !flush_trace_file())
+	{
+		DDL::Logger::LogEvent("failed to write trace file '" + trace_path + "', tracing will stop", DDLLogLevel::Error);
+		tracing = false;
+	}
+}
+
+bool DDL::Trace::StartTrace(std::string path)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(trace_mutex);
+
+	if (trace_file)
+	{
+		return false;
+	}
+
+	if (fopen_s(&trace_file, path.c_str(), "wb") != 0 || !trace_file)
+	{
+		DDL::Logger::LogEvent("could not create trace file '" + path + "', no trace will be recorded", DDLLogLevel::Error);
+		trace_file = nullptr;
+		return false;
+	}
+
+	// Events are already collected into batches, so they go straight to disk rather than being buffered again
+	setvbuf(trace_file, nullptr, _IONBF, 0);
+
+	trace_path = path;
+	trace_buffer.Clear();
+	trace_event_count = 0;
+	named_threads.clear();
+
+	trace_start_time = std::chrono::steady_clock::now();
+	trace_last_flush_time = trace_start_time;
+	main_thread_id = get_trace_thread_id();
+
+	trace_buffer.Put('[');
+	write_name_event("process_name", main_thread_id, "DiscourseDownloader");
+
+	tracing = true;
+
+	DDL::Logger::LogEvent("recording trace to '" + path + "'");
+	return true;
+}
+
+bool DDL::Trace::StopTrace()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(trace_mutex);
+
+	if (!trace_file)
+	{
+		return false;
+	}
+
+	bool was_tracing = tracing;
+	tracing = false;
+
+	trace_buffer.Put('\n');
+	trace_buffer.Put(']');
+	trace_buffer.Put('\n');
+
+	bool write_result = flush_trace_file() && was_tracing;
+	fclose(trace_file);
+	trace_file = nullptr;
+
+	if (!write_result)
+	{
+		DDL::Logger::LogEvent("trace file '" + trace_path + "' is incomplete", DDLLogLevel::Error);
+		return false;
+	}
+
+	DDL::Logger::LogEvent("wrote " + std::to_string(trace_event_count) + " trace events to '" + trace_path + "'");
+	return true;
+}
+
+bool DDL::Trace::IsTracing()
+{
+	return tracing;
+}
+
+void DDL::Trace::RecordSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time, DDLTraceArgs args)
+{
+	if (!tracing)
+	{
+		return;
+	}
+
+	add_trace_event(std::move(name), category, false, start_time, &args);
+}
+
+void DDL::Trace::RecordAsyncSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time, DDLTraceArgs args)
+{
+	if (!tracing)
+	{
+		return;
+	}
+
+	add_trace_event(std::move(name), category, true, start_time, &args);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <chrono>
+#include <stdint.h>
+
+#define TRACE_DEFAULT_FILENAME std::string("trace.json")
+#define TRACE_FLUSH_INTERVAL 1 //!< Maximum number of seconds a trace event is buffered before being written to disk.
+#define TRACE_FLUSH_SIZE 65536 //!< Number of bytes of buffered trace events after which they are written to disk.
+
+typedef std::vector<std::pair<std::string, std::string>> DDLTraceArgs; //!< Named values attached to a trace event, shown when the event is selected.
+
+/**
+* Structure representing a single span in a trace, on its way to the trace file.
+*/
+struct DDLTraceEvent
+{
+	std::string name = "";
+	const char* category = ""; //!< The category of the span, used to filter and colour spans in the trace viewer.
+	bool async = false;        //!< Whether or not the span may overlap others on the same thread, such as a request in flight.
+	uint64_t id = 0;           //!< Identifies an async span, so that its start and end can be matched up.
+	uint32_t thread_id = 0;    //!< The thread that recorded the span.
+	int64_t start_us = 0;      //!< The start of the span, in microseconds since tracing started.
+	int64_t duration_us = 0;   //!< The length of the span, in microseconds.
+	DDLTraceArgs args = DDLTraceArgs();
+};
+
+/**
+* Class representing a span which covers the lifetime of the object, ie the rest of the scope it is declared in. Does
+* nothing unless tracing has been started with the `-trace` switch.
+*/
+class DDLTraceSpan
+{
+private:
+	const char* name = "";
+	const char* category = "";
+	bool active = false; //!< Whether or not tracing was running when the span started.
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::time_point();
+	DDLTraceArgs args = DDLTraceArgs();
+
+public:
+	/**
+	* Starts a new span.
+	*
+	* @param _name - The name of the span.
+	* @param _category - The category of the span.
+	*/
+	DDLTraceSpan(const char* _name, const char* _category);
+
+	DDLTraceSpan(const DDLTraceSpan&) = delete;
+	DDLTraceSpan& operator=(const DDLTraceSpan&) = delete;
+
+	/**
+	* Ends the span, and adds it to the trace.
+	*/
+	~DDLTraceSpan();
+
+	/**
+	* Attaches a value to the span.
+	*
+	* @param key - The name of the value.
+	* @param value - The value.
+	*/
+	void AddArg(const char* key, std::string value);
+	void AddArg(const char* key, int64_t value);
+};
+
+/**
+* Namespace containing functions for recording a trace of the application, which shows where time is spent between the
+* network, parsing and the disk.
+*
+* Spans are written to the trace file as they finish, using the array form of the Chrome Trace Event format, so it can
+* be opened in Perfetto (https://ui.perfetto.dev) or `chrome://tracing`. The closing bracket is only written when tracing
+* stops, but trace viewers accept a file without it, so the trace of a run which crashed can still be opened.
+*/
+namespace DDL::Trace
+{
+	/**
+	* Starts recording a trace. The calling thread is named `main` in the trace.
+	*
+	* @param path - The path to write the trace to.
+	*
+	* @returns `true` if the trace file was created, otherwise returns `false`.
+	*/
+	bool StartTrace(std::string path);
+
+	/**
+	* Stops recording, and finishes writing the trace.
+	*
+	* @returns `true` if the whole trace was written, otherwise returns `false`.
+	*/
+	bool StopTrace();
+
+	/**
+	* Checks whether a trace is being recorded. Callers should check this before doing any work to describe a span.
+	*
+	* @returns `true` if a trace is being recorded, otherwise returns `false`.
+	*/
+	bool IsTracing();
+
+	/**
+	* Adds a span which has already finished to the trace, on the calling thread.
+	*
+	* @param name - The name of the span.
+	* @param category - The category of the span.
+	* @param start_time - The time the span started.
+	* @param args - Any values to attach to the span.
+	*/
+	void RecordSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time, DDLTraceArgs args = DDLTraceArgs());
+
+	/**
+	* Adds a span which has already finished to the trace, allowing it to overlap other spans on the calling thread. Used
+	* for work which is interleaved on a single thread, such as requests in a DDLRequestQueue.
+	*
+	* @param name - The name of the span.
+	* @param category - The category of the span.
+	* @param start_time - The time the span started.
+	* @param args - Any values to attach to the span.
+	*/
+	void RecordAsyncSpan(std::string name, const char* category, std::chrono::steady_clock::time_point start_time, DDLTraceArgs args = DDLTraceArgs());
+}
@@ -0,0 +1,834 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <charconv>
+#include <functional>
+
+#include "components/3rdparty/rapidjson/stringbuffer.h"
+#include "components/3rdparty/rapidjson/writer.h"
+
+#include "components/utils/network/network.h"
+
+/**
+* Mixes an integer into a well distributed hash, used to vary the forum contents without storing them.
+*/
+uint32_t mock_hash(uint32_t value)
+{
+	value ^= value >> 16;
+	value *= 0x7feb352d;
+	value ^= value >> 15;
+	value *= 0x846ca68b;
+	value ^= value >> 16;
+
+	return value;
+}
+
+/**
+* Builds a timestamp in the format used by Discourse, which varies with the given value.
+*/
+std::string mock_timestamp(uint32_t value)
+{
+	char timestamp[32] = { 0 };
+	sprintf_s(timestamp, sizeof(timestamp), "2021-%02u-%02uT%02u:%02u:00.000Z", (value % 12) + 1, (value % 28) + 1, (value / 7) % 24, (value / 3) % 60);
+
+	return std::string(timestamp);
+}
+
+/**
+* Parses an integer from the start of a string.
+*
+* @returns The parsed integer, or the fallback value if the string doesn't start with one.
+*/
+int mock_parse_int(std::string_view text, int fallback)
+{
+	int value = fallback;
+	std::from_chars_result result = std::from_chars(text.data(), text.data() + text.length(), value);
+
+	return (result.ec == std::errc()) ? value : fallback;
+}
+
+/**
+* Retrieves the value of a query string parameter.
+*
+* @returns The value, or an empty view if the parameter is missing.
+*/
+std::string_view mock_query_value(std::string_view query, std::string_view name)
+{
+	size_t offset = 0;
+
+	while (offset < query.length())
+	{
+		size_t end = query.find('&', offset);
+
+		if (end == std::string_view::npos)
+		{
+			end = query.length();
+		}
+
+		std::string_view parameter = query.substr(offset, end - offset);
+
+		if (parameter.length() > name.length() && parameter.starts_with(name) && parameter[name.length()] == '=')
+		{
+			return parameter.substr(name.length() + 1);
+		}
+
+		offset = end + 1;
+	}
+
+	return std::string_view();
+}
+
+/**
+* Writes a string member to a JSON object.
+*/
+void mock_write_string(rapidjson::Writer<rapidjson::StringBuffer>* writer, const char* name, std::string value)
+{
+	writer->Key(name);
+	writer->String(value.c_str(), value.length());
+}
+
+/**
+* Writes an integer member to a JSON object.
+*/
+void mock_write_int(rapidjson::Writer<rapidjson::StringBuffer>* writer, const char* name, int value)
+{
+	writer->Key(name);
+	writer->Int(value);
+}
+
+DDLMockForum::DDLMockForum(DDLMockForumConfig _config)
+{
+	config = _config;
+
+	config.category_count = std::max(1, config.category_count);
+	config.topics_per_category = std::max(0, config.topics_per_category);
+	config.posts_per_topic = std::max(1, config.posts_per_topic);
+	config.user_count = std::max(1, config.user_count);
+	config.tag_count = std::max(0, config.tag_count);
+	config.group_count = std::max(0, config.group_count);
+
+	random = std::mt19937(config.seed);
+}
+
+int DDLMockForum::Respond(DDLNetworkRequest* request)
+{
+	int latency_ms = config.latency_ms;
+	int injection_roll = 100;
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(random_mutex);
+
+		if (config.latency_jitter_ms > 0)
+		{
+			latency_ms += random() % (config.latency_jitter_ms + 1);
+		}
+
+		if (config.rate_limit_percent > 0 || config.server_error_percent > 0)
+		{
+			injection_roll = random() % 100;
+		}
+	}
+
+	if (injection_roll < config.rate_limit_percent)
+	{
+		request->http_code = 429;
+		request->rate_limit_code = "ip_10_secs_limit";
+		request->response = "{\"errors\":[\"You've performed this action too many times. Please wait a few seconds before trying again.\"],"
+			"\"error_type\":\"rate_limit\",\"extras\":{\"wait_seconds\":1}}";
+	}
+	else if (injection_roll < config.rate_limit_percent + config.server_error_percent)
+	{
+		request->http_code = 502;
+		request->response = "<html><body><h1>502 Bad Gateway</h1></body></html>";
+	}
+	else
+	{
+		// Only the path matters, so that the forum answers no matter which url it is given
+		std::string_view path = request->url;
+		{
+			size_t scheme_end = path.find("://");
+			size_t path_start = path.find('/', (scheme_end == std::string_view::npos) ? 0 : scheme_end + 3);
+
+			path = (path_start == std::string_view::npos) ? "/" : path.substr(path_start);
+		}
+
+		request->http_code = route_request(path, &request->response);
+	}
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(random_mutex);
+
+	if (request->http_code == 200)
+	{
+		served_requests++;
+	}
+	else if (request->http_code != 404)
+	{
+		injected_errors++;
+	}
+
+	return latency_ms;
+}
+
+int DDLMockForum::GetTopicCount()
+{
+	return config.category_count * config.topics_per_category;
+}
+
+void DDLMockForum::GetRequestCounts(int64_t* served, int64_t* errors)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(random_mutex);
+
+	*served = served_requests;
+	*errors = injected_errors;
+}
+
+int DDLMockForum::get_post_count(int topic_id)
+{
+	return 1 + (mock_hash(topic_id) % (config.posts_per_topic * 2));
+}
+
+int DDLMockForum::get_post_id(int topic_id, int post_index)
+{
+	return (topic_id - 1) * (config.posts_per_topic * 2) + post_index + 1;
+}
+
+std::string DDLMockForum::get_username(int user_index)
+{
+	return "user_" + std::to_string(user_index);
+}
+
+int DDLMockForum::find_user(std::string_view username)
+{
+	if (!username.starts_with("user_"))
+	{
+		return -1;
+	}
+
+	int user_index = mock_parse_int(username.substr(5), -1);
+
+	return (user_index >= 0 && user_index < config.user_count) ? user_index : -1;
+}
+
+int DDLMockForum::route_request(std::string_view path, std::string* response)
+{
+	std::string_view query = std::string_view();
+	{
+		size_t query_start = path.find('?');
+
+		if (query_start != std::string_view::npos)
+		{
+			query = path.substr(query_start + 1);
+			path = path.substr(0, query_start);
+		}
+	}
+
+	int page = mock_parse_int(mock_query_value(query, "page"), 0);
+	std::vector<std::string_view> segments = std::vector<std::string_view>();
+	{
+		size_t offset = 1;
+
+		while (offset <= path.length())
+		{
+			size_t end = path.find('/', offset);
+
+			if (end == std::string_view::npos)
+			{
+				end = path.length();
+			}
+
+			segments.push_back(path.substr(offset, end - offset));
+			offset = end + 1;
+		}
+	}
+
+	int total_topic_count = GetTopicCount();
+	int group_id = -1;
+
+	if (path == "/categories.json")
+	{
+		*response = build_category_list();
+	}
+	else if (segments.size() == 3 && segments[0] == "c" && segments[2] == "show.json")
+	{
+		int category_id = mock_parse_int(segments[1], -1);
+
+		if (category_id < 1 || category_id > config.category_count)
+		{
+			return 404;
+		}
+
+		*response = build_category_info(category_id);
+	}
+	else if (segments.size() == 3 && segments[0] == "c" && segments[2].ends_with(".json"))
+	{
+		int category_id = mock_parse_int(segments[2], -1);
+
+		if (category_id < 1 || category_id > config.category_count)
+		{
+			return 404;
+		}
+
+		*response = build_topic_list(category_id, page);
+	}
+	else if (segments.size() == 2 && segments[0] == "t" && segments[1].ends_with(".json"))
+	{
+		int topic_id = mock_parse_int(segments[1], -1);
+
+		if (topic_id < 1 || topic_id > total_topic_count)
+		{
+			return 404;
+		}
+
+		*response = build_topic(topic_id);
+	}
+	else if (segments.size() == 3 && segments[0] == "t" && segments[2] == "posts.json")
+	{
+		int topic_id = mock_parse_int(segments[1], -1);
+
+		if (topic_id < 1 || topic_id > total_topic_count)
+		{
+			return 404;
+		}
+
+		*response = build_post_chunk(topic_id, query);
+	}
+	else if (path == "/directory_items.json")
+	{
+		*response = build_directory_page(page);
+	}
+	else if (segments.size() == 2 && (segments[0] == "u" || segments[0] == "user-badges") && segments[1].ends_with(".json"))
+	{
+		int user_index = find_user(segments[1].substr(0, segments[1].length() - 5));
+
+		if (user_index == -1)
+		{
+			return 404;
+		}
+
+		*response = (segments[0] == "u") ? build_user(user_index) : build_user_badges();
+	}
+	else if (path == "/user_actions.json")
+	{
+		int user_index = find_user(mock_query_value(query, "username"));
+
+		if (user_index == -1)
+		{
+			return 404;
+		}
+
+		*response = build_user_actions(user_index, mock_parse_int(mock_query_value(query, "offset"), 0));
+	}
+	else if (segments.size() >= 2 && (segments[0] == "user_avatar" || segments[0] == "letter_avatar_proxy"))
+	{
+		// Uploaded avatars have the size as the second to last segment, letter avatars have it in the file name
+		std::string_view size_segment = (segments[0] == "user_avatar") ? segments[segments.size() - 2] : segments.back();
+		*response = build_avatar(mock_parse_int(size_segment, 120), std::hash<std::string_view>()(path));
+	}
+	else if (path == "/tags.json")
+	{
+		*response = build_tag_list();
+	}
+	else if (segments.size() == 2 && segments[0] == "tag" && segments[1].ends_with(".json"))
+	{
+		*response = build_tag_topic_list(page);
+	}
+	else if (path == "/groups.json")
+	{
+		*response = build_group_list(page);
+	}
+	else if (segments.size() == 2 && segments[0] == "groups" && segments[1].starts_with("group_")
+		&& (group_id = mock_parse_int(segments[1].substr(6), -1)) >= 0 && group_id < config.group_count)
+	{
+		*response = build_group(group_id);
+	}
+	else if (path == "/site.json")
+	{
+		*response = build_site_info();
+	}
+	else if (path == "/latest.json")
+	{
+		*response = "{\"topic_list\":{\"topics\":[]}}";
+	}
+	else if (path == "/posts.json")
+	{
+		*response = "{\"latest_posts\":[]}";
+	}
+	else
+	{
+		return 404;
+	}
+
+	return 200;
+}
+
+std::string DDLMockForum::build_category_list()
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("category_list");
+	writer.StartObject();
+	writer.Key("categories");
+	writer.StartArray();
+
+	for (int category_id = 1; category_id <= config.category_count; category_id++)
+	{
+		writer.StartObject();
+		mock_write_int(&writer, "id", category_id);
+		mock_write_string(&writer, "name", "Category " + std::to_string(category_id));
+		mock_write_string(&writer, "slug", "category-" + std::to_string(category_id));
+		mock_write_string(&writer, "color", "0088CC");
+		mock_write_int(&writer, "topic_count", config.topics_per_category);
+		mock_write_int(&writer, "position", category_id);
+		mock_write_string(&writer, "description", "Synthetic category " + std::to_string(category_id) + " used for benchmarking.");
+		writer.Key("uploaded_logo");
+		writer.Null();
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_category_info(int category_id)
+{
+	int post_count = 0;
+
+	for (int i = 0; i < config.topics_per_category; i++)
+	{
+		post_count += get_post_count((category_id - 1) * config.topics_per_category + i + 1);
+	}
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("category");
+	writer.StartObject();
+	mock_write_int(&writer, "id", category_id);
+	mock_write_int(&writer, "post_count", post_count);
+	mock_write_string(&writer, "topic_url", "/t/about-category-" + std::to_string(category_id));
+	writer.Key("permissions");
+	writer.StartArray();
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_topic_list(int category_id, int page)
+{
+	int first_topic = page * MOCK_FORUM_TOPIC_PAGE_SIZE;
+	int last_topic = std::min(first_topic + MOCK_FORUM_TOPIC_PAGE_SIZE, config.topics_per_category);
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("topic_list");
+	writer.StartObject();
+
+	if (last_topic < config.topics_per_category)
+	{
+		mock_write_string(&writer, "more_topics_url", "/c/category-" + std::to_string(category_id) + "/" + std::to_string(category_id)
+			+ "?page=" + std::to_string(page + 1));
+	}
+
+	writer.Key("topics");
+	writer.StartArray();
+
+	for (int i = first_topic; i < last_topic; i++)
+	{
+		int topic_id = (category_id - 1) * config.topics_per_category + i + 1;
+
+		writer.StartObject();
+		mock_write_int(&writer, "id", topic_id);
+		mock_write_string(&writer, "title", "Synthetic topic " + std::to_string(topic_id));
+		mock_write_string(&writer, "slug", "synthetic-topic-" + std::to_string(topic_id));
+		mock_write_int(&writer, "posts_count", get_post_count(topic_id));
+		mock_write_string(&writer, "created_at", mock_timestamp(topic_id));
+		mock_write_string(&writer, "bumped_at", mock_timestamp(mock_hash(topic_id)));
+		mock_write_int(&writer, "category_id", category_id);
+		writer.Key("pinned");
+		writer.Bool(false);
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+/**
+* Writes a single post of a synthetic topic.
+*/
+void mock_write_post(rapidjson::Writer<rapidjson::StringBuffer>* writer, int topic_id, int post_id, int post_number, std::string username)
+{
+	std::string cooked = "<p>";
+
+	// Varies the length of each post, so that responses aren't all the same size
+	for (uint32_t i = 0; i <= mock_hash(post_id) % 8; i++)
+	{
+		cooked += "Post " + std::to_string(post_number) + " of synthetic topic " + std::to_string(topic_id)
+			+ ", written to give the downloader something realistic to parse and store. ";
+	}
+
+	cooked += "</p>";
+
+	writer->StartObject();
+	mock_write_int(writer, "id", post_id);
+	mock_write_string(writer, "username", username);
+	mock_write_string(writer, "avatar_template", "/letter_avatar_proxy/v4/letter/u/5e9732/{size}.png");
+	mock_write_string(writer, "created_at", mock_timestamp(post_id));
+	mock_write_string(writer, "cooked", cooked);
+	mock_write_int(writer, "post_number", post_number);
+	mock_write_int(writer, "post_type", 1);
+	mock_write_int(writer, "reply_count", 0);
+	mock_write_int(writer, "topic_id", topic_id);
+	writer->EndObject();
+}
+
+std::string DDLMockForum::build_topic(int topic_id)
+{
+	int post_count = get_post_count(topic_id);
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	mock_write_int(&writer, "id", topic_id);
+	mock_write_string(&writer, "title", "Synthetic topic " + std::to_string(topic_id));
+	mock_write_string(&writer, "slug", "synthetic-topic-" + std::to_string(topic_id));
+	mock_write_int(&writer, "posts_count", post_count);
+	mock_write_string(&writer, "created_at", mock_timestamp(topic_id));
+	mock_write_string(&writer, "bumped_at", mock_timestamp(mock_hash(topic_id)));
+	mock_write_int(&writer, "category_id", (topic_id - 1) / std::max(1, config.topics_per_category) + 1);
+
+	writer.Key("post_stream");
+	writer.StartObject();
+	writer.Key("posts");
+	writer.StartArray();
+
+	for (int i = 0; i < std::min(post_count, MOCK_FORUM_TOPIC_POST_COUNT); i++)
+	{
+		int post_id = get_post_id(topic_id, i);
+		mock_write_post(&writer, topic_id, post_id, i + 1, get_username(mock_hash(post_id) % config.user_count));
+	}
+
+	writer.EndArray();
+	writer.Key("stream");
+	writer.StartArray();
+
+	for (int i = 0; i < post_count; i++)
+	{
+		writer.Int(get_post_id(topic_id, i));
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_post_chunk(int topic_id, std::string_view query)
+{
+	int post_count = get_post_count(topic_id);
+	int first_post_id = get_post_id(topic_id, 0);
+	int returned_posts = 0;
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("post_stream");
+	writer.StartObject();
+	writer.Key("posts");
+	writer.StartArray();
+
+	size_t offset = 0;
+
+	while (offset < query.length() && (config.post_request_limit <= 0 || returned_posts < config.post_request_limit))
+	{
+		size_t end = query.find('&', offset);
+
+		if (end == std::string_view::npos)
+		{
+			end = query.length();
+		}
+
+		std::string_view parameter = query.substr(offset, end - offset);
+		offset = end + 1;
+
+		if (!parameter.starts_with("post_ids[]="))
+		{
+			continue;
+		}
+
+		// Posts from other topics are left out, just as Discourse does
+		int post_id = mock_parse_int(parameter.substr(11), -1);
+		int post_index = post_id - first_post_id;
+
+		if (post_index < 0 || post_index >= post_count)
+		{
+			continue;
+		}
+
+		mock_write_post(&writer, topic_id, post_id, post_index + 1, get_username(mock_hash(post_id) % config.user_count));
+		returned_posts++;
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_directory_page(int page)
+{
+	int first_user = page * MOCK_FORUM_DIRECTORY_PAGE_SIZE;
+	int last_user = std::min(first_user + MOCK_FORUM_DIRECTORY_PAGE_SIZE, config.user_count);
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("directory_items");
+	writer.StartArray();
+
+	for (int user_index = first_user; user_index < last_user; user_index++)
+	{
+		std::string username = get_username(user_index);
+		std::string avatar_template = "/user_avatar/benchmark.invalid/" + username + "/{size}/" + std::to_string(user_index + 1) + "_2.png";
+
+		if (mock_hash(user_index) % 100 < MOCK_FORUM_LETTER_AVATAR_PERCENT)
+		{
+			avatar_template = "/letter_avatar_proxy/v4/letter/" + username.substr(0, 1) + "/" + std::to_string(mock_hash(user_index) % 8)
+				+ "e9732/{size}.png";
+		}
+
+		writer.StartObject();
+		mock_write_int(&writer, "id", user_index + 1);
+		mock_write_int(&writer, "likes_received", mock_hash(user_index) % 500);
+		mock_write_int(&writer, "likes_given", mock_hash(user_index + 1) % 500);
+		mock_write_int(&writer, "topic_count", mock_hash(user_index + 2) % 50);
+		mock_write_int(&writer, "post_count", mock_hash(user_index + 3) % 1000);
+		mock_write_int(&writer, "days_visited", mock_hash(user_index + 4) % 365);
+		writer.Key("user");
+		writer.StartObject();
+		mock_write_int(&writer, "id", user_index + 1);
+		mock_write_string(&writer, "username", username);
+		mock_write_string(&writer, "name", "Synthetic User " + std::to_string(user_index));
+		mock_write_string(&writer, "avatar_template", avatar_template);
+		writer.EndObject();
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.Key("meta");
+	writer.StartObject();
+	mock_write_int(&writer, "total_rows_directory_items", config.user_count);
+	mock_write_string(&writer, "load_more_directory_items", "/directory_items.json?page=" + std::to_string(page + 1) + "&period=all");
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_user(int user_index)
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("user");
+	writer.StartObject();
+	mock_write_int(&writer, "id", user_index + 1);
+	mock_write_string(&writer, "username", get_username(user_index));
+	mock_write_string(&writer, "name", "Synthetic User " + std::to_string(user_index));
+	mock_write_string(&writer, "created_at", mock_timestamp(user_index));
+	mock_write_string(&writer, "last_seen_at", mock_timestamp(mock_hash(user_index)));
+	mock_write_int(&writer, "trust_level", mock_hash(user_index) % 5);
+	mock_write_string(&writer, "bio_cooked", "<p>Synthetic user " + std::to_string(user_index) + ", created for benchmarking.</p>");
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_user_badges()
+{
+	return "{\"badges\":[],\"badge_types\":[],\"users\":[],\"user_badges\":[]}";
+}
+
+std::string DDLMockForum::build_user_actions(int user_index, int offset)
+{
+	int action_count = mock_hash(user_index) % 100;
+	int total_topic_count = std::max(1, GetTopicCount());
+	int last_action = std::min(offset + MOCK_FORUM_USER_ACTIONS_PAGE_SIZE, action_count);
+
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("user_actions");
+	writer.StartArray();
+
+	for (int i = std::max(0, offset); i < last_action; i++)
+	{
+		int topic_id = (mock_hash(user_index * 131 + i) % total_topic_count) + 1;
+
+		writer.StartObject();
+		mock_write_int(&writer, "action_type", 5);
+		mock_write_string(&writer, "created_at", mock_timestamp(user_index + i));
+		mock_write_string(&writer, "excerpt", "A reply from synthetic user " + std::to_string(user_index));
+		mock_write_int(&writer, "topic_id", topic_id);
+		mock_write_int(&writer, "post_number", 1 + (i % get_post_count(topic_id)));
+		mock_write_string(&writer, "username", get_username(user_index));
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_avatar(int size, size_t url_hash)
+{
+	size = std::clamp(size, 1, 1000);
+
+	// Roughly the size of a compressed avatar, with contents that differ for every url so that only identical urls share a blob
+	std::string avatar = std::string("\x89PNG\r\n\x1a\n", 8);
+	avatar.append((const char*)&url_hash, sizeof(url_hash));
+	avatar.resize(avatar.length() + (size * size) / 4, (char)(url_hash & 0xFF));
+
+	return avatar;
+}
+
+std::string DDLMockForum::build_tag_list()
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("tags");
+	writer.StartArray();
+
+	for (int i = 0; i < config.tag_count; i++)
+	{
+		writer.StartObject();
+		mock_write_string(&writer, "id", "tag-" + std::to_string(i));
+		mock_write_string(&writer, "text", "tag-" + std::to_string(i));
+		mock_write_int(&writer, "count", MOCK_FORUM_TOPIC_PAGE_SIZE);
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_tag_topic_list(int page)
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("topic_list");
+	writer.StartObject();
+	writer.Key("topics");
+	writer.StartArray();
+
+	// Every tag holds a single page of topics
+	for (int i = 0; page == 0 && i < std::min(MOCK_FORUM_TOPIC_PAGE_SIZE, GetTopicCount()); i++)
+	{
+		writer.StartObject();
+		mock_write_int(&writer, "id", i + 1);
+		mock_write_string(&writer, "title", "Synthetic topic " + std::to_string(i + 1));
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_group_list(int page)
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("groups");
+	writer.StartArray();
+
+	for (int i = 0; page == 0 && i < config.group_count; i++)
+	{
+		writer.StartObject();
+		mock_write_int(&writer, "id", i + 1);
+		mock_write_string(&writer, "name", "group_" + std::to_string(i));
+		mock_write_int(&writer, "user_count", mock_hash(i) % config.user_count);
+		writer.Key("flair_url");
+		writer.Null();
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_group(int group_index)
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	writer.Key("group");
+	writer.StartObject();
+	mock_write_int(&writer, "id", group_index + 1);
+	mock_write_string(&writer, "name", "group_" + std::to_string(group_index));
+	mock_write_string(&writer, "full_name", "Synthetic Group " + std::to_string(group_index));
+	mock_write_int(&writer, "user_count", mock_hash(group_index) % config.user_count);
+	writer.EndObject();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
+
+std::string DDLMockForum::build_site_info()
+{
+	rapidjson::StringBuffer buffer = rapidjson::StringBuffer();
+	rapidjson::Writer<rapidjson::StringBuffer> writer = rapidjson::Writer<rapidjson::StringBuffer>(buffer);
+
+	writer.StartObject();
+	mock_write_string(&writer, "default_archetype", "regular");
+	writer.Key("categories");
+	writer.StartArray();
+
+	for (int category_id = 1; category_id <= config.category_count; category_id++)
+	{
+		writer.StartObject();
+		mock_write_int(&writer, "id", category_id);
+		mock_write_string(&writer, "name", "Category " + std::to_string(category_id));
+		mock_write_string(&writer, "slug", "category-" + std::to_string(category_id));
+		writer.EndObject();
+	}
+
+	writer.EndArray();
+	writer.EndObject();
+
+	return std::string(buffer.GetString(), buffer.GetSize());
+}
@@ -0,0 +1,156 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "components/discourse/discourse.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/network/network.h"
+
+#define BENCHMARK_MARKER_FILENAME std::string(".ddl_benchmark") //!< Marks a directory as safe for the benchmark to clear.
+
+/**
+* Retrieves a percentile from a sorted list of latencies.
+*/
+float get_latency_percentile(std::vector<float>* sorted_latencies, double percentile)
+{
+	if (sorted_latencies->size() == 0)
+	{
+		return 0.0f;
+	}
+
+	size_t index = (size_t)(percentile * (sorted_latencies->size() - 1) + 0.5);
+	return sorted_latencies->at(std::min(index, sorted_latencies->size() - 1));
+}
+
+/**
+* Clears out the benchmark directory, left over from an earlier run.
+*
+* @returns `true` if the directory is empty and ready to use, otherwise returns `false`.
+*/
+bool prepare_benchmark_directory(std::string directory)
+{
+	std::error_code error;
+
+	if (std::filesystem::exists(directory, error) && !std::filesystem::is_empty(directory, error))
+	{
+		// Refuses to clear a directory which wasn't created by the benchmark, in case it points at a real archive
+		if (!DDL::Utils::IO::IsFile(directory + BENCHMARK_MARKER_FILENAME))
+		{
+			DDL::Logger::LogEvent("benchmark directory '" + directory + "' is not empty and was not created by a previous benchmark, "
+				"please choose another directory in website.cfg", DDLLogLevel::Error);
+			return false;
+		}
+
+		std::filesystem::remove_all(directory, error);
+
+		if (error)
+		{
+			DDL::Logger::LogEvent("could not clear benchmark directory '" + directory + "': " + error.message(), DDLLogLevel::Error);
+			return false;
+		}
+	}
+
+	DDL::Utils::IO::ValidatePath(directory);
+	return DDL::Utils::IO::CreateNewFile(directory + BENCHMARK_MARKER_FILENAME, "");
+}
+
+DDLResult DDL::Discourse::Benchmark::RunBenchmark()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - benchmark will NOT be run!", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
+
+	DDLMockForumConfig forum_config = DDLMockForumConfig();
+	{
+		forum_config.category_count = config->benchmark_category_count;
+		forum_config.topics_per_category = config->benchmark_topics_per_category;
+		forum_config.posts_per_topic = config->benchmark_posts_per_topic;
+		forum_config.user_count = config->benchmark_user_count;
+		forum_config.tag_count = config->benchmark_tag_count;
+		forum_config.group_count = config->benchmark_group_count;
+		forum_config.post_request_limit = config->benchmark_post_request_limit;
+		forum_config.latency_ms = config->benchmark_latency_ms;
+		forum_config.latency_jitter_ms = config->benchmark_latency_jitter_ms;
+		forum_config.rate_limit_percent = config->benchmark_rate_limit_percent;
+		forum_config.server_error_percent = config->benchmark_server_error_percent;
+		forum_config.seed = config->benchmark_seed;
+	}
+
+	// Everything is redirected into the benchmark directory, and nothing is carried over from an earlier run
+	{
+		config->website_url = MOCK_FORUM_URL;
+		config->site_directory_root = config->benchmark_directory;
+
+		if (!config->site_directory_root.ends_with('/'))
+		{
+			config->site_directory_root += "/";
+		}
+
+		config->json_path = config->site_directory_root + "json";
+		config->html_path = config->site_directory_root + "export";
+
+		config->resume_download = false;
+		config->incremental_sync = false;
+		config->download_skip_existing_categories = false;
+		config->download_skip_existing_topics = false;
+		config->download_skip_existing_posts = false;
+		config->use_category_id_filter = false;
+	}
+
+	if (!prepare_benchmark_directory(config->site_directory_root))
+	{
+		return DDLResult::Error_Generic;
+	}
+
+	DDLMockForum forum = DDLMockForum(forum_config);
+
+	DDL::Utils::Network::SetResponseSource([&forum](DDLNetworkRequest* request)
+	{
+		return forum.Respond(request);
+	});
+
+	DDL::Utils::Network::EnableRequestStatistics();
+
+	DDL::Logger::LogEvent("benchmarking against a synthetic forum with " + std::to_string(forum_config.category_count) + " categories, "
+		+ std::to_string(forum.GetTopicCount()) + " topics and " + std::to_string(forum_config.user_count) + " users ("
+		+ std::to_string(forum_config.latency_ms) + "-" + std::to_string(forum_config.latency_ms + forum_config.latency_jitter_ms) + "ms latency, "
+		+ std::to_string(forum_config.rate_limit_percent) + "% http 429, " + std::to_string(forum_config.server_error_percent) + "% http 502)");
+
+	DDL::Logger::LogEvent("using up to " + std::to_string(DDL::Utils::Network::GetMaxConcurrentRequests()) + " concurrent requests, rate limiter is "
+		+ std::string(config->enable_rate_limiter ? "enabled" : "disabled"));
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	DDL::Discourse::DownloadWebContent();
+
+	double elapsed_seconds = std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count(), 0.001);
+
+	DDL::Utils::Network::SetResponseSource(nullptr);
+
+	DDLRequestStatistics statistics = DDL::Utils::Network::GetRequestStatistics();
+	std::sort(statistics.latencies_ms.begin(), statistics.latencies_ms.end());
+
+	int64_t served_requests = 0;
+	int64_t injected_errors = 0;
+	forum.GetRequestCounts(&served_requests, &injected_errors);
+
+	char rates[128] = { 0 };
+	sprintf_s(rates, sizeof(rates), "%.1f requests/sec, %.2f MB/sec, latency p50 %.1fms, p99 %.1fms",
+		statistics.request_count / elapsed_seconds, (statistics.received_bytes / (1024.0 * 1024.0)) / elapsed_seconds,
+		get_latency_percentile(&statistics.latencies_ms, 0.50), get_latency_percentile(&statistics.latencies_ms, 0.99));
+
+	DDL::Logger::LogEvent("benchmark finished in " + std::to_string((int)elapsed_seconds) + "s: " + std::to_string(statistics.request_count)
+		+ " requests (" + std::to_string(statistics.error_count) + " failed, " + std::to_string(injected_errors) + " by injected errors), "
+		+ std::to_string(statistics.received_bytes / 1024) + " KB received");
+	DDL::Logger::LogEvent("benchmark results: " + std::string(rates));
+
+	return DDLResult::Success_OK;
+}
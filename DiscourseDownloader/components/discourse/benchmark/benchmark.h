@@ -0,0 +1,151 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+
+#include "components/diagnostics/errors/errors.h"
+
+#define MOCK_FORUM_URL std::string("http://benchmark.invalid")
+#define MOCK_FORUM_TOPIC_PAGE_SIZE 30     //!< Number of topics in each page of a category's topic list.
+#define MOCK_FORUM_TOPIC_POST_COUNT 20    //!< Number of posts included with a topic, matching Discourse.
+#define MOCK_FORUM_DIRECTORY_PAGE_SIZE 50 //!< Number of users in each page of the user directory.
+#define MOCK_FORUM_USER_ACTIONS_PAGE_SIZE 30
+#define MOCK_FORUM_LETTER_AVATAR_PERCENT 50 //!< Share of users with a default letter avatar, which are shared between users.
+
+struct DDLNetworkRequest;
+
+/**
+* Structure describing the size and behaviour of a synthetic forum.
+*/
+struct DDLMockForumConfig
+{
+	int category_count = 4;
+	int topics_per_category = 250;
+	int posts_per_topic = 40;   //!< The average number of posts in a topic. Each topic has between 1 and twice this many posts.
+	int user_count = 500;
+	int tag_count = 20;
+	int group_count = 5;
+	int post_request_limit = 0; //!< The most posts returned by a single `posts.json` request, or 0 for no limit.
+
+	int latency_ms = 50;        //!< The time taken for every response to arrive.
+	int latency_jitter_ms = 50; //!< The most extra time, picked at random, added to each response.
+	int rate_limit_percent = 0; //!< The percentage of requests answered with http 429.
+	int server_error_percent = 0; //!< The percentage of requests answered with http 502.
+	uint32_t seed = 1; //!< Seed for latency and error injection. The forum contents are the same regardless of the seed.
+};
+
+/**
+* Class which generates the responses of a synthetic Discourse forum, used in place of the network to benchmark the
+* downloader without sending any requests to a real forum.
+*
+* Every response is generated on request from the forum's configuration, so that a forum of any size can be served
+* without holding it in memory. The forum only answers the endpoints the downloader uses, with the fields the downloader
+* reads (along with a few which make the responses a realistic size). Any other request is answered with http 404.
+*/
+class DDLMockForum
+{
+private:
+	DDLMockForumConfig config = DDLMockForumConfig();
+	std::mt19937 random = std::mt19937(); //!< Used for latency and error injection only.
+	std::mutex random_mutex;
+
+	int64_t served_requests = 0; //!< The number of requests answered with http 200.
+	int64_t injected_errors = 0; //!< The number of requests answered with an injected error.
+
+	/**
+	* Retrieves the number of posts in a topic.
+	*/
+	int get_post_count(int topic_id);
+
+	/**
+	* Retrieves the ID of a post, from its topic and position within the topic.
+	*/
+	int get_post_id(int topic_id, int post_index);
+
+	/**
+	* Retrieves the username of a user, from their index within the user directory.
+	*/
+	std::string get_username(int user_index);
+
+	/**
+	* Finds a user from their username.
+	*
+	* @returns The index of the user, or -1 if there is no such user.
+	*/
+	int find_user(std::string_view username);
+
+	/**
+	* Builds a response for a request path.
+	*
+	* @param path - The request path, including the query string.
+	* @param response - Pointer to a string which will be set to the response body.
+	*
+	* @returns The http code of the response.
+	*/
+	int route_request(std::string_view path, std::string* response);
+
+	std::string build_category_list();
+	std::string build_category_info(int category_id);
+	std::string build_topic_list(int category_id, int page);
+	std::string build_topic(int topic_id);
+	std::string build_post_chunk(int topic_id, std::string_view query);
+	std::string build_directory_page(int page);
+	std::string build_user(int user_index);
+	std::string build_user_badges();
+	std::string build_user_actions(int user_index, int offset);
+	std::string build_avatar(int size, size_t url_hash);
+	std::string build_tag_list();
+	std::string build_tag_topic_list(int page);
+	std::string build_group_list(int page);
+	std::string build_group(int group_index);
+	std::string build_site_info();
+
+public:
+	/**
+	* Prepares a new synthetic forum.
+	*
+	* @param _config - The size and behaviour of the forum.
+	*/
+	DDLMockForum(DDLMockForumConfig _config);
+
+	/**
+	* Answers a request. Intended to be used as the network layer's response source.
+	*
+	* @param request - The request to answer.
+	*
+	* @returns The number of milliseconds the response should take to arrive.
+	*/
+	int Respond(DDLNetworkRequest* request);
+
+	/**
+	* Retrieves the total number of topics in the forum.
+	*/
+	int GetTopicCount();
+
+	/**
+	* Retrieves the number of requests answered with http 200, along with the number answered with an injected error.
+	*/
+	void GetRequestCounts(int64_t* served, int64_t* errors);
+};
+
+/**
+* Namespace containing the benchmark, which measures the download pipeline against a synthetic forum.
+*/
+namespace DDL::Discourse::Benchmark
+{
+	/**
+	* Downloads a synthetic forum, described by the `(benchmark)` section of website.cfg, into the benchmark directory
+	* and reports the request rate, data rate and request latency. The benchmark directory is cleared first, so that
+	* every run starts from nothing.
+	*
+	* The networking, download and forum settings from website.cfg are used as usual, other than the website url and
+	* site directory, and anything which would carry progress over from an earlier run (resuming, incremental syncs and
+	* skipping existing content).
+	*
+	* @returns #DDLResult::Success_OK if the benchmark ran, otherwise returns an error code.
+	*/
+	DDLResult RunBenchmark();
+}
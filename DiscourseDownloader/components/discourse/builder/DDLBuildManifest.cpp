@@ -0,0 +1,99 @@
+#include "builder.h"
+
+#include <filesystem>
+#include <charconv>
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/utils/io/io.h"
+
+int DDLBuildManifest::Load(std::string filename)
+{
+	previous_pages.clear();
+
+	if (!DDL::Utils::IO::IsFile(filename))
+	{
+		return 0;
+	}
+
+	// Each line is "<input hash>,<post count>,<page path>", with the path last as it is the only field which could contain a comma
+	for (std::string& line : DDL::Utils::IO::GetFileContentsAsLines(filename))
+	{
+		size_t hash_separator = line.find(',');
+		size_t count_separator = (hash_separator == std::string::npos) ? std::string::npos : line.find(',', hash_separator + 1);
+
+		if (hash_separator != 8 || count_separator == std::string::npos || count_separator + 1 >= line.length())
+		{
+			continue;
+		}
+
+		DDLPageManifestEntry entry = DDLPageManifestEntry();
+
+		std::from_chars_result hash_result = std::from_chars(line.data(), line.data() + hash_separator, entry.input_hash, 16);
+		std::from_chars_result count_result = std::from_chars(line.data() + hash_separator + 1, line.data() + count_separator, entry.post_count);
+
+		if (hash_result.ec != std::errc() || hash_result.ptr != line.data() + hash_separator
+			|| count_result.ec != std::errc() || count_result.ptr != line.data() + count_separator)
+		{
+			continue;
+		}
+
+		previous_pages[line.substr(count_separator + 1)] = entry;
+	}
+
+	return previous_pages.size();
+}
+
+bool DDLBuildManifest::Save(std::string filename)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(current_pages_mutex);
+
+	std::string manifest_contents = "";
+	manifest_contents.reserve(current_pages.size() * 64);
+
+	char hash[9] = { 0 };
+
+	for (std::pair<const std::string, DDLPageManifestEntry>& page : current_pages)
+	{
+		sprintf_s(hash, sizeof(hash), "%08x", page.second.input_hash);
+
+		manifest_contents += hash;
+		manifest_contents += "," + std::to_string(page.second.post_count) + "," + page.first + "\n";
+	}
+
+	// Swap the new manifest in whole, so an interrupted save can't leave a manifest describing pages that were never written
+	if (!DDL::Utils::IO::CreateNewFile(filename + ".tmp", manifest_contents))
+	{
+		DDL::Logger::LogEvent("failed to save html build manifest - could not create '" + filename + ".tmp'", DDLLogLevel::Error);
+		return false;
+	}
+
+	std::error_code rename_error;
+	std::filesystem::rename(filename + ".tmp", filename, rename_error);
+
+	if (rename_error)
+	{
+		DDL::Logger::LogEvent("failed to save html build manifest - could not replace '" + filename + "'", DDLLogLevel::Error);
+		return false;
+	}
+
+	return true;
+}
+
+bool DDLBuildManifest::IsUnchanged(std::string page, uint32_t input_hash, DDLPageManifestEntry* previous)
+{
+	std::unordered_map<std::string, DDLPageManifestEntry>::iterator entry = previous_pages.find(page);
+
+	if (entry == previous_pages.end() || entry->second.input_hash != input_hash)
+	{
+		return false;
+	}
+
+	*previous = entry->second;
+	return true;
+}
+
+void DDLBuildManifest::Record(std::string page, DDLPageManifestEntry entry)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(current_pages_mutex);
+	current_pages[page] = entry;
+}
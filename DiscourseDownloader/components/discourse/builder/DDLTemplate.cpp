@@ -0,0 +1,124 @@
+#include "builder.h"
+
+#include <algorithm>
+
+DDLTemplate::DDLTemplate()
+{
+
+}
+
+DDLTemplate::DDLTemplate(std::string _source, std::vector<std::string> slot_names)
+{
+	source = _source;
+	slot_use_counts.resize(slot_names.size());
+
+	size_t literal_start = 0;
+	size_t marker_start = source.find("<!--");
+
+	while (marker_start != std::string::npos)
+	{
+		size_t marker_end = source.find("-->", marker_start + 4);
+
+		if (marker_end == std::string::npos)
+		{
+			break;
+		}
+
+		std::string_view marker_name = std::string_view(source).substr(marker_start + 4, marker_end - (marker_start + 4));
+
+		while (marker_name.length() > 0 && marker_name.front() == ' ')
+		{
+			marker_name.remove_prefix(1);
+		}
+
+		while (marker_name.length() > 0 && marker_name.back() == ' ')
+		{
+			marker_name.remove_suffix(1);
+		}
+
+		int slot = -1;
+
+		for (int i = 0; i < slot_names.size(); i++)
+		{
+			if (marker_name == slot_names[i])
+			{
+				slot = i;
+				break;
+			}
+		}
+
+		if (slot != -1)
+		{
+			if (marker_start > literal_start)
+			{
+				DDLTemplateSegment literal = DDLTemplateSegment();
+				literal.offset = literal_start;
+				literal.length = marker_start - literal_start;
+
+				segments.push_back(literal);
+				literal_length += literal.length;
+			}
+
+			DDLTemplateSegment slot_segment = DDLTemplateSegment();
+			slot_segment.slot = slot;
+
+			segments.push_back(slot_segment);
+			slot_use_counts[slot]++;
+
+			literal_start = marker_end + 3;
+		}
+
+		marker_start = source.find("<!--", marker_end + 3);
+	}
+
+	if (literal_start < source.length())
+	{
+		DDLTemplateSegment literal = DDLTemplateSegment();
+		literal.offset = literal_start;
+		literal.length = source.length() - literal_start;
+
+		segments.push_back(literal);
+		literal_length += literal.length;
+	}
+}
+
+void DDLTemplate::Render(std::string* output, std::initializer_list<std::string_view> values)
+{
+	const std::string_view* slot_values = values.begin();
+	int slot_count = values.size();
+
+	size_t rendered_length = literal_length;
+
+	for (int i = 0; i < slot_count && i < slot_use_counts.size(); i++)
+	{
+		rendered_length += slot_values[i].length() * slot_use_counts[i];
+	}
+
+	// Grow geometrically, as fragments are rendered into the same buffer many times over
+	if (output->capacity() < output->length() + rendered_length)
+	{
+		output->reserve(std::max(output->length() + rendered_length, output->capacity() * 2));
+	}
+
+	for (DDLTemplateSegment& segment : segments)
+	{
+		if (segment.slot == -1)
+		{
+			output->append(source, segment.offset, segment.length);
+		}
+		else if (segment.slot < slot_count)
+		{
+			output->append(slot_values[segment.slot]);
+		}
+	}
+}
+
+int DDLTemplate::GetSlotUseCount(int slot)
+{
+	if (slot < 0 || slot >= slot_use_counts.size())
+	{
+		return 0;
+	}
+
+	return slot_use_counts[slot];
+}
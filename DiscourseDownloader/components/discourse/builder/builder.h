@@ -0,0 +1,267 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <initializer_list>
+#include <stdint.h>
+
+#define HTML_TEMPLATE_ROOT std::string("./templates/")
+#define HTML_TOPIC_PAGE_FORMAT std::string("<HTML_ROOT>/t/<TOPIC_SLUG>/<TOPIC_ID>/index.html")
+#define HTML_CATEGORY_PAGE_FORMAT std::string("<HTML_ROOT>/category_<CAT_ID>.html")
+#define HTML_INDEX_PAGE_FORMAT std::string("<HTML_ROOT>/index.html")
+#define HTML_BUILD_MANIFEST_FILENAME std::string("/html_manifest")
+
+#define HTML_POST_FRAGMENT std::string("<div class=\"post\" id=\"post_<!-- POST_NUMBER -->\">\n" \
+	"    <div class=\"post-header\"><span class=\"post-author\"><!-- POST_AUTHOR --></span><span class=\"post-date\"><!-- POST_DATE --></span></div>\n" \
+	"    <div class=\"post-body\"><!-- POST_BODY --></div>\n" \
+	"</div>\n")
+#define HTML_LIST_ROW_FRAGMENT std::string("<div class=\"topic-row\">" \
+	"<span class=\"topic-name\"><a href=\"<!-- TOPIC_LINK -->\"><!-- TOPIC_NAME --></a></span>" \
+	"<span class=\"category-name\"><a href=\"<!-- CATEGORY_LINK -->\"><!-- CATEGORY_NAME --></a></span>" \
+	"<span class=\"post-count\"><!-- POST_COUNT --></span>" \
+	"</div>\n")
+
+/**
+* Structure representing one piece of a compiled template - either a run of literal text, or a slot.
+*/
+struct DDLTemplateSegment
+{
+	size_t offset = 0; //!< The offset of the literal text within the template source.
+	size_t length = 0; //!< The length of the literal text.
+	int slot = -1;     //!< The slot to insert, or -1 if this segment is literal text.
+};
+
+/**
+* Class representing a page template, compiled once into a list of literal segments and slots.
+*
+* Slots are written in the template as `<!-- NAME -->` markers. When compiling, the caller lists the slot names it
+* will provide, in order, and each marker matching one of those names becomes a slot. Any other comment is kept as
+* literal text. Rendering then appends every segment to the output in a single pass, rather than searching the
+* whole page once per placeholder.
+*/
+class DDLTemplate
+{
+private:
+	std::string source = ""; //!< The template source, which literal segments point into.
+	std::vector<DDLTemplateSegment> segments = std::vector<DDLTemplateSegment>(); //!< The compiled segments, in order.
+	std::vector<int> slot_use_counts = std::vector<int>(); //!< The number of times each slot appears in the template.
+	size_t literal_length = 0; //!< The total length of every literal segment.
+
+public:
+	DDLTemplate();
+
+	/**
+	* Compiles a template.
+	*
+	* @param _source - The template source.
+	* @param slot_names - The names of the slots that will be provided when rendering, in the order they will be provided.
+	*/
+	DDLTemplate(std::string _source, std::vector<std::string> slot_names);
+
+	/**
+	* Renders the template, appending the result to the end of a buffer.
+	*
+	* @param output - The buffer to append to. Enough space for the whole page is reserved before anything is appended.
+	* @param values - The value of each slot, in the same order as the slot names given when compiling.
+	*/
+	void Render(std::string* output, std::initializer_list<std::string_view> values);
+
+	/**
+	* Retrieves the number of times a slot appears in the template.
+	*
+	* @param slot - The index of the slot.
+	*
+	* @returns The number of times the slot appears, or 0 if the template does not use it.
+	*/
+	int GetSlotUseCount(int slot);
+};
+
+/**
+* Enumeration of the outcomes of rendering a page.
+*/
+enum DDLPageResult
+{
+	Page_Written = 0,    //!< The page was rendered and written.
+	Page_Unchanged = 1,  //!< The page's inputs have not changed since it was last written, so it was left alone.
+	Page_Failed = -1,    //!< The page could not be rendered.
+};
+
+/**
+* Structure representing what a page was last built from.
+*/
+struct DDLPageManifestEntry
+{
+	uint32_t input_hash = 0; //!< Checksum of every input the page was rendered from.
+	int post_count = 0;      //!< The number of posts on the page, so a skipped topic can still be listed on its category page.
+};
+
+/**
+* Class representing the manifest of every page in the HTML archive, and the inputs it was last built from.
+*
+* The manifest from the previous build is read before the build starts, and is only read from while it runs. Every
+* page that is written or found to be unchanged is recorded into a new manifest, which replaces the previous one once
+* the build finishes. Pages which fail to render are not recorded, so they are always retried by the next build.
+*/
+class DDLBuildManifest
+{
+private:
+	std::unordered_map<std::string, DDLPageManifestEntry> previous_pages = std::unordered_map<std::string, DDLPageManifestEntry>(); //!< Pages from the previous build, by path relative to the HTML root.
+	std::unordered_map<std::string, DDLPageManifestEntry> current_pages = std::unordered_map<std::string, DDLPageManifestEntry>(); //!< Pages from this build, by path relative to the HTML root.
+	std::mutex current_pages_mutex; //!< Mutex protecting #current_pages.
+
+public:
+	/**
+	* Loads the manifest from the previous build.
+	*
+	* @param filename - The path to the manifest file.
+	*
+	* @returns The number of pages in the manifest, or 0 if there was no previous build.
+	*/
+	int Load(std::string filename);
+
+	/**
+	* Saves every page recorded during this build, replacing the previous manifest.
+	*
+	* @param filename - The path to the manifest file.
+	*
+	* @returns `true` if the manifest was saved, otherwise returns `false`.
+	*/
+	bool Save(std::string filename);
+
+	/**
+	* Checks whether a page was built from the same inputs during the previous build.
+	*
+	* @param page - The path of the page, relative to the HTML root.
+	* @param input_hash - Checksum of the page's current inputs.
+	* @param previous - Pointer to an entry, which the page's previous details will be written to if it is unchanged.
+	*
+	* @returns `true` if the page's inputs are unchanged, otherwise returns `false`.
+	*/
+	bool IsUnchanged(std::string page, uint32_t input_hash, DDLPageManifestEntry* previous);
+
+	/**
+	* Records a page into the new manifest. Safe to call from multiple threads at once.
+	*
+	* @param page - The path of the page, relative to the HTML root.
+	* @param entry - The inputs the page was built from.
+	*/
+	void Record(std::string page, DDLPageManifestEntry entry);
+};
+
+/**
+* Structure containing everything shared by every page rendered during a build. Not modified once the build starts,
+* so it can be read from any thread.
+*/
+struct DDLBuildContext
+{
+	std::string html_root = ""; //!< The directory that pages are written to.
+	DDLTemplate main_template = DDLTemplate(); //!< The template used for the index and category pages.
+	DDLTemplate topic_template = DDLTemplate(); //!< The template used for topic pages.
+	DDLTemplate post_fragment = DDLTemplate(); //!< The template used for each post on a topic page.
+	DDLTemplate list_row_fragment = DDLTemplate(); //!< The template used for each row on the index and category pages.
+	std::string site_title = ""; //!< The title of the archived site, already escaped.
+	std::string archive_blurb = ""; //!< The notice shown at the top of every page.
+	uint32_t template_hash = 0; //!< Checksum of the topic templates, so that changing them rebuilds every topic page.
+	DDLBuildManifest* manifest = nullptr; //!< The manifest of previously built pages, used to skip unchanged pages.
+};
+
+/**
+* Structure containing the details of a rendered topic which are needed to list it on its category page.
+*/
+struct DDLTopicSummary
+{
+	int topic_id = -1;
+	int category_id = -1;
+	int post_count = 0;
+
+	std::string title = "";          //!< The topic title, already escaped.
+	std::string slug = "";           //!< The topic slug, used to build the page path.
+	std::string last_posted_at = ""; //!< Timestamp of the last post, used to sort the category page.
+};
+
+/**
+* Structure tracking a single category while its pages are being built.
+*/
+struct DDLCategoryBuildState
+{
+	int category_id = -1;
+	std::string name = ""; //!< The category name, already escaped.
+
+	std::mutex topics_mutex; //!< Mutex protecting #topics, which is filled in by topic tasks.
+	std::vector<DDLTopicSummary> topics = std::vector<DDLTopicSummary>(); //!< Summaries of every rendered topic in this category.
+};
+
+/**
+* Namespace containing functions used to render the pages of the HTML archive website.
+*
+* Every render function is safe to call from multiple threads at once, as long as each call works on a different page.
+*/
+namespace DDL::Discourse::Builder
+{
+	/**
+	* Loads the page templates and site details needed to render pages.
+	*
+	* @param context - Pointer to the build context to fill in.
+	*
+	* @returns `true` if every template was loaded, otherwise returns `false`.
+	*/
+	bool LoadBuildContext(DDLBuildContext* context);
+
+	/**
+	* Loads the details of every downloaded category.
+	*
+	* @returns A list of categories, which the caller is responsible for deleting.
+	*/
+	std::vector<DDLCategoryBuildState*> LoadCategories();
+
+	/**
+	* Builds the path that a topic page is written to.
+	*
+	* @param html_root - The HTML root directory.
+	* @param topic - The topic.
+	*
+	* @returns The path to the topic page.
+	*/
+	std::string GetTopicPagePath(std::string html_root, DDLTopicSummary* topic);
+
+	/**
+	* Renders a topic page, including all of its posts.
+	*
+	* Whether the page is up to date is decided from the topic JSON and the storage stamp of each post, so the posts
+	* themselves are only loaded if the page needs to be rendered.
+	*
+	* @param context - The build context.
+	* @param category_id - The ID of the category the topic belongs to.
+	* @param topic_id - The ID of the topic.
+	* @param summary - Pointer to a summary, which the topic's details will be written to.
+	*
+	* @returns #DDLPageResult::Page_Written if the page was written, #DDLPageResult::Page_Unchanged if the topic and its
+	* posts have not changed since the page was last written, otherwise returns #DDLPageResult::Page_Failed.
+	*/
+	DDLPageResult RenderTopicPage(DDLBuildContext* context, int category_id, int topic_id, DDLTopicSummary* summary);
+
+	/**
+	* Renders a category page, listing every topic in the category. The category's topics must have been rendered first.
+	*
+	* @param context - The build context.
+	* @param category - The category.
+	*
+	* @returns #DDLPageResult::Page_Written if the page was written, #DDLPageResult::Page_Unchanged if it would be
+	* identical to the page already written, otherwise returns #DDLPageResult::Page_Failed.
+	*/
+	DDLPageResult RenderCategoryPage(DDLBuildContext* context, DDLCategoryBuildState* category);
+
+	/**
+	* Renders the index page, listing every category.
+	*
+	* @param context - The build context.
+	* @param categories - The categories.
+	*
+	* @returns #DDLPageResult::Page_Written if the page was written, #DDLPageResult::Page_Unchanged if it would be
+	* identical to the page already written, otherwise returns #DDLPageResult::Page_Failed.
+	*/
+	DDLPageResult RenderIndexPage(DDLBuildContext* context, std::vector<DDLCategoryBuildState*>* categories);
+}
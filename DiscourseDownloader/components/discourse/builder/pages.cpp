@@ -0,0 +1,372 @@
+#include "builder.h"
+
+#include <filesystem>
+#include <algorithm>
+#include <charconv>
+
+#include "components/3rdparty/rapidjson/document.h"
+
+#include "components/discourse/discourse.h"
+#include "components/discourse/storage/storage.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+#include "components/utils/converters/converters.h"
+#include "components/utils/hash/hash.h"
+
+/**
+* Retrieves a string member from a JSON object without copying it, or an empty view if it is missing or not a string.
+*/
+std::string_view get_json_view(rapidjson::Value& object, const char* name)
+{
+	if (!object.HasMember(name) || !object[name].IsString())
+	{
+		return std::string_view();
+	}
+
+	return std::string_view(object[name].GetString(), object[name].GetStringLength());
+}
+
+/**
+* Writes a number into a buffer, without allocating.
+*/
+std::string_view format_number(char (&buffer)[16], int value)
+{
+	std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+	return std::string_view(buffer, result.ptr - buffer);
+}
+
+// Each worker renders into its own buffers, which keep their capacity from one page to the next
+thread_local std::string page_buffer = "";
+thread_local std::string list_buffer = "";
+thread_local std::string escape_buffer = "";
+thread_local std::string post_buffer = "";
+
+bool DDL::Discourse::Builder::LoadBuildContext(DDLBuildContext* context)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!DDL::Utils::IO::IsFile(HTML_TEMPLATE_ROOT + "main.html") || !DDL::Utils::IO::IsFile(HTML_TEMPLATE_ROOT + "topic.html"))
+	{
+		DDL::Logger::LogEvent("could not find html templates in '" + HTML_TEMPLATE_ROOT + "', html archive will NOT be built!", DDLLogLevel::Error);
+		return false;
+	}
+
+	context->html_root = config->html_path;
+
+	// Slot names must be listed in the same order that their values are passed to Render
+	context->main_template = DDLTemplate(DDL::Utils::IO::GetFileContentsAsString(HTML_TEMPLATE_ROOT + "main.html"),
+		{ "JUST_SITE_TITLE", "ARCHIVE_BLURB", "TITLE", "TOPIC_LIST" });
+	std::string topic_template = DDL::Utils::IO::GetFileContentsAsString(HTML_TEMPLATE_ROOT + "topic.html");
+
+	context->topic_template = DDLTemplate(topic_template, { "JUST_SITE_TITLE", "ARCHIVE_BLURB", "TOPIC_TITLE", "POST_LIST" });
+	context->post_fragment = DDLTemplate(HTML_POST_FRAGMENT, { "POST_NUMBER", "POST_AUTHOR", "POST_DATE", "POST_BODY" });
+	context->list_row_fragment = DDLTemplate(HTML_LIST_ROW_FRAGMENT, { "TOPIC_LINK", "TOPIC_NAME", "CATEGORY_LINK", "CATEGORY_NAME", "POST_COUNT" });
+
+	if (context->main_template.GetSlotUseCount(3) == 0 || context->topic_template.GetSlotUseCount(3) == 0)
+	{
+		DDL::Logger::LogEvent("html templates are missing their <!-- TOPIC_LIST --> or <!-- POST_LIST --> markers, pages will not list any content",
+			DDLLogLevel::Warning);
+	}
+
+	std::string site_title = config->website_url;
+	{
+		site_title = DDL::Utils::String::Replace(site_title, "https://", "");
+		site_title = DDL::Utils::String::Replace(site_title, "http://", "");
+	}
+
+	context->site_title = DDL::Utils::String::EscapeHTML(site_title);
+	context->archive_blurb = "This is an archived copy of <a href=\"" + DDL::Utils::String::EscapeHTML(config->website_url) + "\">"
+		+ context->site_title + "</a>.";
+
+	// Everything a topic page contains other than the topic itself, so that changing any of it rebuilds every topic page
+	context->template_hash = DDL::Utils::Hash::CRC32(topic_template.data(), topic_template.length());
+	context->template_hash = DDL::Utils::Hash::CRC32(HTML_POST_FRAGMENT.data(), HTML_POST_FRAGMENT.length(), context->template_hash);
+	context->template_hash = DDL::Utils::Hash::CRC32(context->archive_blurb.data(), context->archive_blurb.length(), context->template_hash);
+
+	return true;
+}
+
+std::vector<DDLCategoryBuildState*> DDL::Discourse::Builder::LoadCategories()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	std::vector<DDLCategoryBuildState*> categories = std::vector<DDLCategoryBuildState*>();
+	std::string categories_root = config->json_path + "/c/";
+
+	if (!DDL::Utils::IO::IsDirectory(categories_root))
+	{
+		return categories;
+	}
+
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(categories_root, error))
+	{
+		std::string directory_name = entry.path().filename().string();
+
+		if (!entry.is_directory() || directory_name.length() == 0 || directory_name.find_first_not_of("0123456789") != std::string::npos)
+		{
+			continue;
+		}
+
+		std::string show_path = categories_root + directory_name + "/show.json";
+
+		if (!DDL::Utils::IO::IsFile(show_path))
+		{
+			continue;
+		}
+
+		rapidjson::Document show_json = rapidjson::Document();
+		show_json.Parse(DDL::Utils::IO::GetFileContentsAsString(show_path).c_str());
+
+		if (show_json.HasParseError() || !show_json.IsObject())
+		{
+			DDL::Logger::LogEvent("could not parse '" + show_path + "', category will be skipped", DDLLogLevel::Warning);
+			continue;
+		}
+
+		DDLCategoryBuildState* category = new DDLCategoryBuildState();
+		category->category_id = DDL::Converters::StringToInt(directory_name);
+		category->name = DDL::Utils::String::EscapeHTML(std::string(get_json_view(show_json, "name")));
+
+		categories.push_back(category);
+	}
+
+	std::sort(categories.begin(), categories.end(), [](DDLCategoryBuildState* a, DDLCategoryBuildState* b)
+	{
+		return a->category_id < b->category_id;
+	});
+
+	return categories;
+}
+
+std::string DDL::Discourse::Builder::GetTopicPagePath(std::string html_root, DDLTopicSummary* topic)
+{
+	std::string page_path = HTML_TOPIC_PAGE_FORMAT;
+	{
+		page_path = DDL::Utils::String::Replace(page_path, "<HTML_ROOT>", html_root);
+		page_path = DDL::Utils::String::Replace(page_path, "<TOPIC_SLUG>", topic->slug);
+		page_path = DDL::Utils::String::Replace(page_path, "<TOPIC_ID>", std::to_string(topic->topic_id));
+	}
+
+	return page_path;
+}
+
+DDLPageResult DDL::Discourse::Builder::RenderTopicPage(DDLBuildContext* context, int category_id, int topic_id, DDLTopicSummary* summary)
+{
+	std::string topic_data = "";
+
+	if (!DDL::Discourse::Storage::LoadTopic(category_id, topic_id, &topic_data))
+	{
+		DDL::Logger::LogEvent("could not load topic " + std::to_string(topic_id) + ", topic page will NOT be built", DDLLogLevel::Error);
+		return DDLPageResult::Page_Failed;
+	}
+
+	// Parsing in place modifies the data, so it has to be hashed first
+	uint32_t input_hash = DDL::Utils::Hash::CRC32(topic_data.data(), topic_data.length(), context->template_hash);
+
+	rapidjson::Document topic_json = rapidjson::Document();
+	topic_json.ParseInsitu(topic_data.data());
+
+	if (topic_json.HasParseError() || !topic_json.IsObject() || !topic_json.HasMember("post_stream") || !topic_json["post_stream"].HasMember("stream")
+		|| !topic_json["post_stream"]["stream"].IsArray())
+	{
+		DDL::Logger::LogEvent("could not parse topic " + std::to_string(topic_id) + ", topic page will NOT be built", DDLLogLevel::Error);
+		return DDLPageResult::Page_Failed;
+	}
+
+	summary->topic_id = topic_id;
+	summary->category_id = category_id;
+	summary->title = DDL::Utils::String::EscapeHTML(std::string(get_json_view(topic_json, "title")));
+	summary->slug = get_json_view(topic_json, "slug");
+	summary->last_posted_at = get_json_view(topic_json, "last_posted_at");
+
+	// Slugs only contain url-safe characters, but can be empty (ie, for titles written entirely in non-latin scripts)
+	if (summary->slug.length() == 0 || summary->slug.find_first_of("/\\.") != std::string::npos)
+	{
+		summary->slug = "topic";
+	}
+
+	rapidjson::Value& post_stream = topic_json["post_stream"]["stream"];
+
+	// Posts are only loaded once the page is known to need rendering, so the check uses their stamps rather than their contents
+	for (rapidjson::SizeType i = 0; i < post_stream.Size(); i++)
+	{
+		uint64_t post_stamp = 0;
+
+		if (!post_stream[i].IsInt() || !DDL::Discourse::Storage::GetPostStamp(category_id, topic_id, post_stream[i].GetInt(), &post_stamp))
+		{
+			post_stamp = 0;
+		}
+
+		input_hash = DDL::Utils::Hash::CRC32((const char*)&post_stamp, sizeof(post_stamp), input_hash);
+	}
+
+	std::string page_path = GetTopicPagePath(context->html_root, summary);
+	std::string manifest_path = GetTopicPagePath(".", summary).substr(2);
+
+	DDLPageManifestEntry manifest_entry = DDLPageManifestEntry();
+
+	if (context->manifest->IsUnchanged(manifest_path, input_hash, &manifest_entry) && DDL::Utils::IO::IsFile(page_path))
+	{
+		summary->post_count = manifest_entry.post_count;
+		context->manifest->Record(manifest_path, manifest_entry);
+
+		return DDLPageResult::Page_Unchanged;
+	}
+
+	char number_buffer[16] = { 0 };
+
+	list_buffer.clear();
+
+	for (rapidjson::SizeType i = 0; i < post_stream.Size(); i++)
+	{
+		if (!post_stream[i].IsInt() || !DDL::Discourse::Storage::LoadPost(category_id, topic_id, post_stream[i].GetInt(), &post_buffer)
+			|| post_buffer.length() == 0)
+		{
+			continue;
+		}
+
+		rapidjson::Document post_json = rapidjson::Document();
+		post_json.ParseInsitu(post_buffer.data());
+
+		if (post_json.HasParseError() || !post_json.IsObject() || !post_json.HasMember("post_number") || !post_json["post_number"].IsInt())
+		{
+			continue;
+		}
+
+		escape_buffer.clear();
+		DDL::Utils::String::AppendEscapedHTML(&escape_buffer, get_json_view(post_json, "username"));
+		size_t author_length = escape_buffer.length();
+		DDL::Utils::String::AppendEscapedHTML(&escape_buffer, get_json_view(post_json, "created_at"));
+
+		context->post_fragment.Render(&list_buffer, {
+			format_number(number_buffer, post_json["post_number"].GetInt()),
+			std::string_view(escape_buffer).substr(0, author_length),
+			std::string_view(escape_buffer).substr(author_length),
+			get_json_view(post_json, "cooked")
+		});
+
+		summary->post_count++;
+	}
+
+	page_buffer.clear();
+	context->topic_template.Render(&page_buffer, { context->site_title, context->archive_blurb, summary->title, list_buffer });
+
+	DDL::Utils::IO::ValidatePath(page_path.substr(0, page_path.find_last_of('/') + 1));
+
+	if (!DDL::Utils::IO::CreateNewFile(page_path, page_buffer.data(), page_buffer.length()))
+	{
+		return DDLPageResult::Page_Failed;
+	}
+
+	manifest_entry.input_hash = input_hash;
+	manifest_entry.post_count = summary->post_count;
+	context->manifest->Record(manifest_path, manifest_entry);
+
+	return DDLPageResult::Page_Written;
+}
+
+/**
+* Writes a rendered listing page, unless it is identical to the page written by the previous build.
+*
+* Listing pages are built entirely from data that is already in memory, so rather than tracking their inputs, the
+* rendered page itself is hashed.
+*/
+DDLPageResult write_listing_page(DDLBuildContext* context, std::string page_path, std::string manifest_path)
+{
+	DDLPageManifestEntry manifest_entry = DDLPageManifestEntry();
+	uint32_t page_hash = DDL::Utils::Hash::CRC32(page_buffer.data(), page_buffer.length());
+
+	if (context->manifest->IsUnchanged(manifest_path, page_hash, &manifest_entry) && DDL::Utils::IO::IsFile(page_path))
+	{
+		context->manifest->Record(manifest_path, manifest_entry);
+		return DDLPageResult::Page_Unchanged;
+	}
+
+	if (!DDL::Utils::IO::CreateNewFile(page_path, page_buffer.data(), page_buffer.length()))
+	{
+		return DDLPageResult::Page_Failed;
+	}
+
+	manifest_entry.input_hash = page_hash;
+	context->manifest->Record(manifest_path, manifest_entry);
+
+	return DDLPageResult::Page_Written;
+}
+
+DDLPageResult DDL::Discourse::Builder::RenderCategoryPage(DDLBuildContext* context, DDLCategoryBuildState* category)
+{
+	std::string category_link = "category_" + std::to_string(category->category_id) + ".html";
+	char number_buffer[16] = { 0 };
+
+	list_buffer.clear();
+
+	std::sort(category->topics.begin(), category->topics.end(), [](DDLTopicSummary& a, DDLTopicSummary& b)
+	{
+		// Topics are rendered in no particular order, so ties are broken by ID to keep the page identical between builds
+		if (a.last_posted_at != b.last_posted_at)
+		{
+			return a.last_posted_at > b.last_posted_at;
+		}
+
+		return a.topic_id > b.topic_id;
+	});
+
+	for (DDLTopicSummary& topic : category->topics)
+	{
+		std::string topic_link = GetTopicPagePath(".", &topic).substr(2);
+
+		context->list_row_fragment.Render(&list_buffer, {
+			topic_link, topic.title, category_link, category->name, format_number(number_buffer, topic.post_count)
+		});
+	}
+
+	std::string page_title = "<title>" + category->name + " - " + context->site_title + "</title>";
+
+	page_buffer.clear();
+	context->main_template.Render(&page_buffer, { context->site_title, context->archive_blurb, page_title, list_buffer });
+
+	std::string page_path = HTML_CATEGORY_PAGE_FORMAT;
+	{
+		page_path = DDL::Utils::String::Replace(page_path, "<HTML_ROOT>", context->html_root);
+		page_path = DDL::Utils::String::Replace(page_path, "<CAT_ID>", std::to_string(category->category_id));
+	}
+
+	return write_listing_page(context, page_path, category_link);
+}
+
+DDLPageResult DDL::Discourse::Builder::RenderIndexPage(DDLBuildContext* context, std::vector<DDLCategoryBuildState*>* categories)
+{
+	char number_buffer[16] = { 0 };
+
+	list_buffer.clear();
+
+	for (DDLCategoryBuildState* category : *categories)
+	{
+		std::string category_link = "category_" + std::to_string(category->category_id) + ".html";
+		int post_count = 0;
+
+		for (DDLTopicSummary& topic : category->topics)
+		{
+			post_count += topic.post_count;
+		}
+
+		std::string topic_count = std::to_string(category->topics.size()) + " topics";
+
+		context->list_row_fragment.Render(&list_buffer, {
+			category_link, category->name, category_link, topic_count, format_number(number_buffer, post_count)
+		});
+	}
+
+	std::string page_title = "<title>" + context->site_title + "</title>";
+
+	page_buffer.clear();
+	context->main_template.Render(&page_buffer, { context->site_title, context->archive_blurb, page_title, list_buffer });
+
+	DDL::Utils::IO::ValidatePath(context->html_root);
+
+	return write_listing_page(context, DDL::Utils::String::Replace(HTML_INDEX_PAGE_FORMAT, "<HTML_ROOT>", context->html_root), "index.html");
+}
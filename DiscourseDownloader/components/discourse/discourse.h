@@ -3,17 +3,26 @@
 #include <vector>
 #include <string>
 #include <map>
+#include <unordered_set>
+#include <functional>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <stdio.h>
 
 #include "components/3rdparty/rapidjson/document.h"
+#include "components/3rdparty/rapidjson/stringbuffer.h"
+#include "components/3rdparty/rapidjson/writer.h"
 #include "components/diagnostics/errors/errors.h"
 
 #define JSON_CATEGORY_ROOT_FORMAT std::string("<JSON_ROOT>/c/<CAT_ID>/")
-#define DATA_CACHE_ENTRY_FORMAT std::string("<URL>|<TOPIC_ID>|<POST_COUNT>|<POST_IDS>")
 #define CATEGORY_LIST_URL_FORMAT std::string("<BASE_URL>/categories.json?include_subcategories=true")
 #define CATEGORY_INFO_URL_FORMAT std::string("<BASE_URL>/c/<CAT_ID>/show.json")
 #define TOPIC_LIST_URL_FORMAT std::string("<BASE_URL>/c/<CAT_SLUG>/<CAT_ID>.json?page=")
 #define TOPIC_INFO_URL_FORMAT std::string("<BASE_URL>/t/<TOPIC_ID>.json")
 #define TOPIC_POSTS_URL_FORMAT std::string("<BASE_URL>/t/<TOPIC_ID>/posts.json?")
+#define LATEST_TOPICS_URL_FORMAT std::string("<BASE_URL>/latest.json?order=activity&page=")
+#define LATEST_POSTS_URL_FORMAT std::string("<BASE_URL>/posts.json")
 
 #define JSON_DIRECTORY_ROOT_FORMAT std::string("<JSON_ROOT>/directory/")
 #define DIRECTORY_LIST_URL_FORMAT std::string("<BASE_URL>/directory_items.json?period=all&page=")
@@ -46,16 +55,107 @@ struct DDLResumeInfo
 	{
 		TOPICS,
 		USERS,
+		COMPLETE, //!< The download finished, so there is nothing to resume.
 		INVALID
 	};
 
 	int category_id = -1;
 	int last_saved_topic = -1;
-	int topic_first_id = -1;
-	int topic_last_id = -1;
-	int topic_download_index = -1;
 	int last_user_id = -1;
 	DownloadStep download_step = DownloadStep::INVALID;
+
+	std::unordered_set<int> finished_topics = std::unordered_set<int>(); //!< Topics in the current category which have finished downloading.
+
+	int last_directory_page = -1; //!< The last directory page which, along with every page before it, has had all of its users finish.
+	std::unordered_set<int> finished_users = std::unordered_set<int>(); //!< Users listed after the last finished directory page which have finished downloading.
+};
+
+/**
+* Class representing the resume journal, an append-only log of finished topics or users.
+*
+* Rather than rewriting the whole resume file after every topic, each finished topic is appended to the journal as a
+* single checksummed record. Records are written in groups to keep the number of disk flushes down, so an interruption
+* can lose at most one group - those topics will simply be downloaded again. The resume file itself is only rewritten
+* when compacting the journal, at which point the journal is cleared.
+*
+* While downloading users, records hold a directory page and a user ID instead, or mark a directory page itself as
+* finished. Every record carries its type, so records left over from an earlier step are never mistaken for records of
+* the current one.
+*/
+class DDLResumeJournal
+{
+public:
+	/**
+	* The kinds of record held in the journal.
+	*/
+	enum class RecordType
+	{
+		TOPIC,         //!< A finished topic, keyed by category ID and topic ID.
+		USER,          //!< A finished user, keyed by directory page and user ID.
+		DIRECTORY_PAGE //!< A finished directory page, keyed by page number alone.
+	};
+
+private:
+	std::string journal_path = ""; //!< The path to the journal file.
+	FILE* journal_file = nullptr; //!< Handle to the journal file, opened for appending.
+	std::string pending_records = ""; //!< Records waiting for the next commit.
+	int pending_record_count = 0; //!< The number of records waiting for the next commit.
+	int record_count = 0; //!< The number of records in the journal since it was last cleared.
+	int commit_interval = 50; //!< The number of records to collect before committing them.
+	std::chrono::steady_clock::time_point last_commit_time = std::chrono::steady_clock::now(); //!< The last time records were committed.
+
+public:
+	/**
+	* Opens the resume journal, creating it if it does not already exist.
+	*
+	* @param _journal_path - The path to the journal file.
+	* @param _commit_interval - The number of records to collect before committing them to disk.
+	*/
+	DDLResumeJournal(std::string _journal_path, int _commit_interval);
+
+	/**
+	* Commits any pending records, then closes the journal.
+	*/
+	~DDLResumeJournal();
+
+	/**
+	* Adds a record to the journal. The record is committed along with the rest of its group, or once a couple of
+	* seconds have passed since the last commit.
+	*
+	* @param type - The type of record.
+	* @param key - The ID of the category the topic belongs to, or the directory page the user was listed on.
+	* @param id - The ID of the finished topic or user, or -1 for a directory page record.
+	*/
+	void Append(RecordType type, int key, int id);
+
+	/**
+	* Writes all pending records to the journal and flushes them to disk.
+	*/
+	void Commit();
+
+	/**
+	* Discards all records in the journal, including any pending records. Should only be called once the resume file
+	* has been rewritten to include every finished topic.
+	*/
+	void Clear();
+
+	/**
+	* Retrieves the number of records in the journal since it was last cleared.
+	*
+	* @returns The number of journal records.
+	*/
+	int GetRecordCount();
+};
+
+/**
+* Structure containing the high-water marks used for incremental syncs. Discourse timestamps are always formatted
+* the same way, so they can be compared as strings.
+*/
+struct DDLSyncState
+{
+	int max_post_id = -1; //!< The highest post ID seen by the last sync.
+	std::string default_bumped_at = ""; //!< The newest `bumped_at` seen anywhere, used as the mark for newly downloaded categories.
+	std::map<int, std::string> category_bumped_at = std::map<int, std::string>(); //!< The newest `bumped_at` seen in each category.
 };
 
 struct DiscourseTopic
@@ -78,6 +178,273 @@ struct DiscourseCategory
 	std::vector<DiscourseTopic*> topics = std::vector<DiscourseTopic*>();
 };
 
+/**
+* Structure used to track the progress of a single topic while its post chunks are being downloaded.
+*/
+struct DDLTopicDownloadState
+{
+	DiscourseTopic* topic = nullptr;
+	int category_id = -1;
+
+	int reported_post_count = -1;
+	int collected_post_count = 0;
+	int remaining_chunks = 0;
+	int next_chunk_index = 0; //!< The index given to the next chunk, used to name the saved chunk files.
+
+	std::string chunk_url_base = ""; //!< The URL that each chunk's post IDs are appended to.
+	std::string chunk_local_base = ""; //!< The path that each chunk is saved to, followed by the chunk index.
+	bool save_post_chunks = false; //!< Whether or not raw chunk responses are saved to disk.
+	bool complete = true; //!< Whether the topic and every post chunk have downloaded and saved successfully so far.
+
+	std::function<void(int, bool)> on_topic_finished = nullptr;
+	std::chrono::steady_clock::time_point queued_time = std::chrono::steady_clock::time_point(); //!< The time the topic was queued, used for tracing.
+};
+
+class DDLRequestQueue;
+
+/**
+* Class used to download the topics of a single category, using a shared request queue.
+*
+* Topics may be queued at any point, including from within other request callbacks while the request queue is
+* running. Each topic is downloaded along with all of its posts, and added to the category's topic list once
+* finished.
+*/
+class DDLTopicDownloader
+{
+private:
+	DiscourseCategory* category = nullptr; //!< The category that topics are being downloaded for.
+	DDLRequestQueue* request_queue = nullptr; //!< The request queue used to download topics and posts.
+	std::string topic_dir_base = ""; //!< The directory that topics are saved to.
+	int pending_topic_count = 0; //!< The number of queued topics that have not yet finished.
+	bool refresh_existing_topics = false; //!< Whether topics which have already been saved should be downloaded again.
+	bool incomplete_download = false; //!< Whether or not any topic or post failed to download.
+
+	std::vector<char> parse_buffer = std::vector<char>(); //!< Memory backing parse_allocator, reused for every response.
+	rapidjson::MemoryPoolAllocator<>* parse_allocator = nullptr; //!< Allocator used for all topic and post chunk documents.
+	rapidjson::CrtAllocator parse_stack_allocator = rapidjson::CrtAllocator(); //!< Allocator used for the parser's working stack.
+	rapidjson::StringBuffer post_buffer = rapidjson::StringBuffer(); //!< Buffer that each post is serialized into before being saved.
+	rapidjson::Writer<rapidjson::StringBuffer>* post_writer = nullptr; //!< Writer used to serialize posts into post_buffer.
+
+	/**
+	* Parses a response in place, using the downloader's parse allocator. The response string is modified, so it
+	* must not be used (ie, saved to disk) after calling this, and the document is only valid until
+	* #release_parse_memory is called.
+	*
+	* @param document - The document to parse into. Must have been created with the downloader's parse allocator.
+	* @param response - The response text to parse.
+	*/
+	void parse_response(rapidjson::Document* document, std::string* response);
+
+	/**
+	* Releases any memory used by the last parsed document, keeping the initial parse buffer for the next one.
+	*/
+	void release_parse_memory();
+
+	/**
+	* Saves each post in a post list, adding them to the topic.
+	*
+	* @param posts_json - The array of posts, taken from a topic or post chunk response.
+	* @param state - The download state of the topic that the posts belong to.
+	*/
+	void save_post_list(rapidjson::Value* posts_json, DDLTopicDownloadState* state);
+
+	/**
+	* Queues a request for a chunk of a topic's posts. If the server leaves some of the posts out of its response, they
+	* are requested again, which is also how the largest chunk size the server accepts is found.
+	*
+	* @param state - The download state of the topic that the posts belong to.
+	* @param post_ids - The IDs of the posts to request, in topic order.
+	* @param previous_returned_count - If this chunk holds posts left out of an earlier response, the number of posts
+	*     that response did include, otherwise `-1`.
+	*/
+	void queue_post_chunk(DDLTopicDownloadState* state, topic_post_chunk post_ids, int previous_returned_count);
+
+	/**
+	* Queues a list of post IDs as chunks of the current chunk size.
+	*
+	* @param state - The download state of the topic that the posts belong to.
+	* @param post_ids - The IDs of the posts to request, in topic order.
+	* @param previous_returned_count - Passed on to #queue_post_chunk for each chunk.
+	*/
+	void queue_post_chunks(DDLTopicDownloadState* state, topic_post_chunk* post_ids, int previous_returned_count);
+
+	/**
+	* Marks one of a topic's chunks as finished, finishing the topic once no chunks remain.
+	*
+	* @param state - The download state of the topic. Deleted once the topic is finished.
+	*/
+	void finish_post_chunk(DDLTopicDownloadState* state);
+
+	/**
+	* Marks a topic as finished, adding it to the category and notifying the caller.
+	*
+	* @param topic_id - The ID of the topic.
+	* @param topic - The downloaded topic, or `nullptr` if the topic failed to download.
+	* @param complete - Whether the topic and all of its posts downloaded successfully.
+	* @param on_topic_finished - The callback provided when the topic was queued.
+	* @param queued_time - The time the topic was queued.
+	*/
+	void finish_topic(int topic_id, DiscourseTopic* topic, bool complete, std::function<void(int, bool)> on_topic_finished,
+		std::chrono::steady_clock::time_point queued_time);
+
+public:
+	/**
+	* Prepares a new topic downloader.
+	*
+	* @param _category - The category that topics will be downloaded for.
+	* @param _request_queue - The request queue to add topic and post requests to.
+	*/
+	DDLTopicDownloader(DiscourseCategory* _category, DDLRequestQueue* _request_queue);
+
+	~DDLTopicDownloader();
+
+	/**
+	* Queues a topic for download.
+	*
+	* @param topic_id - The ID of the topic.
+	* @param topic_url - The URL of the topic's JSON data.
+	* @param on_topic_finished - Optional function to call once the topic and all of its posts have finished,
+	*     whether or not the download succeeded. It is passed the topic ID, and whether the topic request and every
+	*     post chunk request succeeded.
+	*/
+	void QueueTopic(int topic_id, std::string topic_url, std::function<void(int, bool)> on_topic_finished);
+
+	/**
+	* Retrieves the number of topics which have been queued but not yet finished.
+	*
+	* @returns The number of unfinished topics.
+	*/
+	int GetPendingTopicCount();
+
+	/**
+	* Checks whether any queued topic or post failed to download.
+	*
+	* @returns `true` if some content was not downloaded, otherwise returns `false`.
+	*/
+	bool IsDownloadIncomplete();
+
+	/**
+	* Sets whether topics which have already been saved should be downloaded again, regardless of the
+	* `download_skip_existing_topics` setting. Used by incremental syncs, where every queued topic is known to have changed.
+	*
+	* @param refresh - `true` to download existing topics again.
+	*/
+	void SetRefreshExistingTopics(bool refresh);
+};
+
+/**
+* Structure used to track the progress of a single user while their profile, avatars, badges and actions are being downloaded.
+*/
+struct DDLUserDownloadState
+{
+	int user_id = -1;
+	std::string username = "";
+	std::string user_root = ""; //!< The directory that the user's files are saved to.
+	std::string directory_item = ""; //!< The user's entry from the directory, serialized.
+
+	int remaining_requests = 0; //!< The number of the user's requests which have not yet finished.
+	bool complete = true; //!< Whether or not every one of the user's requests has succeeded so far.
+
+	std::function<void(int, bool)> on_user_finished = nullptr;
+};
+
+/**
+* Class used to download user profiles, using a shared request queue.
+*
+* Each queued user's profile, avatar sizes, badges and first actions page are all requested at once, with every further
+* actions page requested as soon as the one before it arrives. Users may be queued at any point, including from within
+* other request callbacks while the request queue is running.
+*/
+class DDLUserDownloader
+{
+private:
+	DDLRequestQueue* request_queue = nullptr; //!< The request queue used to download users.
+	int pending_user_count = 0; //!< The number of queued users that have not yet finished.
+	std::map<std::string, std::vector<std::pair<DDLUserDownloadState*, std::string>>> pending_avatars
+		= std::map<std::string, std::vector<std::pair<DDLUserDownloadState*, std::string>>>(); //!< Avatar urls being downloaded, with each user and path waiting on them.
+
+	/**
+	* Queues the download of a user's profile, which is saved along with their directory entry.
+	*
+	* @param state - The download state of the user.
+	*/
+	void queue_user_info(DDLUserDownloadState* state);
+
+	/**
+	* Queues the download of each of a user's avatar sizes which are not already in the blob store. Users sharing an avatar
+	* url which is already being downloaded wait for that download instead of starting another.
+	*
+	* @param state - The download state of the user.
+	* @param avatar_template - The user's avatar url, with `{size}` in place of the size.
+	*/
+	void queue_avatars(DDLUserDownloadState* state, std::string avatar_template);
+
+	/**
+	* Queues the download of a user's badges.
+	*
+	* @param state - The download state of the user.
+	*/
+	void queue_badges(DDLUserDownloadState* state);
+
+	/**
+	* Queues the download of a page of a user's actions. If `download_all_user_actions` is enabled, the next page is
+	* queued once this one arrives, until an empty page is found.
+	*
+	* @param state - The download state of the user.
+	* @param page_number - The page to download, starting from 0.
+	*/
+	void queue_actions_page(DDLUserDownloadState* state, int page_number);
+
+	/**
+	* Marks one of a user's requests as finished, finishing the user once none are left.
+	*
+	* @param state - The download state of the user. Deleted if this was their last request.
+	* @param success - Whether or not the request succeeded.
+	*/
+	void finish_request(DDLUserDownloadState* state, bool success);
+
+public:
+	/**
+	* Prepares a new user downloader.
+	*
+	* @param _request_queue - The request queue to add user requests to.
+	*/
+	DDLUserDownloader(DDLRequestQueue* _request_queue);
+
+	/**
+	* Queues a user for download.
+	*
+	* @param directory_item - The user's entry from a directory page.
+	* @param on_user_finished - Function to call with the user's ID once all of their requests have finished, along with
+	*     whether or not every request succeeded.
+	*/
+	void QueueUser(rapidjson::Value* directory_item, std::function<void(int, bool)> on_user_finished);
+
+	/**
+	* Retrieves the number of users which have been queued but not yet finished.
+	*
+	* @returns The number of unfinished users.
+	*/
+	int GetPendingUserCount();
+};
+
+/**
+* Structure containing the results of the in-depth sanity check, shared by every category being checked.
+*/
+struct DDLSanityCheckState
+{
+	std::mutex result_mutex; //!< Mutex protecting the redownload lists.
+	std::vector<DiscourseCategory*> redownload_categories = std::vector<DiscourseCategory*>(); //!< Categories which need to be downloaded again.
+	std::vector<std::pair<DiscourseCategory*, std::vector<DiscourseTopic*>>> redownload_topics
+		= std::vector<std::pair<DiscourseCategory*, std::vector<DiscourseTopic*>>>(); //!< Topics with missing content, grouped by category.
+
+	std::atomic<int> missing_categories = 0;
+	std::atomic<int> missing_topics = 0;
+	std::atomic<int> missing_posts = 0;
+	std::atomic<int64_t> checked_files = 0; //!< The number of topic and post files which have been checked so far.
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now(); //!< The time the check started.
+};
+
 struct DDLDownloadRetryInfo
 {
 	std::string local_path = "";
@@ -94,7 +461,139 @@ namespace DDL::Discourse
 	namespace Downloader
 	{
 		bool LoadResumeFile();
+
+		/**
+		* Saves the current resume information. The resume file is written to a temporary file first and then
+		* renamed into place, so it is never left half-written. This also compacts the resume journal.
+		*/
 		void SaveResumeFile();
+
+		/**
+		* Marks the start of a category's topic download in the resume information. If the previous download was
+		* interrupted in this same category, the topics it already finished are carried over.
+		*
+		* @param category_id - The ID of the category being downloaded.
+		*/
+		void BeginResumeCategory(int category_id);
+
+		/**
+		* Records that a topic in the current category has finished downloading, using the resume journal. Topics which
+		* had any requests fail should not be recorded, so that a resumed download tries them again.
+		*
+		* @param category_id - The ID of the category the topic belongs to. Ignored if this is not the current category.
+		* @param topic_id - The ID of the finished topic.
+		*/
+		void RecordFinishedTopic(int category_id, int topic_id);
+
+		/**
+		* Checks whether a topic was already finished by the download being resumed.
+		*
+		* @param category_id - The ID of the category the topic belongs to.
+		* @param topic_id - The ID of the topic.
+		*
+		* @returns `true` if the topic can be skipped, otherwise returns `false`.
+		*/
+		bool WasTopicFinished(int category_id, int topic_id);
+
+		/**
+		* Marks the end of a category's first pass. Topics finished by the download being resumed are only skipped during
+		* the first pass, so that any which later turn out to be missing (ie, found by the sanity check) are downloaded
+		* again.
+		*
+		* @param category_id - The ID of the category.
+		*/
+		void FinishResumeCategory(int category_id);
+
+		/**
+		* Marks the start of the user download in the resume information. If the previous download was interrupted
+		* while downloading users, the directory pages and users it already finished are carried over.
+		*/
+		void BeginResumeUsers();
+
+		/**
+		* Records that a user has finished downloading, using the resume journal. Users which had any requests fail
+		* should not be recorded, so that a resumed download tries them again.
+		*
+		* @param page_num - The directory page the user was listed on.
+		* @param user_id - The ID of the finished user.
+		*/
+		void RecordFinishedUser(int page_num, int user_id);
+
+		/**
+		* Records that every user on a directory page, and on every page before it, has finished downloading. A resumed
+		* download will start from the page after this one.
+		*
+		* @param page_num - The finished directory page.
+		* @param user_ids - The IDs of the users listed on the page, which no longer need to be remembered individually.
+		*/
+		void RecordFinishedDirectoryPage(int page_num, std::vector<int>* user_ids);
+
+		/**
+		* Checks whether a user was already finished by the download being resumed.
+		*
+		* @param user_id - The ID of the user.
+		*
+		* @returns `true` if the user can be skipped, otherwise returns `false`.
+		*/
+		bool WasUserFinished(int user_id);
+
+		/**
+		* Retrieves the directory page that the user download should start from.
+		*
+		* @returns The page after the last one finished by the download being resumed, or 0 if there is nothing to resume.
+		*/
+		int GetResumeDirectoryPage();
+
+		/**
+		* Marks the whole download as finished in the resume information, so that the next download starts from the
+		* beginning rather than resuming this one.
+		*/
+		void FinishResumeDownload();
+
+		/**
+		* Commits any pending resume journal records to disk.
+		*/
+		void FlushResumeJournal();
+
+		/**
+		* Loads the high-water marks saved by the last incremental sync.
+		*
+		* @returns `true` if a complete sync state was loaded, otherwise returns `false` (a full download is needed).
+		*/
+		bool LoadSyncState();
+
+		/**
+		* Reads the latest topics and latest posts feeds to find every topic which has changed since the last sync,
+		* and collects the marks for the next sync. If no sync state was loaded, only the marks are collected.
+		*
+		* @param changed_topics - Map of category IDs to the changed topics (ID and URL) in that category.
+		*
+		* @returns #DDLResult::Success_OK if both feeds were read, otherwise returns an error code.
+		*/
+		DDLResult CollectChangedTopics(std::map<int, std::map<int, std::string>>* changed_topics);
+
+		/**
+		* Checks whether a category was included in the last sync, meaning only its changed topics need to be fetched.
+		*
+		* @param category_id - The ID of the category.
+		*
+		* @returns `true` if the category has a sync mark, otherwise returns `false`.
+		*/
+		bool HasSyncMark(int category_id);
+
+		/**
+		* Updates the category's mark for the next sync. Failed categories keep their previous mark.
+		*
+		* @param category_id - The ID of the category.
+		* @param success - Whether every change in the category was downloaded.
+		*/
+		void FinishCategorySync(int category_id, bool success);
+
+		/**
+		* Saves the marks collected by #CollectChangedTopics and #FinishCategorySync for the next sync.
+		*/
+		void SaveSyncState();
+
 		DDLResumeInfo* GetLastResumeInfo();
 		DDLResumeInfo* GetCurrentResumeInfo();
 		DDLResult DownloadTopics(DiscourseCategory* category, std::map<int, std::string>* topic_url_list);
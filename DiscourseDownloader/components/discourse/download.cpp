@@ -10,6 +10,7 @@
 #include "components/utils/io/io.h"
 #include "components/settings/settings.h"
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
 #include "components/utils/converters/converters.h"
 
 void DDL::Discourse::DownloadWebContent()
@@ -22,8 +23,21 @@ void DDL::Discourse::DownloadWebContent()
 		return;
 	}
 
+	std::chrono::steady_clock::time_point phase_start = DDL::Metrics::StartPhase("categories");
 	DDL::Discourse::Downloader::DownloadCategories();
+	DDL::Metrics::FinishPhase("categories", phase_start);
+
+	phase_start = DDL::Metrics::StartPhase("users");
 	DDL::Discourse::Downloader::DownloadUsers();
+	DDL::Metrics::FinishPhase("users", phase_start);
+
+	phase_start = DDL::Metrics::StartPhase("site_info");
 	DDL::Discourse::Downloader::DownloadSiteInfo();
+	DDL::Metrics::FinishPhase("site_info", phase_start);
+
+	phase_start = DDL::Metrics::StartPhase("tags");
 	DDL::Discourse::Downloader::DownloadTags();
+	DDL::Metrics::FinishPhase("tags", phase_start);
+
+	DDL::Utils::Network::LogConnectionStatistics();
 }
\ No newline at end of file
@@ -1,19 +1,152 @@
 #include "components/discourse/discourse.h"
 
+#include <functional>
+#include <algorithm>
+#include <charconv>
+#include <unordered_set>
+
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/trace/trace.h"
 #include "components/settings/settings.h"
 #include "components/utils/io/io.h"
 #include "components/utils/json/json.h"
 #include "components/utils/string/string.h"
 #include "components/utils/network/network.h"
 #include "components/utils/converters/converters.h"
+#include "components/utils/threading/threading.h"
+#include "components/discourse/storage/storage.h"
 
 std::vector<DiscourseCategory*> downloaded_categories = std::vector<DiscourseCategory*>();
 
+void save_url_cache(DiscourseCategory* category, WebsiteConfig* config, std::string category_directory, std::map<int, std::string>* topic_urls)
+{
+	// Write topic URL list to disk to avoid redownloading topic list later
+	if (config->enable_url_caching)
+	{
+		DDL::Logger::LogEvent("saving url cache for category " + std::to_string(category->category_id) + "...");
+
+		DDLTopicCacheWriter url_cache = DDLTopicCacheWriter();
+
+		std::map<int, std::string>::iterator it;
+
+		for (it = topic_urls->begin(); it != topic_urls->end(); it++)
+		{
+			url_cache.AddTopic(it->first, -1, it->second, nullptr);
+		}
+
+		bool cache_result = url_cache.Save(category_directory + URL_CACHE_FILENAME);
+
+		if (cache_result)
+		{
+			DDL::Logger::LogEvent("url cache save finished");
+		}
+		else
+		{
+			DDL::Logger::LogEvent("failed to save url cache, topic urls will have to be redownloaded again in the case of an interrupted download",
+				DDLLogLevel::Warning);
+		}
+	}
+}
+
+void finish_topic_url_list(DiscourseCategory* category, WebsiteConfig* config, std::string category_directory, std::map<int, std::string>* topic_urls,
+	int remaining_skipped_urls)
+{
+	if (remaining_skipped_urls <= 0)
+	{
+		DDL::Logger::LogEvent("reached maximum skipped urls limit, skipping future url searches - if this is not what you want please edit website.cfg");
+	}
+
+	DDL::Logger::LogEvent("finished topic url list for category " + std::to_string(category->category_id)
+		+ ", collected " + std::to_string(topic_urls->size()) + " topics");
+
+	bool topic_count_mismatch = false;
+
+	if (config->strict_topic_count_checks)
+	{
+		if (topic_urls->size() != (*category->json_file)["topic_count"].GetInt())
+		{
+			topic_count_mismatch = true;
+		}
+	}
+	else
+	{
+		if (topic_urls->size() < (*category->json_file)["topic_count"].GetInt())
+		{
+			topic_count_mismatch = true;
+		}
+	}
+
+	if (topic_count_mismatch)
+	{
+		DDL::Logger::LogEvent("collected url count does not match topic_count from category json, some topics may be missed!", DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- url count   : " + std::to_string(topic_urls->size()), DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- topic_count : " + std::to_string((*category->json_file)["topic_count"].GetInt()), DDLLogLevel::Warning);
+	}
+
+	save_url_cache(category, config, category_directory, topic_urls);
+}
+
+void save_category_data_cache(DiscourseCategory* category, WebsiteConfig* config, std::string category_directory)
+{
+	if (config->enable_data_caching)
+	{
+		DDL::Logger::LogEvent("saving data cache for category " + std::to_string(category->category_id) + "...");
+
+		DDLTopicCacheWriter data_cache = DDLTopicCacheWriter();
+
+		for (DiscourseTopic* topic : category->topics)
+		{
+			data_cache.AddTopic(topic->topic_id, topic->posts_count, topic->request_url, &topic->posts);
+		}
+
+		bool cache_result = data_cache.Save(category_directory + DATA_CACHE_FILENAME);
+
+		if (cache_result)
+		{
+			for (DiscourseTopic* topic : category->topics)
+			{
+				topic->posts.clear();
+				delete topic;
+			}
+
+			category->topics.clear();
+
+			DDL::Logger::LogEvent("data cache save finished");
+		}
+		else
+		{
+			DDL::Logger::LogEvent("failed to save data cache - topic data will NOT be unloaded from memory, this could result in high memory usage",
+				DDLLogLevel::Warning);
+		}
+	}
+}
+
+/**
+* Loads every topic url from a category's url cache.
+*
+* @returns `true` if the url cache was loaded, otherwise returns `false`.
+*/
+bool load_url_cache(std::string category_directory, std::map<int, std::string>* topic_urls)
+{
+	DDLTopicCache url_cache = DDLTopicCache();
+
+	if (!DDL::Discourse::Storage::OpenTopicCache(category_directory, false, &url_cache))
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < url_cache.GetTopicCount(); i++)
+	{
+		const DDLTopicCacheRecord* record = url_cache.GetTopic(i);
+		topic_urls->insert_or_assign(record->topic_id, std::string(url_cache.GetURL(record)));
+	}
+
+	return true;
+}
+
 DDLResult download_category(DiscourseCategory* category)
 {
 	bool incomplete_download = false;
-	DDLResumeInfo* current_resume_info = DDL::Discourse::Downloader::GetCurrentResumeInfo();
 
 	if (!category)
 	{
@@ -29,6 +162,9 @@ DDLResult download_category(DiscourseCategory* category)
 		return DDLResult::Error_NullPointer;
 	}
 
+	DDLTraceSpan category_span = DDLTraceSpan("download category", "category");
+	category_span.AddArg("category_id", category->category_id);
+
 	if (!DDL::Utils::IO::FileExists(config->json_path))
 	{
 		DDL::Utils::IO::ValidatePath(config->json_path);
@@ -53,7 +189,7 @@ DDLResult download_category(DiscourseCategory* category)
 		}
 	}
 
-	current_resume_info->category_id = category->category_id;
+	DDL::Discourse::Downloader::BeginResumeCategory(category->category_id);
 
 	DDL::Utils::IO::ValidatePath(category_directory);
 	DDL::Utils::IO::CreateNewFile(category_directory + "show.json", json_string);
@@ -68,18 +204,7 @@ DDLResult download_category(DiscourseCategory* category)
 				std::string logo_url = "https:" + std::string((*(category->json_file))["uploaded_logo"]["url"].GetString());
 				std::string logo_file_path = category_directory + "logo" + logo_url.substr(logo_url.find_last_of('.'));
 
-				std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(logo_url, &logo_http_code);
-
-				if (logo_http_code == 200)
-				{
-					if (!DDL::Utils::IO::CreateNewFileBinaryMode(logo_file_path, response))
-					{
-						DDL::Logger::LogEvent("error writing logo file for category with id '"
-							+ std::to_string(category->category_id) + "', category logo will not be saved", DDLLogLevel::Error);
-						incomplete_download = true;
-					}
-				}
-				else
+				if (!DDL::Utils::Network::DownloadFileWithRetries(logo_url, logo_file_path, &logo_http_code))
 				{
 					DDL::Logger::LogEvent("got http " + std::to_string(logo_http_code) + " while downloading logo for category "
 						+ std::to_string(category->category_id) + ", category logo will not be saved", DDLLogLevel::Error);
@@ -94,47 +219,30 @@ DDLResult download_category(DiscourseCategory* category)
 
 	if (config->enable_url_caching)
 	{
-		if (DDL::Utils::IO::IsFile(category_directory + "urlcache"))
+		if (load_url_cache(category_directory, &topic_urls))
 		{
-			bool url_cache_valid = true;
-
-			std::vector<std::string> topic_url_items = DDL::Utils::IO::GetFileContentsAsLines(category_directory + "urlcache");
-
-			for (std::string item : topic_url_items)
-			{
-				std::vector<std::string> components = DDL::Utils::String::Split(item, "|");
-
-				if (components.size() != 2)
-				{
-					DDL::Logger::LogEvent("url cache contains an invalid entry - url cache will be ignored (contains more than 2 components)!",
-						DDLLogLevel::Warning);
-					url_cache_valid = false;
-					break;
-				}
-
-				if (!DDL::Converters::IsStringInt(components.at(0)))
-				{
-					DDL::Logger::LogEvent("url cache contains an invalid entry - url cache will be ignored (topic id was invalid)!", DDLLogLevel::Warning);
-					url_cache_valid = false;
-					break;
-				}
-
-				topic_urls.insert(std::pair<int, std::string>(DDL::Converters::StringToInt(components.at(0)), components.at(1)));
-			}
-
-			if (url_cache_valid)
-			{
-				DDL::Logger::LogEvent("successfully loaded " + std::to_string(topic_urls.size()) + " topic urls from urlcache, skipping url fetching");
-				needs_url_list_download = false;
-			}
+			DDL::Logger::LogEvent("successfully loaded " + std::to_string(topic_urls.size()) + " topic urls from urlcache, skipping url fetching");
+			needs_url_list_download = false;
+		}
+		else if (DDL::Utils::IO::IsFile(category_directory + URL_CACHE_FILENAME))
+		{
+			DDL::Logger::LogEvent("url cache is damaged and will be ignored!", DDLLogLevel::Warning);
 		}
 	}
 
+	DDLRequestQueue request_queue = DDLRequestQueue(DDL::Utils::Network::GetMaxConcurrentRequests());
+	DDLTopicDownloader topic_downloader = DDLTopicDownloader(category, &request_queue);
+
+	bool stream_topics = false;
+
 	// Build complete topic list if url cache doesnt exist/isn't enabled
 	if (needs_url_list_download)
 	{
 		DDL::Logger::LogEvent("building topic url list for category " + std::to_string(category->category_id) + ", this may take a while...");
 
+		// Topics are downloaded as soon as each page of the topic list is parsed
+		stream_topics = true;
+
 		std::string topic_fetch_url_base = TOPIC_LIST_URL_FORMAT;
 		{
 			topic_fetch_url_base = DDL::Utils::String::Replace(topic_fetch_url_base, "<BASE_URL>", config->website_url);
@@ -144,208 +252,173 @@ DDLResult download_category(DiscourseCategory* category)
 
 		std::string local_json_dir = category_directory + "topic_pages/";
 		bool has_more_topics = true;
-		int topic_list_page = 0;
+		bool topic_list_page_deferred = false;
+		int next_topic_list_page = 0;
+		int saved_topic_count = 0;
 
 		DDL::Utils::IO::ValidatePath(local_json_dir);
 
 		int requests_until_next_notify = config->topic_url_collection_notify_interval;
+		int topics_until_next_notify = config->topic_url_collection_notify_interval;
 		int remaining_skipped_urls = config->max_skipped_topic_urls;
 
-		while (has_more_topics)
-		{
-			std::string topic_fetch_url = topic_fetch_url_base + std::to_string(topic_list_page);
-			int http_code = -1;
-
-			std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(topic_fetch_url, &http_code);
+		std::function<void()> request_next_topic_list_page = nullptr;
 
-			if (http_code == 200)
+		std::function<void(int, bool)> on_topic_finished = [&](int topic_id, bool complete)
+		{
+			if (complete)
 			{
-				DDL::Utils::IO::CreateNewFile(local_json_dir + std::to_string(topic_list_page) + ".json", response);
-
-				rapidjson::Document list_document = rapidjson::Document();
-				list_document.Parse(response.c_str());
-
-				rapidjson::Value topic_list_json = list_document["topic_list"].GetObj();
-
-				if (!topic_list_json.HasMember("more_topics_url"))
-				{
-					has_more_topics = false;
-				}
-
-				rapidjson::GenericArray topics_json = topic_list_json["topics"].GetArray();
-
-				for (int i = 0; i < topics_json.Size(); i++)
-				{
-					rapidjson::Value topic_info_json = topics_json[i].GetObj();
-
-					int topic_category_id = topic_info_json["category_id"].GetInt();
-					if (!config->download_subcategory_topics && topic_category_id != category->category_id)
-					{
-						if (remaining_skipped_urls <= 0)
-						{
-							has_more_topics = false;
-						}
-
-						remaining_skipped_urls--;
-						continue;
-					}
-
-					remaining_skipped_urls = config->max_skipped_topic_urls;
+				DDL::Discourse::Downloader::RecordFinishedTopic(category->category_id, topic_id);
+			}
 
-					std::string topic_info_url = TOPIC_INFO_URL_FORMAT;
-					{
-						topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<BASE_URL>", config->website_url);
-						topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<TOPIC_ID>", std::to_string(topic_info_json["id"].GetInt()));
-					}
+			saved_topic_count++;
+			topics_until_next_notify--;
 
-					if (!topic_urls.contains(topic_info_json["id"].GetInt()))
-					{
-						topic_urls.insert(std::pair<int, std::string>(topic_info_json["id"].GetInt(), topic_info_url));
-					}
-					else
-					{
-						DDL::Logger::LogEvent("not adding topic url '" + topic_info_url + "' to topic list because the list already contains that url");
-					}
-				}
-			}
-			else if (http_code == 301)
-			{
-				topic_list_page = 0;
-				topic_urls.clear();
-				DDL::Logger::LogEvent("got http 301, resetting page url back to 0 and clearing existing urls");
-			}
-			else
+			if (topics_until_next_notify <= 0)
 			{
-				DDL::Logger::LogEvent("got http " + std::to_string(http_code) + ", some topics will be missed!", DDLLogLevel::Error);
-				incomplete_download = true;
+				topics_until_next_notify = config->topic_url_collection_notify_interval;
+				DDL::Logger::LogEvent("saved " + std::to_string(saved_topic_count) + "/" + std::to_string(topic_urls.size()) + " topics so far...");
 			}
 
-			if (requests_until_next_notify <= 0)
+			// Resume collecting topic urls once the download backlog has room again
+			if (topic_list_page_deferred && topic_downloader.GetPendingTopicCount() < config->max_pending_topics)
 			{
-				requests_until_next_notify = config->topic_url_collection_notify_interval;
-				DDL::Logger::LogEvent("collected " + std::to_string(topic_urls.size()) + "/"
-					+ std::to_string((*category->json_file)["topic_count"].GetInt()) + " topic urls so far...");
+				topic_list_page_deferred = false;
+				request_next_topic_list_page();
 			}
+		};
 
-			topic_list_page++;
-			requests_until_next_notify--;
-		}
-
-		if (remaining_skipped_urls <= 0)
+		request_next_topic_list_page = [&]()
 		{
-			DDL::Logger::LogEvent("reached maximum skipped urls limit, skipping future url searches - if this is not what you want please edit website.cfg");
-		}
+			int topic_list_page = next_topic_list_page;
+			next_topic_list_page++;
 
-		DDL::Logger::LogEvent("finished topic url list for category " + std::to_string(category->category_id)
-			+ ", collected " + std::to_string(topic_urls.size()) + " topics");
-
-		bool topic_count_mismatch = false;
-
-		if (config->strict_topic_count_checks)
-		{
-			if (topic_urls.size() != (*category->json_file)["topic_count"].GetInt())
+			request_queue.AddRequest(topic_fetch_url_base + std::to_string(topic_list_page), [&, topic_list_page](DDLNetworkRequest* request)
 			{
-				topic_count_mismatch = true;
-			}
-		}
-		else
-		{
-			if (topic_urls.size() < (*category->json_file)["topic_count"].GetInt())
-			{
-				topic_count_mismatch = true;
-			}
-		}
-
-		if (topic_count_mismatch)
-		{
-			DDL::Logger::LogEvent("collected url count does not match topic_count from category json, some topics may be missed!", DDLLogLevel::Warning);
-			DDL::Logger::LogEvent("- url count   : " + std::to_string(topic_urls.size()), DDLLogLevel::Warning);
-			DDL::Logger::LogEvent("- topic_count : " + std::to_string((*category->json_file)["topic_count"].GetInt()), DDLLogLevel::Warning);
-		}
-	}
-
-	// Write topic URL list to disk to avoid redownloading topic list later
-	if (config->enable_url_caching)
-	{
-		DDL::Logger::LogEvent("saving url cache for category " + std::to_string(category->category_id) + "...");
+				if (request->http_code == 200)
+				{
+					DDL::Utils::IO::CreateNewFile(local_json_dir + std::to_string(topic_list_page) + ".json", request->response);
 
-		std::string url_cache_file_contents = "";
+					rapidjson::Document list_document = rapidjson::Document();
+					{
+						DDLTraceSpan parse_span = DDLTraceSpan("parse topic list", "json");
+						list_document.ParseInsitu(request->response.data());
+					}
 
-		std::map<int, std::string>::iterator it;
+					rapidjson::Value topic_list_json = list_document["topic_list"].GetObj();
 
-		for (it = topic_urls.begin(); it != topic_urls.end(); it++)
-		{
-			url_cache_file_contents += std::to_string(it->first) + "|" + it->second + "\n";
-		}
+					if (!topic_list_json.HasMember("more_topics_url"))
+					{
+						has_more_topics = false;
+					}
 
-		bool cache_result = DDL::Utils::IO::CreateNewFile(category_directory + "urlcache", url_cache_file_contents);
+					rapidjson::GenericArray topics_json = topic_list_json["topics"].GetArray();
 
-		if (cache_result)
-		{
-			DDL::Logger::LogEvent("url cache save finished");
-		}
-		else
-		{
-			DDL::Logger::LogEvent("failed to save url cache, topic urls will have to be redownloaded again in the case of an interrupted download",
-				DDLLogLevel::Warning);
-		}
-	}
+					for (int i = 0; i < topics_json.Size(); i++)
+					{
+						rapidjson::Value topic_info_json = topics_json[i].GetObj();
 
-	DDL::Discourse::Downloader::DownloadTopics(category, &topic_urls);
+						int topic_category_id = topic_info_json["category_id"].GetInt();
+						if (!config->download_subcategory_topics && topic_category_id != category->category_id)
+						{
+							if (remaining_skipped_urls <= 0)
+							{
+								has_more_topics = false;
+							}
 
-	// Write topic data to disk so we can free up memory
-	if (config->enable_data_caching)
-	{
-		DDL::Logger::LogEvent("saving data cache for category " + std::to_string(category->category_id) + "...");
+							remaining_skipped_urls--;
+							continue;
+						}
 
-		std::string data_cache_contents = "";
+						remaining_skipped_urls = config->max_skipped_topic_urls;
 
-		for (DiscourseTopic* topic : category->topics)
-		{
-			std::string cache_entry = DATA_CACHE_ENTRY_FORMAT;
+						int topic_id = topic_info_json["id"].GetInt();
 
-			cache_entry = DDL::Utils::String::Replace(cache_entry, "<URL>", topic->request_url);
-			cache_entry = DDL::Utils::String::Replace(cache_entry, "<TOPIC_ID>", std::to_string(topic->topic_id));
-			cache_entry = DDL::Utils::String::Replace(cache_entry, "<POST_COUNT>", std::to_string(topic->posts_count));
+						std::string topic_info_url = TOPIC_INFO_URL_FORMAT;
+						{
+							topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<BASE_URL>", config->website_url);
+							topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<TOPIC_ID>", std::to_string(topic_id));
+						}
 
-			std::string post_id_list = "";
-			{
-				for (int post_id : topic->posts)
+						if (!topic_urls.contains(topic_id))
+						{
+							topic_urls.insert(std::pair<int, std::string>(topic_id, topic_info_url));
+
+							if (DDL::Discourse::Downloader::WasTopicFinished(category->category_id, topic_id))
+							{
+								saved_topic_count++;
+							}
+							else
+							{
+								topic_downloader.QueueTopic(topic_id, topic_info_url, on_topic_finished);
+							}
+						}
+						else if (DDL::Logger::IsLogLevelEnabled(DDLLogLevel::Info))
+						{
+							DDL::Logger::LogEvent("not adding topic url '" + topic_info_url + "' to topic list because the list already contains that url");
+						}
+					}
+				}
+				else if (request->http_code == 301)
 				{
-					post_id_list += std::to_string(post_id) + ",";
+					next_topic_list_page = 0;
+					DDL::Logger::LogEvent("got http 301, resetting page url back to 0 (urls already collected will not be added again)");
+				}
+				else
+				{
+					DDL::Logger::LogEvent("got http " + std::to_string(request->http_code) + ", some topics will be missed!", DDLLogLevel::Error);
+					incomplete_download = true;
 				}
 
-				if (post_id_list.ends_with(","))
+				if (requests_until_next_notify <= 0)
 				{
-					post_id_list = post_id_list.substr(0, post_id_list.length() - 1);
+					requests_until_next_notify = config->topic_url_collection_notify_interval;
+					DDL::Logger::LogEvent("collected " + std::to_string(topic_urls.size()) + "/"
+						+ std::to_string((*category->json_file)["topic_count"].GetInt()) + " topic urls so far...");
 				}
-			}
 
-			cache_entry = DDL::Utils::String::Replace(cache_entry, "<POST_IDS>", post_id_list);
+				requests_until_next_notify--;
 
-			data_cache_contents += cache_entry + "\n";
-		}
+				if (!has_more_topics)
+				{
+					finish_topic_url_list(category, config, category_directory, &topic_urls, remaining_skipped_urls);
+					return;
+				}
 
-		bool cache_result = DDL::Utils::IO::CreateNewFile(category_directory + "datacache", data_cache_contents);
+				if (topic_downloader.GetPendingTopicCount() >= config->max_pending_topics)
+				{
+					topic_list_page_deferred = true;
+					return;
+				}
 
-		if (cache_result)
-		{
-			for (DiscourseTopic* topic : category->topics)
-			{
-				topic->posts.clear();
-				delete topic;
-			}
+				request_next_topic_list_page();
+			});
+		};
 
-			category->topics.clear();
+		request_next_topic_list_page();
+		request_queue.Run();
 
-			DDL::Logger::LogEvent("data cache save finished");
-		}
-		else
+		DDL::Discourse::Downloader::FlushResumeJournal();
+
+		if (topic_downloader.IsDownloadIncomplete())
 		{
-			DDL::Logger::LogEvent("failed to save data cache - topic data will NOT be unloaded from memory, this could result in high memory usage",
-				DDLLogLevel::Warning);
+			incomplete_download = true;
 		}
 	}
+	else
+	{
+		save_url_cache(category, config, category_directory, &topic_urls);
+	}
+
+	if (!stream_topics)
+	{
+		DDL::Discourse::Downloader::DownloadTopics(category, &topic_urls);
+	}
+
+	DDL::Discourse::Downloader::FinishResumeCategory(category->category_id);
+
+	// Write topic data to disk so we can free up memory
+	save_category_data_cache(category, config, category_directory);
 
 	DDL::Logger::LogEvent("finished downloading category with id '" + std::to_string(category->category_id) + "'");
 
@@ -375,7 +448,7 @@ void LoadCategoriesFromJSON(rapidjson::GenericArray<false, rapidjson::Value> cat
 		DiscourseCategory* category = new DiscourseCategory();
 
 		category->json_file = new rapidjson::Document();
-		category->json_file->Parse(DDL::Utils::Json::Serialize(&category_json).c_str());
+		category->json_file->CopyFrom(category_json, category->json_file->GetAllocator());
 		category->category_id = category_json["id"].GetInt();
 
 		if (config->use_category_id_filter)
@@ -469,83 +542,383 @@ void load_category_data_cache(DiscourseCategory* category, WebsiteConfig* config
 	{
 		DDL::Logger::LogEvent("loading data from cache...");
 
-		std::string cache_path = JSON_CATEGORY_ROOT_FORMAT + "datacache";
+		std::string category_directory = JSON_CATEGORY_ROOT_FORMAT;
 		{
-			cache_path = DDL::Utils::String::Replace(cache_path, "<JSON_ROOT>", config->json_path);
-			cache_path = DDL::Utils::String::Replace(cache_path, "<CAT_ID>", std::to_string(category->category_id));
+			category_directory = DDL::Utils::String::Replace(category_directory, "<JSON_ROOT>", config->json_path);
+			category_directory = DDL::Utils::String::Replace(category_directory, "<CAT_ID>", std::to_string(category->category_id));
 		}
 
-		if (DDL::Utils::IO::IsFile(cache_path))
+		DDLTopicCache data_cache = DDLTopicCache();
+
+		if (DDL::Discourse::Storage::OpenTopicCache(category_directory, true, &data_cache))
 		{
-			std::vector<std::string> cache_entries = DDL::Utils::IO::GetFileContentsAsLines(cache_path);
+			category->topics.reserve(category->topics.size() + data_cache.GetTopicCount());
 
-			for (std::string cache_entry : cache_entries)
+			for (uint32_t i = 0; i < data_cache.GetTopicCount(); i++)
 			{
-				bool cache_entry_valid = true;
+				const DDLTopicCacheRecord* record = data_cache.GetTopic(i);
+				const int32_t* post_ids = data_cache.GetPostIDs(record);
 
-				std::vector<std::string> components = DDL::Utils::String::Split(cache_entry, "|");
+				DiscourseTopic* topic = new DiscourseTopic();
 
-				if (components.size() != 4)
-				{
-					cache_entry_valid = false;
-					DDL::Logger::LogEvent("data cache entry has an invalid number of components (expected 4, got "
-						+ std::to_string(components.size()) + ")", DDLLogLevel::Error);
-					continue;
-				}
+				topic->request_url = data_cache.GetURL(record);
+				topic->topic_id = record->topic_id;
+				topic->posts_count = record->posts_count;
+				topic->posts.assign(post_ids, post_ids + record->post_id_count);
 
-				if (!DDL::Converters::IsStringInt(components.at(1)) || !DDL::Converters::IsStringInt(components.at(2)))
-				{
-					cache_entry_valid = false;
-					DDL::Logger::LogEvent("data cache entry has an invalid topic id and/or post count", DDLLogLevel::Error);
-					continue;
-				}
+				category->topics.push_back(topic);
+			}
+		}
+		else
+		{
+			DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " is missing a data cache file, "
+				"category cannot be verified - this may result in an incomplete download!", DDLLogLevel::Error);
+		}
+	}
+}
 
-				std::vector<int> post_ids = std::vector<int>();
-				std::vector<std::string> post_ids_str = DDL::Utils::String::Split(components.at(3), ",");
+DDLResult sync_category(DiscourseCategory* category, std::map<int, std::string>* changed_topics)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-				for (std::string post_id_str : post_ids_str)
-				{
-					if (DDL::Converters::IsStringInt(post_id_str))
-					{
-						post_ids.push_back(DDL::Converters::StringToInt(post_id_str));
-					}
-					else
-					{
-						cache_entry_valid = false;
-						DDL::Logger::LogEvent("data cache entry has an invalid post id in post id list", DDLLogLevel::Error);
-					}
-				}
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - skipping category", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
 
-				std::string topic_url = components.at(0);
-				int topic_id = DDL::Converters::StringToInt(components.at(1));
-				int post_count = DDL::Converters::StringToInt(components.at(2));
+	DDLTraceSpan category_span = DDLTraceSpan("sync category", "category");
+	category_span.AddArg("category_id", category->category_id);
 
-				if (post_ids.size() != post_count)
-				{
-					cache_entry_valid = false;
-					DDL::Logger::LogEvent("data cache entry has a post count mismatch - reported post count was "
-						+ std::to_string(post_count) + ", post id count was " + std::to_string(post_ids.size()), DDLLogLevel::Error);
-				}
+	std::string category_directory = JSON_CATEGORY_ROOT_FORMAT;
+	{
+		category_directory = DDL::Utils::String::Replace(category_directory, "<JSON_ROOT>", config->json_path);
+		category_directory = DDL::Utils::String::Replace(category_directory, "<CAT_ID>", std::to_string(category->category_id));
+	}
 
-				if (cache_entry_valid)
-				{
-					DiscourseTopic* topic = new DiscourseTopic();
+	DDL::Utils::IO::ValidatePath(category_directory);
+	DDL::Utils::IO::CreateNewFile(category_directory + "show.json", DDL::Utils::Json::Serialize(category->json_file));
+
+	if (changed_topics->size() == 0)
+	{
+		DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " has no changes since the last sync");
+		return DDLResult::Success_OK;
+	}
 
-					topic->request_url = topic_url;
-					topic->topic_id = topic_id;
-					topic->posts_count = post_count;
-					topic->posts = post_ids;
+	DDL::Logger::LogEvent("syncing " + std::to_string(changed_topics->size()) + " changed topics in category " + std::to_string(category->category_id) + "...");
 
-					category->topics.push_back(topic);
-				}
+	load_category_data_cache(category, config);
+	int cached_topic_count = category->topics.size();
+
+	DDLRequestQueue request_queue = DDLRequestQueue(DDL::Utils::Network::GetMaxConcurrentRequests());
+	DDLTopicDownloader topic_downloader = DDLTopicDownloader(category, &request_queue);
+	topic_downloader.SetRefreshExistingTopics(true);
+
+	std::map<int, std::string>::iterator it;
+
+	for (it = changed_topics->begin(); it != changed_topics->end(); it++)
+	{
+		topic_downloader.QueueTopic(it->first, it->second, nullptr);
+	}
+
+	request_queue.Run();
+
+	// Refreshed topics only list the posts that were actually fetched, so merge them into the cached entries
+	std::map<int, DiscourseTopic*> merged_topics = std::map<int, DiscourseTopic*>();
+
+	for (int i = 0; i < category->topics.size(); i++)
+	{
+		DiscourseTopic* topic = category->topics[i];
+
+		if (i < cached_topic_count || !merged_topics.contains(topic->topic_id))
+		{
+			merged_topics.insert_or_assign(topic->topic_id, topic);
+			continue;
+		}
+
+		DiscourseTopic* cached_topic = merged_topics.at(topic->topic_id);
+		std::unordered_set<int> cached_post_ids = std::unordered_set<int>(cached_topic->posts.begin(), cached_topic->posts.end());
+
+		for (int post_id : topic->posts)
+		{
+			if (cached_post_ids.insert(post_id).second)
+			{
+				cached_topic->posts.push_back(post_id);
+			}
+		}
+
+		cached_topic->posts_count = topic->posts_count;
+		delete topic;
+	}
+
+	category->topics.clear();
+
+	for (std::pair<const int, DiscourseTopic*>& merged_topic : merged_topics)
+	{
+		category->topics.push_back(merged_topic.second);
+	}
+
+	std::map<int, std::string> topic_urls = std::map<int, std::string>();
+
+	if (config->enable_url_caching && load_url_cache(category_directory, &topic_urls))
+	{
+		topic_urls.insert(changed_topics->begin(), changed_topics->end());
+		save_url_cache(category, config, category_directory, &topic_urls);
+	}
+
+	save_category_data_cache(category, config, category_directory);
+
+	DDL::Logger::LogEvent("finished syncing category with id '" + std::to_string(category->category_id) + "'");
+
+	if (topic_downloader.IsDownloadIncomplete())
+	{
+		DDL::Logger::LogEvent("some changes were not downloaded, they will be fetched again by the next sync", DDLLogLevel::Warning);
+		return DDLResult::Error_IncompleteDownload;
+	}
+
+	return DDLResult::Success_OK;
+}
+
+/**
+* Calculates how quickly the in-depth sanity check is getting through files.
+*/
+double get_files_per_second(DDLSanityCheckState* state)
+{
+	double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - state->start_time).count();
+	return state->checked_files / std::max(elapsed_seconds, 0.001);
+}
+
+/**
+* Lists a directory, collecting the ID of every entry named `<ID><suffix>` (such as `1234.json`).
+*
+* @returns `true` if the directory was read, otherwise returns `false`.
+*/
+bool list_directory_ids(std::string path, std::string_view suffix, std::unordered_set<int>* ids)
+{
+	std::vector<std::string> names = std::vector<std::string>();
+
+	if (!DDL::Utils::IO::ListDirectory(path, &names))
+	{
+		return false;
+	}
+
+	ids->clear();
+	ids->reserve(names.size());
+
+	for (std::string& name : names)
+	{
+		int id = -1;
+		std::from_chars_result result = std::from_chars(name.data(), name.data() + name.length(), id);
+
+		if (result.ec == std::errc() && result.ptr != name.data() && std::string_view(result.ptr, name.data() + name.length() - result.ptr) == suffix)
+		{
+			ids->insert(id);
+		}
+	}
+
+	return true;
+}
+
+/**
+* Checks that every topic and post listed in a category's data cache has been saved. Each directory is read once and
+* compared against the cache, rather than checking each file on its own. Safe to run for several categories at once.
+*/
+void check_category_files(DiscourseCategory* category, WebsiteConfig* config, DDLSanityCheckState* state)
+{
+	DDLTraceSpan check_span = DDLTraceSpan("check category files", "sanity_check");
+	check_span.AddArg("category_id", category->category_id);
+
+	load_category_data_cache(category, config);
+
+	std::string category_root = JSON_CATEGORY_ROOT_FORMAT;
+	{
+		category_root = DDL::Utils::String::Replace(category_root, "<JSON_ROOT>", config->json_path);
+		category_root = DDL::Utils::String::Replace(category_root, "<CAT_ID>", std::to_string(category->category_id));
+	}
+
+	bool archive_enabled = DDL::Discourse::Storage::IsArchiveEnabled();
+	std::vector<std::string> category_files = std::vector<std::string>();
+
+	if (!DDL::Utils::IO::ListDirectory(category_root, &category_files))
+	{
+		DDL::Logger::LogEvent("category " + std::to_string(category->category_id)
+			+ " does not appear to be downloaded, will attempt to redownload", DDLLogLevel::Warning);
+
+		state->missing_categories++;
+
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(state->result_mutex);
+		state->redownload_categories.push_back(category);
+
+		// Every topic would be reported missing as well, and they are all downloaded again along with the category anyway
+		return;
+	}
+
+	if (std::find(category_files.begin(), category_files.end(), "show.json") == category_files.end())
+	{
+		DDL::Logger::LogEvent("category " + std::to_string(category->category_id)
+			+ " missing category information json, will attempt to redownload", DDLLogLevel::Warning);
+
+		state->missing_categories++;
+
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(state->result_mutex);
+		state->redownload_categories.push_back(category);
+	}
+
+	bool topic_count_mismatch = false;
+
+	if (config->strict_topic_count_checks)
+	{
+		if (category->topics.size() != (*category->json_file)["topic_count"].GetInt())
+		{
+			topic_count_mismatch = true;
+		}
+	}
+	else
+	{
+		if (category->topics.size() < (*category->json_file)["topic_count"].GetInt())
+		{
+			topic_count_mismatch = true;
+		}
+	}
+
+	if (topic_count_mismatch)
+	{
+		DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " has a topic count mismatch, category will "
+			"NOT be redownloaded automatically but you may want to using the category id whitelist options in website.cfg:", DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- reported topic count : " + std::to_string((*category->json_file)["topic_count"].GetInt()), DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- saved topic count    : " + std::to_string(category->topics.size()), DDLLogLevel::Warning);
+	}
+
+	std::unordered_set<int> topic_directories = std::unordered_set<int>();
+	std::unordered_set<int> post_files = std::unordered_set<int>();
+	std::vector<std::string> topic_files = std::vector<std::string>();
+	std::vector<DiscourseTopic*> redownload_topics = std::vector<DiscourseTopic*>();
+
+	if (!archive_enabled)
+	{
+		list_directory_ids(category_root + "topics/", "", &topic_directories);
+	}
+
+	for (DiscourseTopic* topic : category->topics)
+	{
+		bool topic_missing_content = false;
+		bool posts_listed = false;
+
+		std::string topic_root = category_root + "topics/" + std::to_string(topic->topic_id) + "/";
+
+		if (archive_enabled)
+		{
+			if (!DDL::Discourse::Storage::TopicExists(category->category_id, topic->topic_id))
+			{
+				DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+					+ " is missing from the archive store, topic will be redownloaded", DDLLogLevel::Warning);
+
+				topic_missing_content = true;
+				state->missing_topics++;
 			}
 		}
+		else if (!topic_directories.contains(topic->topic_id))
+		{
+			DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+				+ " directory is missing, topic will be redownloaded", DDLLogLevel::Warning);
+
+			topic_missing_content = true;
+			state->missing_topics++;
+		}
 		else
 		{
-			DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " is missing a data cache file, "
-				"category cannot be verified - this may result in an incomplete download!", DDLLogLevel::Error);
+			// The topic directory's own listing shows both its information file and whether it has a posts directory
+			if (!DDL::Utils::IO::ListDirectory(topic_root, &topic_files))
+			{
+				topic_files.clear();
+			}
+
+			if (std::find(topic_files.begin(), topic_files.end(), "topic.json") == topic_files.end())
+			{
+				DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+					+ " information file is missing, topic will be redownloaded", DDLLogLevel::Warning);
+
+				topic_missing_content = true;
+				state->missing_topics++;
+			}
+
+			if (std::find(topic_files.begin(), topic_files.end(), "posts") != topic_files.end())
+			{
+				posts_listed = list_directory_ids(topic_root + "posts/", ".json", &post_files);
+			}
+		}
+
+		if (!archive_enabled && !posts_listed)
+		{
+			DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+				+ " posts directory is missing, topic will be redownloaded", DDLLogLevel::Warning);
+
+			topic_missing_content = true;
+			state->missing_posts += topic->posts_count;
+		}
+
+		bool post_count_mismatch = false;
+
+		if (config->strict_topic_count_checks)
+		{
+			if (topic->posts.size() != topic->posts_count)
+			{
+				post_count_mismatch = true;
+			}
+		}
+		else
+		{
+			if (topic->posts.size() < topic->posts_count)
+			{
+				post_count_mismatch = true;
+			}
+		}
+
+		if (post_count_mismatch)
+		{
+			DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+				+ " has a post count mismatch, topic will be redownloaded:", DDLLogLevel::Warning);
+			DDL::Logger::LogEvent("- reported post count : " + std::to_string(topic->posts_count), DDLLogLevel::Warning);
+			DDL::Logger::LogEvent("- saved post count    : " + std::to_string(topic->posts.size()), DDLLogLevel::Warning);
+
+			topic_missing_content = true;
+		}
+
+		// Without a posts directory, every post has already been counted as missing
+		if (archive_enabled || posts_listed)
+		{
+			for (int post_id : topic->posts)
+			{
+				bool post_exists = archive_enabled ? DDL::Discourse::Storage::PostExists(category->category_id, topic->topic_id, post_id)
+					: post_files.contains(post_id);
+
+				if (!post_exists)
+				{
+					DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
+						+ " is missing post " + std::to_string(post_id) + ", topic will be redownloaded", DDLLogLevel::Warning);
+
+					topic_missing_content = true;
+					state->missing_posts++;
+				}
+			}
+		}
+
+		state->checked_files += topic->posts.size() + 1;
+
+		if (topic_missing_content)
+		{
+			redownload_topics.push_back(topic);
 		}
 	}
+
+	DDL::Logger::LogEvent("checked category " + std::to_string(category->category_id) + " (" + std::to_string(category->topics.size()) + " topics, "
+		+ std::to_string((int)get_files_per_second(state)) + " files/sec overall)");
+
+	if (redownload_topics.size() > 0)
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(state->result_mutex);
+		state->redownload_topics.push_back(std::pair<DiscourseCategory*, std::vector<DiscourseTopic*>>(category, redownload_topics));
+	}
 }
 
 void DDL::Discourse::Downloader::DownloadCategories()
@@ -583,7 +956,24 @@ void DDL::Discourse::Downloader::DownloadCategories()
 	rapidjson::GenericArray category_list = (*document)["category_list"]["categories"].GetArray();
 	LoadCategoriesFromJSON(category_list);
 
-	if (config->resume_download)
+	bool incremental_sync = false;
+	bool sync_marks_collected = false;
+	std::map<int, std::map<int, std::string>> changed_topics = std::map<int, std::map<int, std::string>>();
+
+	// Marks are collected before downloading anything, so changes made while downloading are picked up next time
+	if (config->incremental_sync)
+	{
+		incremental_sync = DDL::Discourse::Downloader::LoadSyncState();
+		sync_marks_collected = DDL::Discourse::Downloader::CollectChangedTopics(&changed_topics) == DDLResult::Success_OK;
+
+		if (incremental_sync && !sync_marks_collected)
+		{
+			DDL::Logger::LogEvent("could not read the latest activity feeds, performing a full download instead", DDLLogLevel::Error);
+			incremental_sync = false;
+		}
+	}
+
+	if (config->resume_download && !incremental_sync)
 	{
 		bool resume_info_result = DDL::Discourse::Downloader::LoadResumeFile();
 		DDLResumeInfo* last_resume_info = DDL::Discourse::Downloader::GetLastResumeInfo();
@@ -592,7 +982,20 @@ void DDL::Discourse::Downloader::DownloadCategories()
 		{
 			DDL::Logger::LogEvent("resuming previous download...");
 
-			if (downloaded_categories.size() > 0)
+			// The user download only starts once every category has finished
+			if (last_resume_info->download_step == DDLResumeInfo::DownloadStep::USERS)
+			{
+				DDL::Logger::LogEvent("all categories will be skipped as they seem to already be downloaded");
+
+				for (DiscourseCategory* category : downloaded_categories)
+				{
+					delete category->json_file;
+					delete category;
+				}
+
+				downloaded_categories.clear();
+			}
+			else if (downloaded_categories.size() > 0)
 			{
 				while (downloaded_categories.at(0)->category_id != last_resume_info->category_id)
 				{
@@ -608,13 +1011,34 @@ void DDL::Discourse::Downloader::DownloadCategories()
 
 	for (DiscourseCategory* category : downloaded_categories)
 	{
-		download_category(category);
+		DDLResult category_result = DDLResult::Success_OK;
+
+		if (incremental_sync && DDL::Discourse::Downloader::HasSyncMark(category->category_id))
+		{
+			category_result = sync_category(category, &changed_topics[category->category_id]);
+		}
+		else
+		{
+			category_result = download_category(category);
+		}
+
+		if (config->incremental_sync)
+		{
+			DDL::Discourse::Downloader::FinishCategorySync(category->category_id, category_result == DDLResult::Success_OK);
+		}
+	}
+
+	if (sync_marks_collected)
+	{
+		DDL::Discourse::Downloader::SaveSyncState();
 	}
 
 	if (config->sanity_check_on_finish)
 	{
 		DDL::Logger::LogEvent("performing sanity check on existing data...");
 
+		std::chrono::steady_clock::time_point check_start_time = std::chrono::steady_clock::now();
+
 		// check that stored counts match up with category topic/post counts
 
 		for (DiscourseCategory* category : downloaded_categories)
@@ -624,15 +1048,30 @@ void DDL::Discourse::Downloader::DownloadCategories()
 
 			DDL::Logger::LogEvent("checking category " + std::to_string(category->category_id) + "...");
 
-			load_category_data_cache(category, config);
+			std::string category_directory = JSON_CATEGORY_ROOT_FORMAT;
+			{
+				category_directory = DDL::Utils::String::Replace(category_directory, "<JSON_ROOT>", config->json_path);
+				category_directory = DDL::Utils::String::Replace(category_directory, "<CAT_ID>", std::to_string(category->category_id));
+			}
+
+			// Only the counts are needed here, so they are read straight from the mapped cache rather than loading every topic
+			DDLTopicCache data_cache = DDLTopicCache();
+
+			if (config->enable_data_caching && !DDL::Discourse::Storage::OpenTopicCache(category_directory, true, &data_cache))
+			{
+				DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " is missing a data cache file, "
+					"category cannot be verified - this may result in an incomplete download!", DDLLogLevel::Error);
+			}
 
-			int saved_topic_count = category->topics.size();
+			int saved_topic_count = data_cache.GetTopicCount();
 			int reported_topic_count = (*category->json_file)["topic_count"].GetInt();
 
-			for (DiscourseTopic* topic : category->topics)
+			for (uint32_t i = 0; i < data_cache.GetTopicCount(); i++)
 			{
+				const DDLTopicCacheRecord* topic = data_cache.GetTopic(i);
+
 				int reported_post_count = topic->posts_count;
-				int saved_post_count = topic->posts.size();
+				int saved_post_count = topic->post_id_count;
 
 				if (saved_post_count != reported_post_count)
 				{
@@ -689,183 +1128,57 @@ void DDL::Discourse::Downloader::DownloadCategories()
 		}
 
 		DDL::Logger::LogEvent("sanity check finished");
+		DDL::Trace::RecordSpan("sanity check", "sanity_check", check_start_time);
 
 		if (config->thorough_sanity_check)
 		{
-			DDL::Logger::LogEvent("performing in-depth sanity check, this may take a while...");
-
-			int total_incomplete_categories = 0;
-			int total_missing_categories = 0;
-			int total_missing_topics = 0;
-			int total_missing_posts = 0;
+			DDLWorkStealingPool pool = DDLWorkStealingPool(config->sanity_check_threads);
+			DDLSanityCheckState check_state = DDLSanityCheckState();
 
-			std::vector<DiscourseCategory*> redownload_categories = std::vector<DiscourseCategory*>();
+			DDL::Logger::LogEvent("performing in-depth sanity check using " + std::to_string(pool.GetThreadCount()) + " threads, this may take a while...");
 
-			// go through each topic in each category and verify that each individual post json file exists
 			for (DiscourseCategory* category : downloaded_categories)
 			{
-				load_category_data_cache(category, config);
-
-				std::vector<DiscourseTopic*> redownload_topics = std::vector<DiscourseTopic*>();
-				bool missing_content = false;
-
-				std::string category_root = JSON_CATEGORY_ROOT_FORMAT;
+				pool.Submit([&, category]()
 				{
-					category_root = DDL::Utils::String::Replace(category_root, "<JSON_ROOT>", config->json_path);
-					category_root = DDL::Utils::String::Replace(category_root, "<CAT_ID>", std::to_string(category->category_id));
-				}
+					check_category_files(category, config, &check_state);
+				});
+			}
 
-				if (!DDL::Utils::IO::IsDirectory(category_root))
-				{
-					DDL::Logger::LogEvent("category " + std::to_string(category->category_id)
-						+ " does not appear to be downloaded, will attempt to redownload", DDLLogLevel::Warning);
+			pool.Wait();
 
-					total_missing_categories++;
-					redownload_categories.push_back(category);
-				}
-				else if (!DDL::Utils::IO::IsFile(category_root + "show.json"))
-				{
-					DDL::Logger::LogEvent("category " + std::to_string(category->category_id)
-						+ " missing category information json, will attempt to redownload", DDLLogLevel::Warning);
-
-					total_missing_categories++;
-					redownload_categories.push_back(category);
-				}
+			DDL::Trace::RecordSpan("in-depth sanity check", "sanity_check", check_state.start_time);
 
-				bool topic_count_mismatch = false;
+			DDL::Logger::LogEvent("checked " + std::to_string(check_state.checked_files) + " files (" + std::to_string((int)get_files_per_second(&check_state))
+				+ " files/sec), found " + std::to_string(check_state.missing_categories) + " missing categories, " + std::to_string(check_state.missing_topics)
+				+ " missing topics and " + std::to_string(check_state.missing_posts) + " missing posts");
 
-				if (config->strict_topic_count_checks)
-				{
-					if (category->topics.size() != (*category->json_file)["topic_count"].GetInt())
-					{
-						topic_count_mismatch = true;
-					}
-				}
-				else
-				{
-					if (category->topics.size() < (*category->json_file)["topic_count"].GetInt())
-					{
-						topic_count_mismatch = true;
-					}
-				}
+			// Redownloading goes through the network, so it happens once every category has been checked
+			for (std::pair<DiscourseCategory*, std::vector<DiscourseTopic*>>& category_topics : check_state.redownload_topics)
+			{
+				DiscourseCategory* category = category_topics.first;
 
-				if (topic_count_mismatch)
-				{
-					DDL::Logger::LogEvent("category " + std::to_string(category->category_id) + " has a topic count mismatch, category will "
-						"NOT be redownloaded automatically but you may want to using the category id whitelist options in website.cfg:", DDLLogLevel::Warning);
-					DDL::Logger::LogEvent("- reported topic count : " + std::to_string((*category->json_file)["topic_count"].GetInt()), DDLLogLevel::Warning);
-					DDL::Logger::LogEvent("- saved topic count    : " + std::to_string(category->topics.size()), DDLLogLevel::Warning);
+				DDL::Logger::LogEvent("attempting redownload of " + std::to_string(category_topics.second.size()) + " missing topics in category " + std::to_string(category->category_id)
+					+ ", this may take a while depending on how many topics are missing...");
 
-					missing_content = true;
-				}
+				std::map<int, std::string> redownload_topic_urls = std::map<int, std::string>();
 
-				for (DiscourseTopic* topic : category->topics)
+				for (DiscourseTopic* topic : category_topics.second)
 				{
-					bool topic_missing_content = false;
-
-					std::string topic_root = category_root + "topics/" + std::to_string(topic->topic_id) + "/";
-					std::string posts_root = topic_root + "posts/";
-
-					if (!DDL::Utils::IO::IsDirectory(topic_root))
-					{
-						DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
-							+ " directory is missing, topic will be redownloaded", DDLLogLevel::Warning);
-
-						missing_content = true;
-						topic_missing_content = true;
-						total_missing_topics++;
-					}
-					else if (!DDL::Utils::IO::IsFile(topic_root + "topic.json"))
-					{
-						DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
-							+ " information file is missing, topic will be redownloaded", DDLLogLevel::Warning);
-
-						missing_content = true;
-						topic_missing_content = true;
-						total_missing_topics++;
-					}
-
-					if (!DDL::Utils::IO::IsDirectory(posts_root))
-					{
-						DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
-							+ " posts directory is missing, topic will be redownloaded", DDLLogLevel::Warning);
-
-						missing_content = true;
-						topic_missing_content = true;
-						total_missing_posts += topic->posts_count;
-					}
-
-					bool post_count_mismatch = false;
-
-					if (config->strict_topic_count_checks)
-					{
-						if (topic->posts.size() != topic->posts_count)
-						{
-							post_count_mismatch = true;
-						}
-					}
-					else
-					{
-						if (topic->posts.size() < topic->posts_count)
-						{
-							post_count_mismatch = true;
-						}
-					}
-
-					if (post_count_mismatch)
-					{
-						DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
-							+ " has a post count mismatch, topic will be redownloaded:", DDLLogLevel::Warning);
-						DDL::Logger::LogEvent("- reported post count : " + std::to_string(topic->posts_count), DDLLogLevel::Warning);
-						DDL::Logger::LogEvent("- saved post count    : " + std::to_string(topic->posts.size()), DDLLogLevel::Warning);
-
-						missing_content = true;
-						topic_missing_content = true;
-					}
-
-					for (int post_id : topic->posts)
-					{
-						if (!DDL::Utils::IO::IsFile(posts_root + std::to_string(post_id) + ".json"))
-						{
-							DDL::Logger::LogEvent("topic " + std::to_string(topic->topic_id)
-								+ " is missing post " + std::to_string(post_id) + ", topic will be redownloaded", DDLLogLevel::Warning);
-
-							missing_content = true;
-							topic_missing_content = true;
-							total_missing_posts++;
-						}
-					}
-
-					if (topic_missing_content)
-					{
-						redownload_topics.push_back(topic);
-					}
+					redownload_topic_urls.insert(std::pair<int, std::string>(topic->topic_id, topic->request_url));
 				}
 
-				if (redownload_topics.size() > 0)
-				{
-					DDL::Logger::LogEvent("attempting redownload of " + std::to_string(redownload_topics.size()) + " missing topics in category " + std::to_string(category->category_id)
-						+ ", this may take a while depending on how many topics are missing...");
-
-					std::map<int, std::string> redownload_topic_urls = std::map<int, std::string>();
-
-					for (DiscourseTopic* topic : redownload_topics)
-					{
-						redownload_topic_urls.insert(std::pair<int, std::string>(topic->topic_id, topic->request_url));
-					}
+				DDL::Discourse::Downloader::DownloadTopics(category, &redownload_topic_urls);
 
-					DDL::Discourse::Downloader::DownloadTopics(category, &redownload_topic_urls);
-
-					DDL::Logger::LogEvent("finished redownloading missing topics in category " + std::to_string(category->category_id));
-				}
+				DDL::Logger::LogEvent("finished redownloading missing topics in category " + std::to_string(category->category_id));
 			}
 
-			if (redownload_categories.size() > 0)
+			if (check_state.redownload_categories.size() > 0)
 			{
-				DDL::Logger::LogEvent("attempting redownload of " + std::to_string(redownload_categories.size())
+				DDL::Logger::LogEvent("attempting redownload of " + std::to_string(check_state.redownload_categories.size())
 					+ " missing categories, this may take a while...");
 
-				for (DiscourseCategory* category : redownload_categories)
+				for (DiscourseCategory* category : check_state.redownload_categories)
 				{
 					download_category(category);
 				}
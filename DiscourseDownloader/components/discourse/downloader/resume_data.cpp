@@ -1,15 +1,276 @@
 #include "components/discourse/discourse.h"
 
+#include <algorithm>
+#include <io.h>
+#include <mutex>
+#include <filesystem>
+
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
+#include "components/discourse/storage/storage.h"
 #include "components/settings/settings.h"
 #include "components/utils/io/io.h"
 #include "components/utils/string/string.h"
 #include "components/utils/converters/converters.h"
+#include "components/utils/hash/hash.h"
+
+#define RESUME_JOURNAL_COMMIT_TIMEOUT 2 //!< Maximum number of seconds a journal record is held before being committed.
+#define RESUME_JOURNAL_COMPACT_THRESHOLD 10000 //!< Number of journal records after which the resume file is rewritten.
 
 bool last_resume_load_result = true;
 DDLResumeInfo last_resume_info = DDLResumeInfo();
 DDLResumeInfo current_resume_info = DDLResumeInfo();
 
+DDLResumeJournal* resume_journal = nullptr;
+std::recursive_mutex resume_mutex;
+
+/**
+* Retrieves the character used to mark a type of record in the journal.
+*/
+char get_journal_record_type_code(DDLResumeJournal::RecordType type)
+{
+	switch (type)
+	{
+		case DDLResumeJournal::RecordType::TOPIC:
+			return 't';
+		case DDLResumeJournal::RecordType::USER:
+			return 'u';
+		case DDLResumeJournal::RecordType::DIRECTORY_PAGE:
+			return 'p';
+	}
+
+	return '?';
+}
+
+/**
+* Builds a single journal record. The checksum covers the record fields, so a record which was only partially
+* written before the application was closed will not be mistaken for a valid one.
+*/
+std::string build_journal_record(DDLResumeJournal::RecordType type, int key, int id)
+{
+	std::string record_fields = std::string(1, get_journal_record_type_code(type)) + "," + std::to_string(key) + "," + std::to_string(id);
+
+	char checksum[9] = { 0 };
+	sprintf_s(checksum, sizeof(checksum), "%08x", DDL::Utils::Hash::CRC32(record_fields));
+
+	return record_fields + "," + std::string(checksum) + "\n";
+}
+
+/**
+* Parses a single journal record.
+*
+* @returns `true` if the record is complete and its checksum matches, otherwise returns `false`.
+*/
+bool parse_journal_record(std::string record, DDLResumeJournal::RecordType* type, int* key, int* id)
+{
+	size_t checksum_separator = record.rfind(',');
+
+	if (checksum_separator == std::string::npos || record.length() - checksum_separator - 1 != 8)
+	{
+		return false;
+	}
+
+	std::string record_fields = record.substr(0, checksum_separator);
+
+	char checksum[9] = { 0 };
+	sprintf_s(checksum, sizeof(checksum), "%08x", DDL::Utils::Hash::CRC32(record_fields));
+
+	if (record.substr(checksum_separator + 1) != std::string(checksum))
+	{
+		return false;
+	}
+
+	std::vector<std::string> fields = DDL::Utils::String::Split(record_fields, ",");
+
+	if (fields.size() != 3 || fields[0].length() != 1 || !DDL::Converters::IsStringInt(fields[1]) || !DDL::Converters::IsStringInt(fields[2]))
+	{
+		return false;
+	}
+
+	switch (fields[0][0])
+	{
+		case 't':
+			*type = DDLResumeJournal::RecordType::TOPIC;
+			break;
+		case 'u':
+			*type = DDLResumeJournal::RecordType::USER;
+			break;
+		case 'p':
+			*type = DDLResumeJournal::RecordType::DIRECTORY_PAGE;
+			break;
+		default:
+			return false;
+	}
+
+	*key = DDL::Converters::StringToInt(fields[1]);
+	*id = DDL::Converters::StringToInt(fields[2]);
+
+	return true;
+}
+
+/**
+* Applies a journal record from the user download to the resume information.
+*/
+void apply_user_journal_record(DDLResumeInfo* resume_info, DDLResumeJournal::RecordType type, int page_num, int user_id)
+{
+	if (type == DDLResumeJournal::RecordType::DIRECTORY_PAGE)
+	{
+		resume_info->last_directory_page = std::max(resume_info->last_directory_page, page_num);
+	}
+	else if (type == DDLResumeJournal::RecordType::USER)
+	{
+		resume_info->finished_users.insert(user_id);
+		resume_info->last_user_id = user_id;
+	}
+}
+
+/**
+* Writes data to a file and flushes it all the way to disk before returning.
+*/
+bool write_file_durably(FILE* file, const std::string& data)
+{
+	if (data.length() > 0 && fwrite(data.c_str(), 1, data.length(), file) != data.length())
+	{
+		return false;
+	}
+
+	return fflush(file) == 0 && _commit(_fileno(file)) == 0;
+}
+
+/**
+* Retrieves the resume journal, opening it on first use. The resume mutex must be held when calling this.
+*/
+DDLResumeJournal* get_resume_journal()
+{
+	if (!resume_journal)
+	{
+		WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+		if (!config)
+		{
+			return nullptr;
+		}
+
+		resume_journal = new DDLResumeJournal(config->site_directory_root + "/resume.journal", config->resume_commit_interval);
+	}
+
+	return resume_journal;
+}
+
+/**
+* Applies a user download record to the current resume information, and adds it to the journal. The resume mutex must
+* be held when calling this.
+*/
+void append_user_journal_record(DDLResumeJournal::RecordType type, int page_num, int user_id)
+{
+	apply_user_journal_record(&current_resume_info, type, page_num, user_id);
+
+	DDLResumeJournal* journal = get_resume_journal();
+
+	if (!journal)
+	{
+		return;
+	}
+
+	journal->Append(type, page_num, user_id);
+
+	if (journal->GetRecordCount() >= RESUME_JOURNAL_COMPACT_THRESHOLD)
+	{
+		DDL::Discourse::Downloader::SaveResumeFile();
+	}
+}
+
+DDLResumeJournal::DDLResumeJournal(std::string _journal_path, int _commit_interval)
+{
+	journal_path = _journal_path;
+	commit_interval = _commit_interval;
+
+	if (commit_interval < 1)
+	{
+		commit_interval = 1;
+	}
+
+	if (fopen_s(&journal_file, journal_path.c_str(), "ab") != 0)
+	{
+		journal_file = nullptr;
+		DDL::Logger::LogEvent("failed to open resume journal '" + journal_path + "', download progress will only be saved between categories", DDLLogLevel::Error);
+	}
+}
+
+DDLResumeJournal::~DDLResumeJournal()
+{
+	Commit();
+
+	if (journal_file)
+	{
+		fclose(journal_file);
+		journal_file = nullptr;
+	}
+}
+
+void DDLResumeJournal::Append(RecordType type, int key, int id)
+{
+	pending_records += build_journal_record(type, key, id);
+	pending_record_count++;
+	record_count++;
+
+	if (pending_record_count >= commit_interval
+		|| std::chrono::steady_clock::now() - last_commit_time >= std::chrono::seconds(RESUME_JOURNAL_COMMIT_TIMEOUT))
+	{
+		Commit();
+	}
+}
+
+void DDLResumeJournal::Commit()
+{
+	last_commit_time = std::chrono::steady_clock::now();
+
+	if (pending_record_count == 0 || !journal_file)
+	{
+		return;
+	}
+
+	// The archive index is buffered, so it has to be written out before any of its topics are recorded as finished
+	DDLArchiveStore* archive_store = DDL::Discourse::Storage::GetArchiveStore();
+
+	if (archive_store)
+	{
+		archive_store->Flush();
+	}
+
+	if (!write_file_durably(journal_file, pending_records))
+	{
+		DDL::Logger::LogEvent("failed to write " + std::to_string(pending_record_count) + " records to resume journal", DDLLogLevel::Error);
+	}
+
+	pending_records.clear();
+	pending_record_count = 0;
+}
+
+void DDLResumeJournal::Clear()
+{
+	pending_records.clear();
+	pending_record_count = 0;
+	record_count = 0;
+
+	if (journal_file)
+	{
+		fclose(journal_file);
+		journal_file = nullptr;
+	}
+
+	if (fopen_s(&journal_file, journal_path.c_str(), "wb") != 0)
+	{
+		journal_file = nullptr;
+		DDL::Logger::LogEvent("failed to reset resume journal '" + journal_path + "'", DDLLogLevel::Error);
+	}
+}
+
+int DDLResumeJournal::GetRecordCount()
+{
+	return record_count;
+}
+
 bool DDL::Discourse::Downloader::LoadResumeFile()
 {
 	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
@@ -53,40 +314,46 @@ bool DDL::Discourse::Downloader::LoadResumeFile()
 				last_resume_info.last_saved_topic = DDL::Converters::StringToInt(line_value);
 			}
 		}
-		else if (line.starts_with("topic_first_id="))
+		else if (line.starts_with("finished_topics="))
 		{
-			std::string line_value = DDL::Utils::String::Replace(line, "topic_first_id=", "");
+			std::vector<std::string> topic_ids = DDL::Utils::String::Split(DDL::Utils::String::Replace(line, "finished_topics=", ""), ",");
 
-			if (DDL::Converters::IsStringInt(line_value))
+			for (std::string topic_id : topic_ids)
 			{
-				last_resume_info.topic_first_id = DDL::Converters::StringToInt(line_value);
+				if (topic_id.length() > 0 && DDL::Converters::IsStringInt(topic_id))
+				{
+					last_resume_info.finished_topics.insert(DDL::Converters::StringToInt(topic_id));
+				}
 			}
 		}
-		else if (line.starts_with("topic_last_id="))
+		else if (line.starts_with("last_user_id="))
 		{
-			std::string line_value = DDL::Utils::String::Replace(line, "topic_last_id=", "");
+			std::string line_value = DDL::Utils::String::Replace(line, "last_user_id=", "");
 
 			if (DDL::Converters::IsStringInt(line_value))
 			{
-				last_resume_info.topic_last_id = DDL::Converters::StringToInt(line_value);
+				last_resume_info.last_user_id = DDL::Converters::StringToInt(line_value);
 			}
 		}
-		else if (line.starts_with("topic_download_index="))
+		else if (line.starts_with("last_directory_page="))
 		{
-			std::string line_value = DDL::Utils::String::Replace(line, "topic_download_index=", "");
+			std::string line_value = DDL::Utils::String::Replace(line, "last_directory_page=", "");
 
 			if (DDL::Converters::IsStringInt(line_value))
 			{
-				last_resume_info.topic_download_index = DDL::Converters::StringToInt(line_value);
+				last_resume_info.last_directory_page = DDL::Converters::StringToInt(line_value);
 			}
 		}
-		else if (line.starts_with("last_user_id="))
+		else if (line.starts_with("finished_users="))
 		{
-			std::string line_value = DDL::Utils::String::Replace(line, "last_user_id=", "");
+			std::vector<std::string> user_ids = DDL::Utils::String::Split(DDL::Utils::String::Replace(line, "finished_users=", ""), ",");
 
-			if (DDL::Converters::IsStringInt(line_value))
+			for (std::string user_id : user_ids)
 			{
-				last_resume_info.last_user_id = DDL::Converters::StringToInt(line_value);
+				if (user_id.length() > 0 && DDL::Converters::IsStringInt(user_id))
+				{
+					last_resume_info.finished_users.insert(DDL::Converters::StringToInt(user_id));
+				}
 			}
 		}
 		else if (line.starts_with("download_step="))
@@ -101,27 +368,81 @@ bool DDL::Discourse::Downloader::LoadResumeFile()
 			{
 				last_resume_info.download_step = DDLResumeInfo::DownloadStep::USERS;
 			}
+			else if (DDL::Utils::String::ToLower(line_value) == "complete")
+			{
+				last_resume_info.download_step = DDLResumeInfo::DownloadStep::COMPLETE;
+			}
 		}
 	}
 
-	if (last_resume_info.download_step != DDLResumeInfo::DownloadStep::INVALID)
+	if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::COMPLETE)
 	{
-		if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::TOPICS)
+		DDL::Logger::LogEvent("previous download finished, starting a new download");
+		last_resume_load_result = false;
+		return false;
+	}
+
+	// Topics and users finished since the resume file was last written are only recorded in the journal
+	if (last_resume_info.download_step != DDLResumeInfo::DownloadStep::INVALID && DDL::Utils::IO::IsFile(config->site_directory_root + "/resume.journal"))
+	{
+		std::vector<std::string> journal_records = DDL::Utils::IO::GetFileContentsAsLines(config->site_directory_root + "/resume.journal");
+		int journal_record_count = 0;
+
+		for (std::string record : journal_records)
 		{
-			if (last_resume_info.category_id != -1 && last_resume_info.last_saved_topic != -1)
+			DDLResumeJournal::RecordType record_type = DDLResumeJournal::RecordType::TOPIC;
+			int record_key = -1;
+			int record_id = -1;
+
+			if (record.length() == 0)
 			{
-				last_resume_load_result = true;
-				return true;
+				continue;
+			}
+
+			// Records are only ever appended, so anything after a damaged record was never committed
+			if (!parse_journal_record(record, &record_type, &record_key, &record_id))
+			{
+				DDL::Logger::LogEvent("resume journal contains a damaged record, ignoring it and any records after it", DDLLogLevel::Warning);
+				break;
+			}
+
+			// The journal is only cleared once a new resume file is in place, so it may still hold records from the step before
+			if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::USERS)
+			{
+				if (record_type != DDLResumeJournal::RecordType::TOPIC)
+				{
+					apply_user_journal_record(&last_resume_info, record_type, record_key, record_id);
+					journal_record_count++;
+				}
+			}
+			else if (record_type == DDLResumeJournal::RecordType::TOPIC && record_key == last_resume_info.category_id)
+			{
+				last_resume_info.finished_topics.insert(record_id);
+				last_resume_info.last_saved_topic = record_id;
+				journal_record_count++;
 			}
 		}
-		else if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::TOPICS)
+
+		DDL::Logger::LogEvent("loaded " + std::to_string(journal_record_count) + " finished "
+			+ ((last_resume_info.download_step == DDLResumeInfo::DownloadStep::USERS) ? "users" : "topics") + " from resume journal");
+	}
+
+	if (last_resume_info.download_step != DDLResumeInfo::DownloadStep::INVALID)
+	{
+		if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::TOPICS)
 		{
-			if (last_resume_info.last_user_id != -1)
+			if (last_resume_info.category_id != -1)
 			{
 				last_resume_load_result = true;
 				return true;
 			}
 		}
+		else if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::USERS)
+		{
+			// Every category has finished by this point, even if no users have yet
+			last_resume_load_result = true;
+			return true;
+		}
 	}
 
 	DDL::Logger::LogEvent("!!!!!! could not parse download resume information file - DOWNLOAD WILL BE RESTARTED!", DDLLogLevel::Error);
@@ -133,6 +454,8 @@ bool DDL::Discourse::Downloader::LoadResumeFile()
 
 void DDL::Discourse::Downloader::SaveResumeFile()
 {
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
 	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
 	if (!config)
@@ -145,10 +468,24 @@ void DDL::Discourse::Downloader::SaveResumeFile()
 	{
 		resume_file_contents += "category_id=" + std::to_string(current_resume_info.category_id) + "\n";
 		resume_file_contents += "last_saved_topic=" + std::to_string(current_resume_info.last_saved_topic) + "\n";
-		resume_file_contents += "topic_first_id=" + std::to_string(current_resume_info.topic_first_id) + "\n";
-		resume_file_contents += "topic_last_id=" + std::to_string(current_resume_info.topic_last_id) + "\n";
-		resume_file_contents += "topic_download_index=" + std::to_string(current_resume_info.topic_download_index) + "\n";
+		resume_file_contents += "finished_topics=";
+
+		for (int topic_id : current_resume_info.finished_topics)
+		{
+			resume_file_contents += std::to_string(topic_id) + ",";
+		}
+
+		resume_file_contents += "\n";
 		resume_file_contents += "last_user_id=" + std::to_string(current_resume_info.last_user_id) + "\n";
+		resume_file_contents += "last_directory_page=" + std::to_string(current_resume_info.last_directory_page) + "\n";
+		resume_file_contents += "finished_users=";
+
+		for (int user_id : current_resume_info.finished_users)
+		{
+			resume_file_contents += std::to_string(user_id) + ",";
+		}
+
+		resume_file_contents += "\n";
 
 		if (current_resume_info.download_step == DDLResumeInfo::DownloadStep::TOPICS)
 		{
@@ -158,13 +495,234 @@ void DDL::Discourse::Downloader::SaveResumeFile()
 		{
 			resume_file_contents += "download_step=USERS";
 		}
+		else if (current_resume_info.download_step == DDLResumeInfo::DownloadStep::COMPLETE)
+		{
+			resume_file_contents += "download_step=COMPLETE";
+		}
 		else
 		{
 			resume_file_contents += "download_step=INVALID";
 		}
 	}
 
-	DDL::Utils::IO::CreateNewFile(config->site_directory_root + "/resume", resume_file_contents);
+	// Write the new resume file alongside the old one and swap it in, so an interruption leaves one or the other intact
+	std::string resume_path = config->site_directory_root + "/resume";
+	FILE* resume_file = nullptr;
+
+	if (fopen_s(&resume_file, (resume_path + ".tmp").c_str(), "wb") != 0 || !resume_file)
+	{
+		DDL::Logger::LogEvent("failed to save resume info - could not create '" + resume_path + ".tmp'", DDLLogLevel::Error);
+		return;
+	}
+
+	bool write_result = write_file_durably(resume_file, resume_file_contents);
+	fclose(resume_file);
+
+	std::error_code rename_error;
+
+	if (write_result)
+	{
+		std::filesystem::rename(resume_path + ".tmp", resume_path, rename_error);
+	}
+
+	if (!write_result || rename_error)
+	{
+		DDL::Logger::LogEvent("failed to save resume info - could not replace '" + resume_path + "'", DDLLogLevel::Error);
+		return;
+	}
+
+	// Everything in the journal is now part of the resume file
+	DDLResumeJournal* journal = get_resume_journal();
+
+	if (journal)
+	{
+		journal->Clear();
+	}
+}
+
+void DDL::Discourse::Downloader::BeginResumeCategory(int category_id)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	current_resume_info.download_step = DDLResumeInfo::DownloadStep::TOPICS;
+	current_resume_info.category_id = category_id;
+	current_resume_info.last_saved_topic = -1;
+	current_resume_info.finished_topics.clear();
+
+	DDLResumeInfo* last_info = GetLastResumeInfo();
+
+	if (last_info && last_info->download_step == DDLResumeInfo::DownloadStep::TOPICS && last_info->category_id == category_id)
+	{
+		current_resume_info.finished_topics = last_info->finished_topics;
+		current_resume_info.last_saved_topic = last_info->last_saved_topic;
+
+		if (current_resume_info.finished_topics.size() > 0)
+		{
+			DDL::Logger::LogEvent("resuming category " + std::to_string(category_id) + " with " + std::to_string(current_resume_info.finished_topics.size())
+				+ " topics already finished");
+		}
+	}
+
+	SaveResumeFile();
+}
+
+void DDL::Discourse::Downloader::RecordFinishedTopic(int category_id, int topic_id)
+{
+	static DDLMetricCounter* topic_counter = DDL::Metrics::GetCounter("ddl_topics_saved_total", "The number of topics downloaded and saved.");
+	topic_counter->Increment();
+
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	if (current_resume_info.download_step != DDLResumeInfo::DownloadStep::TOPICS || current_resume_info.category_id != category_id)
+	{
+		return;
+	}
+
+	current_resume_info.finished_topics.insert(topic_id);
+	current_resume_info.last_saved_topic = topic_id;
+
+	DDLResumeJournal* journal = get_resume_journal();
+
+	if (!journal)
+	{
+		return;
+	}
+
+	journal->Append(DDLResumeJournal::RecordType::TOPIC, category_id, topic_id);
+
+	if (journal->GetRecordCount() >= RESUME_JOURNAL_COMPACT_THRESHOLD)
+	{
+		SaveResumeFile();
+	}
+}
+
+bool DDL::Discourse::Downloader::WasTopicFinished(int category_id, int topic_id)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	DDLResumeInfo* last_info = GetLastResumeInfo();
+
+	if (!last_info || last_info->download_step != DDLResumeInfo::DownloadStep::TOPICS || last_info->category_id != category_id)
+	{
+		return false;
+	}
+
+	return last_info->finished_topics.contains(topic_id);
+}
+
+void DDL::Discourse::Downloader::FinishResumeCategory(int category_id)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	if (last_resume_info.download_step == DDLResumeInfo::DownloadStep::TOPICS && last_resume_info.category_id == category_id)
+	{
+		last_resume_info.finished_topics.clear();
+	}
+}
+
+void DDL::Discourse::Downloader::BeginResumeUsers()
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	current_resume_info.download_step = DDLResumeInfo::DownloadStep::USERS;
+	current_resume_info.last_user_id = -1;
+	current_resume_info.last_directory_page = -1;
+	current_resume_info.finished_users.clear();
+
+	DDLResumeInfo* last_info = GetLastResumeInfo();
+
+	if (last_info && last_info->download_step == DDLResumeInfo::DownloadStep::USERS)
+	{
+		current_resume_info.last_user_id = last_info->last_user_id;
+		current_resume_info.last_directory_page = last_info->last_directory_page;
+		current_resume_info.finished_users = last_info->finished_users;
+
+		DDL::Logger::LogEvent("resuming user download from directory page " + std::to_string(current_resume_info.last_directory_page + 1)
+			+ " with " + std::to_string(current_resume_info.finished_users.size()) + " users on later pages already finished");
+	}
+
+	SaveResumeFile();
+}
+
+void DDL::Discourse::Downloader::RecordFinishedUser(int page_num, int user_id)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	if (current_resume_info.download_step != DDLResumeInfo::DownloadStep::USERS)
+	{
+		return;
+	}
+
+	append_user_journal_record(DDLResumeJournal::RecordType::USER, page_num, user_id);
+}
+
+void DDL::Discourse::Downloader::RecordFinishedDirectoryPage(int page_num, std::vector<int>* user_ids)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	if (current_resume_info.download_step != DDLResumeInfo::DownloadStep::USERS)
+	{
+		return;
+	}
+
+	// Users on finished pages are never looked at again, so there is no need to keep them in the resume file
+	for (int user_id : *user_ids)
+	{
+		current_resume_info.finished_users.erase(user_id);
+	}
+
+	append_user_journal_record(DDLResumeJournal::RecordType::DIRECTORY_PAGE, page_num, -1);
+
+	// Page records are rare, so they are committed straight away rather than risking a page being read again
+	FlushResumeJournal();
+}
+
+bool DDL::Discourse::Downloader::WasUserFinished(int user_id)
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	DDLResumeInfo* last_info = GetLastResumeInfo();
+
+	if (!last_info || last_info->download_step != DDLResumeInfo::DownloadStep::USERS)
+	{
+		return false;
+	}
+
+	return last_info->finished_users.contains(user_id);
+}
+
+int DDL::Discourse::Downloader::GetResumeDirectoryPage()
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	DDLResumeInfo* last_info = GetLastResumeInfo();
+
+	if (!last_info || last_info->download_step != DDLResumeInfo::DownloadStep::USERS)
+	{
+		return 0;
+	}
+
+	return last_info->last_directory_page + 1;
+}
+
+void DDL::Discourse::Downloader::FinishResumeDownload()
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	current_resume_info = DDLResumeInfo();
+	current_resume_info.download_step = DDLResumeInfo::DownloadStep::COMPLETE;
+
+	SaveResumeFile();
+}
+
+void DDL::Discourse::Downloader::FlushResumeJournal()
+{
+	std::lock_guard<std::recursive_mutex> lock = std::lock_guard<std::recursive_mutex>(resume_mutex);
+
+	if (resume_journal)
+	{
+		resume_journal->Commit();
+	}
 }
 
 DDLResumeInfo* DDL::Discourse::Downloader::GetLastResumeInfo()
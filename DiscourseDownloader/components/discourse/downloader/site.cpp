@@ -136,14 +136,10 @@ void DDL::Discourse::Downloader::DownloadSiteInfo()
 						if (flair_url.length() > 0)
 						{
 							int flair_http_code = -1;
-							std::string flair_response = DDL::Utils::Network::PerformHTTPRequestWithRetries(flair_url, &flair_http_code);
+							std::string extension = flair_url.substr(flair_url.find_last_of('.'));
+							std::string flair_path = groups_dir + std::to_string(group_id) + "_" + group_name + "_flair" + extension;
 
-							if (flair_http_code == 200)
-							{
-								std::string extension = flair_url.substr(flair_url.find_last_of('.'));
-								DDL::Utils::IO::CreateNewFile(groups_dir + std::to_string(group_id) + "_" + group_name + "_flair" + extension, flair_response);
-							}
-							else
+							if (!DDL::Utils::Network::DownloadFileWithRetries(flair_url, flair_path, &flair_http_code))
 							{
 								DDL::Logger::LogEvent("failed to download flair image for group " + group_name + ", image will be skipped (got http "
 									+ std::to_string(flair_http_code) + ")!", DDLLogLevel::Error);
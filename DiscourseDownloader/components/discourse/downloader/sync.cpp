@@ -0,0 +1,420 @@
+#include "components/discourse/discourse.h"
+
+#include <filesystem>
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/trace/trace.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+#include "components/utils/network/network.h"
+#include "components/utils/converters/converters.h"
+
+#define SYNC_STATE_CATEGORY_PREFIX std::string("category_")
+
+bool last_sync_load_result = false;
+DDLSyncState last_sync_state = DDLSyncState();
+DDLSyncState next_sync_state = DDLSyncState();
+
+/**
+* Retrieves the `bumped_at` mark that changed topics in a category are compared against.
+*/
+std::string get_category_mark(int category_id)
+{
+	if (last_sync_state.category_bumped_at.contains(category_id))
+	{
+		return last_sync_state.category_bumped_at.at(category_id);
+	}
+
+	return "";
+}
+
+/**
+* Adds a topic to the list of changed topics for its category.
+*/
+void add_changed_topic(std::map<int, std::map<int, std::string>>* changed_topics, int category_id, int topic_id, WebsiteConfig* config)
+{
+	std::string topic_info_url = TOPIC_INFO_URL_FORMAT;
+	{
+		topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<BASE_URL>", config->website_url);
+		topic_info_url = DDL::Utils::String::Replace(topic_info_url, "<TOPIC_ID>", std::to_string(topic_id));
+	}
+
+	(*changed_topics)[category_id].insert(std::pair<int, std::string>(topic_id, topic_info_url));
+}
+
+/**
+* Pages through the latest topics feed, newest activity first, collecting every topic bumped since its category's mark.
+*/
+DDLResult collect_changed_topics(std::map<int, std::map<int, std::string>>* changed_topics, WebsiteConfig* config)
+{
+	// The feed is ordered by bumped_at, so once a topic older than every mark is reached, nothing after it has changed
+	std::string oldest_mark = "";
+
+	for (std::pair<const int, std::string>& it : last_sync_state.category_bumped_at)
+	{
+		if (oldest_mark.length() == 0 || it.second < oldest_mark)
+		{
+			oldest_mark = it.second;
+		}
+	}
+
+	std::string latest_url_base = DDL::Utils::String::Replace(LATEST_TOPICS_URL_FORMAT, "<BASE_URL>", config->website_url);
+	int changed_topic_count = 0;
+	int page = 0;
+
+	while (true)
+	{
+		int http_code = -1;
+		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(latest_url_base + std::to_string(page), &http_code);
+
+		if (http_code != 200)
+		{
+			DDL::Logger::LogEvent("got http " + std::to_string(http_code) + " while reading latest topics, changes cannot be detected!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		rapidjson::Document latest_document = rapidjson::Document();
+		{
+			DDLTraceSpan parse_span = DDLTraceSpan("parse latest topics", "json");
+			latest_document.ParseInsitu(response.data());
+		}
+
+		if (latest_document.HasParseError() || !latest_document.HasMember("topic_list") || !latest_document["topic_list"].HasMember("topics")
+			|| !latest_document["topic_list"]["topics"].IsArray())
+		{
+			DDL::Logger::LogEvent("latest topics response could not be parsed, changes cannot be detected!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		rapidjson::Value& topic_list_json = latest_document["topic_list"];
+		bool reached_oldest_mark = false;
+
+		for (rapidjson::Value& topic_json : topic_list_json["topics"].GetArray())
+		{
+			if (!topic_json.HasMember("id") || !topic_json["id"].IsInt() || !topic_json.HasMember("category_id") || !topic_json["category_id"].IsInt()
+				|| !topic_json.HasMember("bumped_at") || !topic_json["bumped_at"].IsString())
+			{
+				continue;
+			}
+
+			int topic_id = topic_json["id"].GetInt();
+			int category_id = topic_json["category_id"].GetInt();
+			std::string bumped_at = topic_json["bumped_at"].GetString();
+
+			if (bumped_at > next_sync_state.default_bumped_at)
+			{
+				next_sync_state.default_bumped_at = bumped_at;
+			}
+
+			// Pinned topics are listed first regardless of when they were last bumped
+			bool pinned = topic_json.HasMember("pinned") && topic_json["pinned"].IsBool() && topic_json["pinned"].GetBool();
+
+			if (!pinned && oldest_mark.length() > 0 && bumped_at <= oldest_mark)
+			{
+				reached_oldest_mark = true;
+				break;
+			}
+
+			if (!last_sync_state.category_bumped_at.contains(category_id) || bumped_at <= get_category_mark(category_id))
+			{
+				continue;
+			}
+
+			add_changed_topic(changed_topics, category_id, topic_id, config);
+			changed_topic_count++;
+
+			if (bumped_at > next_sync_state.category_bumped_at[category_id])
+			{
+				next_sync_state.category_bumped_at[category_id] = bumped_at;
+			}
+		}
+
+		if (reached_oldest_mark || !topic_list_json.HasMember("more_topics_url"))
+		{
+			break;
+		}
+
+		page++;
+	}
+
+	DDL::Logger::LogEvent("found " + std::to_string(changed_topic_count) + " topics with new activity across "
+		+ std::to_string(page + 1) + " pages of latest topics");
+
+	return DDLResult::Success_OK;
+}
+
+/**
+* Pages backwards through the latest posts feed until reaching the highest post ID seen by the last sync. The topic of
+* every new post is added to the changed topics, which catches posts the latest topics feed would not bump.
+*/
+DDLResult collect_new_posts(std::map<int, std::map<int, std::string>>* changed_topics, WebsiteConfig* config)
+{
+	std::string posts_url_base = DDL::Utils::String::Replace(LATEST_POSTS_URL_FORMAT, "<BASE_URL>", config->website_url);
+	std::string posts_url = posts_url_base;
+	int new_post_count = 0;
+
+	while (true)
+	{
+		int http_code = -1;
+		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(posts_url, &http_code);
+
+		if (http_code != 200)
+		{
+			DDL::Logger::LogEvent("got http " + std::to_string(http_code) + " while reading latest posts, changes cannot be detected!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		rapidjson::Document posts_document = rapidjson::Document();
+		{
+			DDLTraceSpan parse_span = DDLTraceSpan("parse latest posts", "json");
+			posts_document.ParseInsitu(response.data());
+		}
+
+		if (posts_document.HasParseError() || !posts_document.HasMember("latest_posts") || !posts_document["latest_posts"].IsArray())
+		{
+			DDL::Logger::LogEvent("latest posts response could not be parsed, changes cannot be detected!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		rapidjson::GenericArray posts_json = posts_document["latest_posts"].GetArray();
+		int oldest_post_id = -1;
+		bool reached_mark = posts_json.Size() == 0;
+
+		for (rapidjson::Value& post_json : posts_json)
+		{
+			if (!post_json.HasMember("id") || !post_json["id"].IsInt())
+			{
+				continue;
+			}
+
+			int post_id = post_json["id"].GetInt();
+
+			if (post_id > next_sync_state.max_post_id)
+			{
+				next_sync_state.max_post_id = post_id;
+			}
+
+			if (oldest_post_id == -1 || post_id < oldest_post_id)
+			{
+				oldest_post_id = post_id;
+			}
+
+			if (post_id <= last_sync_state.max_post_id)
+			{
+				reached_mark = true;
+				continue;
+			}
+
+			if (!post_json.HasMember("category_id") || !post_json["category_id"].IsInt() || !post_json.HasMember("topic_id") || !post_json["topic_id"].IsInt())
+			{
+				continue;
+			}
+
+			int category_id = post_json["category_id"].GetInt();
+
+			if (last_sync_state.category_bumped_at.contains(category_id))
+			{
+				add_changed_topic(changed_topics, category_id, post_json["topic_id"].GetInt(), config);
+				new_post_count++;
+			}
+		}
+
+		// Without a previous sync, the first page is only needed for the newest post ID
+		if (reached_mark || oldest_post_id <= 1 || !last_sync_load_result)
+		{
+			break;
+		}
+
+		posts_url = posts_url_base + "?before=" + std::to_string(oldest_post_id);
+	}
+
+	if (last_sync_load_result)
+	{
+		DDL::Logger::LogEvent("found " + std::to_string(new_post_count) + " new posts since the last sync");
+	}
+
+	return DDLResult::Success_OK;
+}
+
+bool DDL::Discourse::Downloader::LoadSyncState()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	last_sync_state = DDLSyncState();
+	last_sync_load_result = false;
+
+	if (!config)
+	{
+		return false;
+	}
+
+	if (!DDL::Utils::IO::IsFile(config->site_directory_root + "/sync_state"))
+	{
+		DDL::Logger::LogEvent("no sync state found, performing a full download - later runs will only fetch changes "
+			"(note: this is normal for the first incremental sync)", DDLLogLevel::Warning);
+		return false;
+	}
+
+	std::vector<std::string> sync_state_lines = DDL::Utils::IO::GetFileContentsAsLines(config->site_directory_root + "/sync_state");
+
+	for (std::string line : sync_state_lines)
+	{
+		if (line.starts_with("max_post_id="))
+		{
+			std::string line_value = DDL::Utils::String::Replace(line, "max_post_id=", "");
+
+			if (line_value.length() > 0 && DDL::Converters::IsStringInt(line_value))
+			{
+				last_sync_state.max_post_id = DDL::Converters::StringToInt(line_value);
+			}
+		}
+		else if (line.starts_with(SYNC_STATE_CATEGORY_PREFIX))
+		{
+			std::vector<std::string> components = DDL::Utils::String::Split(line.substr(SYNC_STATE_CATEGORY_PREFIX.length()), "=");
+
+			if (components.size() == 2 && components.at(0).length() > 0 && DDL::Converters::IsStringInt(components.at(0)))
+			{
+				last_sync_state.category_bumped_at.insert_or_assign(DDL::Converters::StringToInt(components.at(0)), components.at(1));
+			}
+		}
+	}
+
+	if (last_sync_state.max_post_id == -1 || last_sync_state.category_bumped_at.size() == 0)
+	{
+		DDL::Logger::LogEvent("sync state file is incomplete, performing a full download instead", DDLLogLevel::Error);
+		last_sync_state = DDLSyncState();
+		return false;
+	}
+
+	last_sync_load_result = true;
+	return true;
+}
+
+DDLResult DDL::Discourse::Downloader::CollectChangedTopics(std::map<int, std::map<int, std::string>>* changed_topics)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - changes cannot be detected!", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
+
+	next_sync_state = last_sync_state;
+
+	// Without a previous sync only the current marks are needed, which the first page of each feed is enough for
+	if (!last_sync_load_result)
+	{
+		int http_code = -1;
+		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(
+			DDL::Utils::String::Replace(LATEST_TOPICS_URL_FORMAT, "<BASE_URL>", config->website_url) + "0", &http_code);
+
+		if (http_code != 200)
+		{
+			DDL::Logger::LogEvent("got http " + std::to_string(http_code) + " while reading latest topics, sync state will not be saved!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		rapidjson::Document latest_document = rapidjson::Document();
+		{
+			DDLTraceSpan parse_span = DDLTraceSpan("parse latest topics", "json");
+			latest_document.ParseInsitu(response.data());
+		}
+
+		if (latest_document.HasParseError() || !latest_document.HasMember("topic_list") || !latest_document["topic_list"].HasMember("topics")
+			|| !latest_document["topic_list"]["topics"].IsArray())
+		{
+			DDL::Logger::LogEvent("latest topics response could not be parsed, sync state will not be saved!", DDLLogLevel::Error);
+			return DDLResult::Error_IncompleteDownload;
+		}
+
+		for (rapidjson::Value& topic_json : latest_document["topic_list"]["topics"].GetArray())
+		{
+			if (topic_json.HasMember("bumped_at") && topic_json["bumped_at"].IsString()
+				&& std::string(topic_json["bumped_at"].GetString()) > next_sync_state.default_bumped_at)
+			{
+				next_sync_state.default_bumped_at = topic_json["bumped_at"].GetString();
+			}
+		}
+
+		return collect_new_posts(changed_topics, config);
+	}
+
+	DDLResult topic_result = collect_changed_topics(changed_topics, config);
+
+	if (topic_result != DDLResult::Success_OK)
+	{
+		return topic_result;
+	}
+
+	return collect_new_posts(changed_topics, config);
+}
+
+bool DDL::Discourse::Downloader::HasSyncMark(int category_id)
+{
+	return last_sync_load_result && last_sync_state.category_bumped_at.contains(category_id);
+}
+
+void DDL::Discourse::Downloader::FinishCategorySync(int category_id, bool success)
+{
+	if (!success)
+	{
+		// Keep the old mark (or none at all), so the same changes are picked up again next time
+		if (last_sync_state.category_bumped_at.contains(category_id))
+		{
+			next_sync_state.category_bumped_at.insert_or_assign(category_id, last_sync_state.category_bumped_at.at(category_id));
+		}
+		else
+		{
+			next_sync_state.category_bumped_at.erase(category_id);
+		}
+
+		return;
+	}
+
+	if (!next_sync_state.category_bumped_at.contains(category_id))
+	{
+		next_sync_state.category_bumped_at.insert_or_assign(category_id, next_sync_state.default_bumped_at);
+	}
+}
+
+void DDL::Discourse::Downloader::SaveSyncState()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		DDL::Logger::LogEvent("failed to save sync state - could not get website config!", DDLLogLevel::Error);
+		return;
+	}
+
+	if (next_sync_state.max_post_id == -1 || next_sync_state.category_bumped_at.size() == 0)
+	{
+		DDL::Logger::LogEvent("no sync marks were collected, sync state will not be saved - the next run will be a full download", DDLLogLevel::Warning);
+		return;
+	}
+
+	std::string sync_state_contents = "max_post_id=" + std::to_string(next_sync_state.max_post_id) + "\n";
+
+	for (std::pair<const int, std::string>& it : next_sync_state.category_bumped_at)
+	{
+		sync_state_contents += SYNC_STATE_CATEGORY_PREFIX + std::to_string(it.first) + "=" + it.second + "\n";
+	}
+
+	std::string sync_state_path = config->site_directory_root + "/sync_state";
+	std::error_code rename_error;
+
+	if (DDL::Utils::IO::CreateNewFile(sync_state_path + ".tmp", sync_state_contents))
+	{
+		std::filesystem::rename(sync_state_path + ".tmp", sync_state_path, rename_error);
+
+		if (!rename_error)
+		{
+			DDL::Logger::LogEvent("saved sync state for " + std::to_string(next_sync_state.category_bumped_at.size()) + " categories");
+			return;
+		}
+	}
+
+	DDL::Logger::LogEvent("failed to save sync state, the next sync will fetch the same changes again", DDLLogLevel::Error);
+}
@@ -1,336 +1,492 @@
 #include "components/discourse/discourse.h"
 
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/trace/trace.h"
 #include "components/settings/settings.h"
 #include "components/utils/io/io.h"
 #include "components/utils/network/network.h"
 #include "components/utils/string/string.h"
 #include "components/utils/json/json.h"
+#include "components/discourse/storage/storage.h"
 
-DDLResult DDL::Discourse::Downloader::DownloadTopics(DiscourseCategory* category, std::map<int, std::string>* topic_url_list)
+// Large enough to hold a full topic or post chunk response without the parse allocator needing another chunk
+#define TOPIC_PARSE_BUFFER_SIZE (512 * 1024)
+#define TOPIC_PARSE_STACK_CAPACITY (16 * 1024)
+
+// Shared by every topic downloader, so the server's limit only has to be found once per run
+int post_chunk_size = -1;
+
+DDLTopicDownloader::DDLTopicDownloader(DiscourseCategory* _category, DDLRequestQueue* _request_queue)
 {
-	bool incomplete_download = false;
+	category = _category;
+	request_queue = _request_queue;
 
-	DDLResumeInfo* current_resume_info = DDL::Discourse::Downloader::GetCurrentResumeInfo();
 	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-	if (!config)
+	topic_dir_base = JSON_CATEGORY_ROOT_FORMAT + "topics/";
 	{
-		DDL::Logger::LogEvent("could not get website config - skipping category topics", DDLLogLevel::Error);
-		return DDLResult::Error_NullPointer;
+		topic_dir_base = DDL::Utils::String::Replace(topic_dir_base, "<JSON_ROOT>", config->json_path);
+		topic_dir_base = DDL::Utils::String::Replace(topic_dir_base, "<CAT_ID>", std::to_string(category->category_id));
 	}
 
-	if (!category)
+	if (!DDL::Discourse::Storage::IsArchiveEnabled())
 	{
-		DDL::Logger::LogEvent("tried to download category topics, but category was nullptr - skipping category", DDLLogLevel::Error);
-		return DDLResult::Error_NullPointer;
+		DDL::Utils::IO::ValidatePath(topic_dir_base);
 	}
 
-	if (!category->json_file)
+	if (post_chunk_size <= 0)
 	{
-		DDL::Logger::LogEvent("tried to download category topics, but category json document was nullptr - skipping category", DDLLogLevel::Error);
-		return DDLResult::Error_NullPointer;
+		post_chunk_size = std::max(1, config->max_posts_per_request);
 	}
 
-	if (!topic_url_list)
+	parse_buffer.resize(TOPIC_PARSE_BUFFER_SIZE);
+	parse_allocator = new rapidjson::MemoryPoolAllocator<>(parse_buffer.data(), parse_buffer.size());
+	post_writer = new rapidjson::Writer<rapidjson::StringBuffer>(post_buffer);
+}
+
+DDLTopicDownloader::~DDLTopicDownloader()
+{
+	delete post_writer;
+	delete parse_allocator;
+}
+
+void DDLTopicDownloader::QueueTopic(int topic_id, std::string topic_url, std::function<void(int, bool)> on_topic_finished)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (config->download_skip_existing_topics && !refresh_existing_topics)
 	{
-		DDL::Logger::LogEvent("tried to download category topics, but topic_url_list was nullptr - skipping category", DDLLogLevel::Error);
-		return DDLResult::Error_NullPointer;
+		if (DDL::Discourse::Storage::TopicExists(category->category_id, topic_id))
+		{
+			DDL::Logger::LogEvent("skipping topic " + std::to_string(topic_id)
+				+ " as it appears to already exist (note: some posts could be missing in this case)");
+
+			if (on_topic_finished)
+			{
+				on_topic_finished(topic_id, true);
+			}
+
+			return;
+		}
 	}
 
-	current_resume_info->download_step = DDLResumeInfo::DownloadStep::TOPICS;
-	current_resume_info->category_id = category->category_id;
+	pending_topic_count++;
 
-	std::string topic_dir_base = JSON_CATEGORY_ROOT_FORMAT + "topics/";
+	std::chrono::steady_clock::time_point queued_time = std::chrono::steady_clock::now();
+
+	request_queue->AddRequest(topic_url, [this, topic_id, on_topic_finished, queued_time](DDLNetworkRequest* request)
 	{
-		topic_dir_base = DDL::Utils::String::Replace(topic_dir_base, "<JSON_ROOT>", config->json_path);
-		topic_dir_base = DDL::Utils::String::Replace(topic_dir_base, "<CAT_ID>", std::to_string(category->category_id));
-	}
+		WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-	DDL::Utils::IO::ValidatePath(topic_dir_base);
+		if (request->http_code != 200)
+		{
+			DDL::Logger::LogEvent("got http " + std::to_string(request->http_code) + " while trying to download topic from url '"
+				+ request->url + "', this topic will NOT be downloaded!", DDLLogLevel::Error);
+			incomplete_download = true;
 
-	current_resume_info->topic_first_id = topic_url_list->begin()->first;
-	current_resume_info->topic_last_id = topic_url_list->end()->first;
+			finish_topic(topic_id, nullptr, false, on_topic_finished, queued_time);
+			return;
+		}
 
-	int requests_until_next_notify = config->topic_url_collection_notify_interval;
+		bool topic_saved = DDL::Discourse::Storage::SaveTopic(category->category_id, topic_id, &request->response);
 
-	std::map<int, std::string>::iterator it;
-	bool found_resume_starting_point = false;
-	int ti = -1;
+		if (!topic_saved)
+		{
+			incomplete_download = true;
+		}
 
-	for (it = topic_url_list->begin(); it != topic_url_list->end(); it++)
-	{
-		ti++;
+		rapidjson::Document topic_json = rapidjson::Document(parse_allocator, TOPIC_PARSE_STACK_CAPACITY, &parse_stack_allocator);
+		parse_response(&topic_json, &request->response);
+
+		DDLTopicDownloadState* state = new DDLTopicDownloadState();
+		state->topic = new DiscourseTopic();
+		state->category_id = category->category_id;
+		state->on_topic_finished = on_topic_finished;
+		state->queued_time = queued_time;
+		state->complete = topic_saved;
+
+		state->reported_post_count = topic_json["posts_count"].GetInt();
+
+		std::string topic_directory = topic_dir_base + std::to_string(topic_id) + "/";
+
+		state->topic->topic_id = topic_id;
+		state->topic->request_url = request->url;
+		state->topic->posts_count = state->reported_post_count;
+
+		// The topic response already includes the first few posts, so only the rest need to be requested
+		save_post_list(&topic_json["post_stream"]["posts"], state);
 
-		if (DDL::Discourse::Downloader::GetLastResumeInfo() != nullptr)
+		std::unordered_set<int> included_post_ids = std::unordered_set<int>(state->topic->posts.begin(), state->topic->posts.end());
+		topic_post_chunk remaining_post_ids = topic_post_chunk();
+
+		for (rapidjson::Value& post_id_json : topic_json["post_stream"]["stream"].GetArray())
 		{
-			DDLResumeInfo* last_resume_info = DDL::Discourse::Downloader::GetLastResumeInfo();
+			int post_id = post_id_json.GetInt();
+
+			if (included_post_ids.contains(post_id))
+			{
+				continue;
+			}
 
-			if (last_resume_info->download_step == DDLResumeInfo::DownloadStep::TOPICS)
+			if (config->download_skip_existing_posts)
 			{
-				if (!found_resume_starting_point)
+				if (DDL::Discourse::Storage::PostExists(category->category_id, topic_id, post_id))
 				{
-					if (category->category_id == last_resume_info->category_id)
-					{
-						if (topic_url_list->begin()->first != last_resume_info->topic_first_id ||
-							topic_url_list->end()->first != last_resume_info->topic_last_id)
-						{
-							found_resume_starting_point = true;
-							DDL::Logger::LogEvent("cannot resume topic download, first/last topic ids in status do not match actual url list", DDLLogLevel::Warning);
-						}
-
-						if (ti == last_resume_info->topic_download_index)
-						{
-							found_resume_starting_point = true;
-
-							if (last_resume_info->last_saved_topic == it->first)
-							{
-								DDL::Logger::LogEvent("resuming topic download in category " + std::to_string(category->category_id)
-									+ " at topic " + std::to_string(it->first));
-							}
-							else
-							{
-								DDL::Logger::LogEvent("cannot resume topic download, topic at last saved index does not match real topic id", DDLLogLevel::Warning);
-							}
-						}
-						else
-						{
-							continue;
-						}
-					}
-					else
+					if (DDL::Logger::IsLogLevelEnabled(DDLLogLevel::Info))
 					{
-						found_resume_starting_point = true;
+						DDL::Logger::LogEvent("skipping post " + std::to_string(post_id) + " as it appears to already exist");
 					}
+
+					continue;
 				}
 			}
-			else
-			{
-				found_resume_starting_point = true;
-			}
+
+			remaining_post_ids.push_back(post_id);
 		}
 
-		std::string topic_url = it->second;
+		release_parse_memory();
 
-		int http_code = -1;
-		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(topic_url, &http_code);
+		if (remaining_post_ids.size() == 0)
+		{
+			// Runs the post count check and finishes the topic, as if its last chunk had just finished
+			state->remaining_chunks = 1;
+			finish_post_chunk(state);
+			return;
+		}
 
-		if (http_code == 200)
+		state->chunk_local_base = topic_directory + "chunks/post_chunk_";
+		state->chunk_url_base = TOPIC_POSTS_URL_FORMAT;
 		{
-			DiscourseTopic* topic = new DiscourseTopic();
+			state->chunk_url_base = DDL::Utils::String::Replace(state->chunk_url_base, "<BASE_URL>", config->website_url);
+			state->chunk_url_base = DDL::Utils::String::Replace(state->chunk_url_base, "<TOPIC_ID>", std::to_string(topic_id));
+		}
 
-			rapidjson::Document* topic_json = new rapidjson::Document();
-			topic_json->Parse(response.c_str());
+		// Raw post chunks are only kept around when using the files backend, as they would defeat the point of the archive
+		state->save_post_chunks = !DDL::Discourse::Storage::IsArchiveEnabled();
 
-			int topic_id = (*topic_json)["id"].GetInt();
-			int reported_post_count = (*topic_json)["posts_count"].GetInt();
+		if (state->save_post_chunks)
+		{
+			DDL::Utils::IO::ValidatePath(topic_directory + "chunks/");
+		}
 
-			std::string topic_directory = topic_dir_base + std::to_string(topic_id) + "/";
-			std::string post_directory = topic_directory + "posts/";
+		queue_post_chunks(state, &remaining_post_ids, -1);
+	});
+}
 
-			if (config->download_skip_existing_topics)
+void DDLTopicDownloader::queue_post_chunks(DDLTopicDownloadState* state, topic_post_chunk* post_ids, int previous_returned_count)
+{
+	for (size_t chunk_start = 0; chunk_start < post_ids->size(); chunk_start += post_chunk_size)
+	{
+		size_t chunk_end = std::min(chunk_start + post_chunk_size, post_ids->size());
+		queue_post_chunk(state, topic_post_chunk(post_ids->begin() + chunk_start, post_ids->begin() + chunk_end), previous_returned_count);
+	}
+}
+
+void DDLTopicDownloader::queue_post_chunk(DDLTopicDownloadState* state, topic_post_chunk post_ids, int previous_returned_count)
+{
+	std::string chunk_url = state->chunk_url_base;
+	{
+		chunk_url.reserve(chunk_url.length() + post_ids.size() * 20);
+
+		for (int i = 0; i < post_ids.size(); i++)
+		{
+			if (i > 0)
 			{
-				if (DDL::Utils::IO::IsDirectory(topic_directory)
-					&& DDL::Utils::IO::FileExists(topic_directory + "topic.json")
-					&& DDL::Utils::IO::IsDirectory(topic_directory + "posts/"))
-				{
-					DDL::Logger::LogEvent("skipping topic " + std::to_string(topic->topic_id)
-						+ " as it appears to already exist (note: some posts could be missing in this case)");
-					continue;
-				}
+				chunk_url += "&";
 			}
 
-			DDL::Utils::IO::ValidatePath(post_directory);
+			chunk_url += "post_ids[]=" + std::to_string(post_ids[i]);
+		}
+	}
+
+	int chunk_index = state->next_chunk_index++;
+	std::string chunk_local_path = state->chunk_local_base + std::to_string(chunk_index) + ".json";
+
+	state->remaining_chunks++;
+
+	request_queue->AddRequest(chunk_url, [this, state, post_ids, previous_returned_count, chunk_index, chunk_local_path](DDLNetworkRequest* chunk_request)
+	{
+		if (chunk_request->http_code == 414 && post_ids.size() > 1)
+		{
+			post_chunk_size = std::max<int>(1, post_ids.size() / 2);
+
+			DDL::Logger::LogEvent("post chunk url was too long for the server, limiting post chunks to " + std::to_string(post_chunk_size)
+				+ " posts", DDLLogLevel::Warning);
+
+			topic_post_chunk retry_post_ids = post_ids;
+			queue_post_chunks(state, &retry_post_ids, previous_returned_count);
+
+			finish_post_chunk(state);
+			return;
+		}
+
+		if (chunk_request->http_code != 200)
+		{
+			DDL::Logger::LogEvent("got http " + std::to_string(chunk_request->http_code) + " while trying to download post chunk #"
+				+ std::to_string(chunk_index) + ", these posts will NOT be downloaded!", DDLLogLevel::Error);
+			incomplete_download = true;
+			state->complete = false;
 
-			DDL::Utils::IO::CreateNewFile(topic_directory + "topic.json", response);
+			finish_post_chunk(state);
+			return;
+		}
 
-			rapidjson::GenericArray topic_post_ids = (*topic_json)["post_stream"]["stream"].GetArray();
+		if (state->save_post_chunks)
+		{
+			DDL::Utils::IO::CreateNewFile(chunk_local_path, chunk_request->response);
+		}
+
+		size_t saved_post_count = state->topic->posts.size();
+		{
+			rapidjson::Document chunk_document = rapidjson::Document(parse_allocator, TOPIC_PARSE_STACK_CAPACITY, &parse_stack_allocator);
+			parse_response(&chunk_document, &chunk_request->response);
 
-			if (topic_post_ids.Size() > 20)
+			save_post_list(&chunk_document["post_stream"]["posts"], state);
+		}
+
+		release_parse_memory();
+
+		int returned_count = state->topic->posts.size() - saved_post_count;
+
+		// Posts came back when asked for again, so the earlier response was cut short by the server rather than missing deleted posts
+		if (previous_returned_count > 0 && returned_count > 0 && previous_returned_count < post_chunk_size)
+		{
+			post_chunk_size = previous_returned_count;
+
+			DDL::Logger::LogEvent("server returns at most " + std::to_string(post_chunk_size) + " posts per request, limiting post chunks to match");
+		}
+
+		if (returned_count < post_ids.size())
+		{
+			// Once a request for the missing posts comes back empty, they are most likely deleted or hidden
+			if (previous_returned_count >= 0 && returned_count == 0)
 			{
-				std::string post_chunk_local_base = topic_directory + "chunks/post_chunk_";
-				std::string post_chunk_url_base = TOPIC_POSTS_URL_FORMAT;
+				if (DDL::Logger::IsLogLevelEnabled(DDLLogLevel::Info))
 				{
-					post_chunk_url_base = DDL::Utils::String::Replace(post_chunk_url_base, "<BASE_URL>", config->website_url);
-					post_chunk_url_base = DDL::Utils::String::Replace(post_chunk_url_base, "<TOPIC_ID>", std::to_string(topic_id));
+					DDL::Logger::LogEvent(std::to_string(post_ids.size()) + " posts in topic " + std::to_string(state->topic->topic_id)
+						+ " were not returned by the server, they may have been deleted");
 				}
+			}
+			else
+			{
+				std::unordered_set<int> returned_post_ids = std::unordered_set<int>(state->topic->posts.begin() + saved_post_count, state->topic->posts.end());
+				topic_post_chunk missing_post_ids = topic_post_chunk();
 
-				DDL::Utils::IO::ValidatePath(topic_directory + "chunks/");
-
-				std::vector<topic_post_chunk> post_chunks = std::vector<topic_post_chunk>();
+				for (int post_id : post_ids)
 				{
-					std::vector<int> post_ids = std::vector<int>();
-
-					for (int i = 0; i < topic_post_ids.Size(); i++)
+					if (!returned_post_ids.contains(post_id))
 					{
-						if (config->download_skip_existing_posts)
-						{
-							if (DDL::Utils::IO::IsDirectory(post_directory)
-								&& DDL::Utils::IO::FileExists(post_directory + std::to_string(topic_post_ids[i].GetInt()) + ".json"))
-							{
-								DDL::Logger::LogEvent("skipping post " + std::to_string(topic_post_ids[i].GetInt())
-									+ " as it appears to already exist");
-								continue;
-							}
-						}
-
-						post_ids.push_back(topic_post_ids[i].GetInt());
+						missing_post_ids.push_back(post_id);
 					}
+				}
 
-					while (post_ids.size() > 20)
-					{
-						topic_post_chunk chunk = topic_post_chunk();
+				queue_post_chunks(state, &missing_post_ids, returned_count);
+			}
+		}
 
-						for (int i = (post_ids.size() - 1); i != 0; i--)
-						{
-							chunk.push_back(post_ids[i]);
-							post_ids.erase(post_ids.begin() + i);
+		finish_post_chunk(state);
+	});
+}
 
-							if (chunk.size() == 20)
-							{
-								break;
-							}
-						}
+void DDLTopicDownloader::finish_post_chunk(DDLTopicDownloadState* state)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-						post_chunks.push_back(chunk);
-					}
+	state->remaining_chunks--;
 
-					post_chunks.push_back(post_ids);
-				}
+	if (state->remaining_chunks > 0)
+	{
+		return;
+	}
 
-				int collected_post_count = 0;
+	bool post_count_mismatch = false;
 
-				int chunk_index = -1;
-				for (topic_post_chunk chunk : post_chunks)
-				{
-					chunk_index++;
-					std::string chunk_request_suffix = "";
+	if (config->strict_topic_count_checks)
+	{
+		if (state->collected_post_count != state->reported_post_count)
+		{
+			post_count_mismatch = true;
+		}
+	}
+	else
+	{
+		if (state->collected_post_count < state->reported_post_count)
+		{
+			post_count_mismatch = true;
+		}
+	}
 
-					for (int i = 0; i < chunk.size(); i++)
-					{
-						chunk_request_suffix += "post_ids[]=" + std::to_string(chunk[i]);
+	if (post_count_mismatch)
+	{
+		DDL::Logger::LogEvent("collected post count does not match topic reported post count, some posts may be missed!", DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- collected            : " + std::to_string(state->collected_post_count), DDLLogLevel::Warning);
+		DDL::Logger::LogEvent("- reported posts_count : " + std::to_string(state->reported_post_count), DDLLogLevel::Warning);
+	}
 
-						if (i != (chunk.size() - 1))
-						{
-							chunk_request_suffix += "&";
-						}
-					}
+	finish_topic(state->topic->topic_id, state->topic, state->complete, state->on_topic_finished, state->queued_time);
+	delete state;
+}
 
-					int chunk_http_code = -1;
-					std::string chunk_response = DDL::Utils::Network::PerformHTTPRequestWithRetries(post_chunk_url_base + chunk_request_suffix, &chunk_http_code);
+void DDLTopicDownloader::parse_response(rapidjson::Document* document, std::string* response)
+{
+	DDLTraceSpan parse_span = DDLTraceSpan("parse topic", "json");
+	parse_span.AddArg("bytes", (int64_t)response->length());
 
-					if (chunk_http_code == 200)
-					{
-						DDL::Utils::IO::CreateNewFile(post_chunk_local_base + std::to_string(chunk_index) + ".json", chunk_response);
+	document->ParseInsitu(response->data());
+}
 
-						rapidjson::Document chunk_document = rapidjson::Document();
-						chunk_document.Parse(chunk_response.c_str());
+void DDLTopicDownloader::release_parse_memory()
+{
+	parse_allocator->Clear();
+}
 
-						rapidjson::GenericArray posts_json = chunk_document["post_stream"]["posts"].GetArray();
+void DDLTopicDownloader::save_post_list(rapidjson::Value* posts_json, DDLTopicDownloadState* state)
+{
+	for (rapidjson::Value& post : posts_json->GetArray())
+	{
+		int post_id = post["id"].GetInt();
 
-						for (int i = 0; i < posts_json.Size(); i++)
-						{
-							rapidjson::Value post = posts_json[i].GetObj();
-							int post_id = post["id"].GetInt();
+		post_buffer.Clear();
+		post_writer->Reset(post_buffer);
+		post.Accept(*post_writer);
 
-							std::string post_json_string = DDL::Utils::Json::Serialize(&post);
+		if (!DDL::Discourse::Storage::SavePost(state->category_id, state->topic->topic_id, post_id, post_buffer.GetString(), post_buffer.GetSize()))
+		{
+			incomplete_download = true;
+			state->complete = false;
+		}
 
-							DDL::Utils::IO::CreateNewFile(post_directory + std::to_string(post_id) + ".json", post_json_string);
+		state->topic->posts.push_back(post_id);
+		state->collected_post_count++;
+	}
+}
 
-							rapidjson::Document* post_json_file = new rapidjson::Document();
-							post_json_file->Parse(post_json_string.c_str());
+int DDLTopicDownloader::GetPendingTopicCount()
+{
+	return pending_topic_count;
+}
 
-							topic->posts.push_back(post_id);
+bool DDLTopicDownloader::IsDownloadIncomplete()
+{
+	return incomplete_download;
+}
 
-							delete post_json_file;
-							collected_post_count++;
-						}
-					}
-					else
-					{
-						DDL::Logger::LogEvent("got http " + std::to_string(chunk_http_code) + " while trying to download post chunk #"
-							+ std::to_string(chunk_index) + ", these posts will NOT be downloaded!", DDLLogLevel::Error);
-						incomplete_download = true;
-					}
-				}
+void DDLTopicDownloader::SetRefreshExistingTopics(bool refresh)
+{
+	refresh_existing_topics = refresh;
+}
 
-				bool post_count_mismatch = false;
+void DDLTopicDownloader::finish_topic(int topic_id, DiscourseTopic* topic, bool complete, std::function<void(int, bool)> on_topic_finished,
+	std::chrono::steady_clock::time_point queued_time)
+{
+	pending_topic_count--;
 
-				if (config->strict_topic_count_checks)
-				{
-					if (collected_post_count != reported_post_count)
-					{
-						post_count_mismatch = true;
-					}
-				}
-				else
-				{
-					if (collected_post_count < reported_post_count)
-					{
-						post_count_mismatch = true;
-					}
-				}
+	// Topics are interleaved on the request queue's thread, so each is traced from being queued to its last post being saved
+	if (DDL::Trace::IsTracing())
+	{
+		DDL::Trace::RecordAsyncSpan("topic " + std::to_string(topic_id), "topic", queued_time, {
+			{ "category_id", std::to_string(category->category_id) },
+			{ "posts", std::to_string(topic ? topic->posts.size() : 0) },
+			{ "complete", complete ? "true" : "false" }
+		});
+	}
 
-				if (post_count_mismatch)
-				{
-					DDL::Logger::LogEvent("collected post count does not match topic reported post count, some posts may be missed!", DDLLogLevel::Warning);
-					DDL::Logger::LogEvent("- collected            : " + std::to_string(collected_post_count), DDLLogLevel::Warning);
-					DDL::Logger::LogEvent("- reported posts_count : " + std::to_string(reported_post_count), DDLLogLevel::Warning);
-				}
-			}
-			else
-			{
-				rapidjson::GenericArray posts_json = (*topic_json)["post_stream"]["posts"].GetArray();
+	if (topic)
+	{
+		category->topics.push_back(topic);
+	}
 
-				for (int i = 0; i < posts_json.Size(); i++)
-				{
-					rapidjson::Value post = posts_json[i].GetObj();
-					int post_id = post["id"].GetInt();
+	if (on_topic_finished)
+	{
+		on_topic_finished(topic_id, complete);
+	}
+}
 
-					std::string post_json_string = DDL::Utils::Json::Serialize(&post);
+DDLResult DDL::Discourse::Downloader::DownloadTopics(DiscourseCategory* category, std::map<int, std::string>* topic_url_list)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-					DDL::Utils::IO::CreateNewFile(post_directory + std::to_string(post_id) + ".json", post_json_string);
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - skipping category topics", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
 
-					rapidjson::Document* post_json_file = new rapidjson::Document();
-					post_json_file->Parse(post_json_string.c_str());
+	if (!category)
+	{
+		DDL::Logger::LogEvent("tried to download category topics, but category was nullptr - skipping category", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
 
-					topic->posts.push_back(post_id);
+	if (!category->json_file)
+	{
+		DDL::Logger::LogEvent("tried to download category topics, but category json document was nullptr - skipping category", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
 
-					delete post_json_file;
-				}
-			}
+	if (!topic_url_list)
+	{
+		DDL::Logger::LogEvent("tried to download category topics, but topic_url_list was nullptr - skipping category", DDLLogLevel::Error);
+		return DDLResult::Error_NullPointer;
+	}
+
+	if (topic_url_list->size() == 0)
+	{
+		return DDLResult::Success_OK;
+	}
 
-			topic->topic_id = topic_id;
-			topic->request_url = topic_url;
-			topic->posts_count = (*topic_json)["posts_count"].GetInt();
+	int saved_topic_count = 0;
+	int requests_until_next_notify = config->topic_url_collection_notify_interval;
 
-			category->topics.push_back(topic);
-			delete topic_json;
+	DDLRequestQueue request_queue = DDLRequestQueue(DDL::Utils::Network::GetMaxConcurrentRequests());
+	DDLTopicDownloader topic_downloader = DDLTopicDownloader(category, &request_queue);
 
-			current_resume_info->topic_download_index = ti;
-			current_resume_info->last_saved_topic = topic_id;
-			DDL::Discourse::Downloader::SaveResumeFile();
-		}
-		else
+	std::function<void(int, bool)> on_topic_finished = [&](int topic_id, bool complete)
+	{
+		// Failed topics are left out of the journal, so that a resumed download tries them again
+		if (complete)
 		{
-			DDL::Logger::LogEvent("got http " + std::to_string(http_code) + " while trying to download topic from url '"
-				+ topic_url + "', this topic will NOT be downloaded!", DDLLogLevel::Error);
-			incomplete_download = true;
+			DDL::Discourse::Downloader::RecordFinishedTopic(category->category_id, topic_id);
 		}
 
+		saved_topic_count++;
 		requests_until_next_notify--;
 
 		if (requests_until_next_notify <= 0)
 		{
-			if (found_resume_starting_point)
-			{
-				requests_until_next_notify = config->topic_url_collection_notify_interval;
-				DDL::Logger::LogEvent("saved " + std::to_string(ti) + "/" + std::to_string(topic_url_list->size()) + " topics so far...");
-			}
+			requests_until_next_notify = config->topic_url_collection_notify_interval;
+			DDL::Logger::LogEvent("saved " + std::to_string(saved_topic_count) + "/" + std::to_string(topic_url_list->size()) + " topics so far...");
 		}
+	};
+
+	std::map<int, std::string>::iterator it;
+
+	for (it = topic_url_list->begin(); it != topic_url_list->end(); it++)
+	{
+		if (DDL::Discourse::Downloader::WasTopicFinished(category->category_id, it->first))
+		{
+			saved_topic_count++;
+			continue;
+		}
+
+		topic_downloader.QueueTopic(it->first, it->second, on_topic_finished);
+	}
+
+	if (saved_topic_count > 0)
+	{
+		DDL::Logger::LogEvent("resuming topic download in category " + std::to_string(category->category_id) + ", skipping "
+			+ std::to_string(saved_topic_count) + " topics which were already finished");
 	}
 
-	if (incomplete_download)
+	request_queue.Run();
+
+	DDL::Discourse::Downloader::FlushResumeJournal();
+
+	if (topic_downloader.IsDownloadIncomplete())
 	{
 		DDL::Logger::LogEvent("some topics were not downloaded, you should probably retry these topics later", DDLLogLevel::Warning);
 		return DDLResult::Error_IncompleteDownload;
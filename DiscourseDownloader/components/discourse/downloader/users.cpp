@@ -1,6 +1,11 @@
 #include "components/discourse/discourse.h"
+#include "components/discourse/storage/storage.h"
+
+#include <map>
 
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
+#include "components/diagnostics/trace/trace.h"
 #include "components/settings/settings.h"
 #include "components/utils/io/io.h"
 #include "components/utils/string/string.h"
@@ -8,6 +13,9 @@
 #include "components/utils/network/network.h"
 #include "components/utils/list/list.h"
 
+#define USER_ACTIONS_PAGE_SIZE 30 //!< The number of actions returned by each user_actions.json request.
+#define USER_PROGRESS_INTERVAL 50 //!< Number of users between each progress message.
+
 std::vector<int> incomplete_users = std::vector<int>();
 
 bool download_pms()
@@ -15,81 +23,102 @@ bool download_pms()
 	return false;
 }
 
-bool download_user_actions(std::string user_root, std::string username, int user_id)
+DDLUserDownloader::DDLUserDownloader(DDLRequestQueue* _request_queue)
+{
+	request_queue = _request_queue;
+}
+
+void DDLUserDownloader::QueueUser(rapidjson::Value* directory_item, std::function<void(int, bool)> on_user_finished)
 {
-	bool complete_download = true;
 	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-	if (!config)
+	DDLUserDownloadState* state = new DDLUserDownloadState();
+	state->user_id = (*directory_item)["user"]["id"].GetInt();
+	state->username = (*directory_item)["user"]["username"].GetString();
+	state->directory_item = DDL::Utils::Json::Serialize(directory_item);
+	state->on_user_finished = on_user_finished;
+
+	state->user_root = JSON_USER_ROOT_FORMAT;
 	{
-		DDL::Logger::LogEvent("could not get website config - user actions will NOT be downloaded!", DDLLogLevel::Error);
-		return false;
+		state->user_root = DDL::Utils::String::Replace(state->user_root, "<JSON_ROOT>", config->json_path);
+		state->user_root = DDL::Utils::String::Replace(state->user_root, "<USER_ID>", std::to_string(state->user_id));
 	}
 
-	std::string actions_url = USER_ACTIONS_INFO_URL_FORMAT;
+	DDL::Utils::IO::ValidatePath(state->user_root);
+	DDL::Utils::IO::ValidatePath(state->user_root + "actions/");
+
+	pending_user_count++;
+
+	// None of these can finish until control returns to the request queue, so the state can't be released part way through
+	queue_user_info(state);
+	queue_avatars(state, (*directory_item)["user"]["avatar_template"].GetString());
+	queue_badges(state);
+	queue_actions_page(state, 0);
+
+	// Private messages
 	{
-		actions_url = DDL::Utils::String::Replace(actions_url, "<BASE_URL>", config->website_url);
-		actions_url = DDL::Utils::String::Replace(actions_url, "<USERNAME>", username);
+		// @todo
 	}
+}
 
-	std::string actions_data_root = user_root + "actions/";
-	DDL::Utils::IO::ValidatePath(actions_data_root);
-
-	bool continue_download = true;
-	int offset = 0;
-	int page_number = 0;
+void DDLUserDownloader::queue_user_info(DDLUserDownloadState* state)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
 
-	while (continue_download)
+	std::string user_info_url = USER_INFO_URL_FORMAT;
 	{
-		std::string url = actions_url + std::to_string(offset);
+		user_info_url = DDL::Utils::String::Replace(user_info_url, "<BASE_URL>", config->website_url);
+		user_info_url = DDL::Utils::String::Replace(user_info_url, "<USERNAME>", state->username);
+	}
 
-		int http_code = -1;
-		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(url, &http_code);
+	state->remaining_requests++;
 
-		if (http_code == 200)
+	request_queue->AddRequest(user_info_url, [this, state](DDLNetworkRequest* request)
+	{
+		if (request->http_code != 200)
 		{
-			rapidjson::Document document = rapidjson::Document();
-			document.Parse(response.c_str());
+			DDL::Logger::LogEvent("could not download full user info for user '" + std::to_string(state->user_id)
+				+ "', will retry download later (directory entry will be saved)", DDLLogLevel::Warning);
 
-			DDL::Utils::IO::CreateNewFile(actions_data_root + "page_" + std::to_string(page_number) + ".json", response);
-		}
-		else
-		{
-			DDL::Logger::LogEvent("failed to download user actions page " + std::to_string(page_number) + " (offset "
-				+ std::to_string(offset) + ") for user " + std::to_string(user_id) + ", page will be skipped!", DDLLogLevel::Error);
-			complete_download = false;
+			DDL::Utils::IO::CreateNewFile(state->user_root + "user_d.json", state->directory_item);
+
+			finish_request(state, false);
+			return;
 		}
 
-		if (!config->download_all_user_actions)
+		rapidjson::Document user_info_document = rapidjson::Document();
 		{
-			continue_download = false;
+			DDLTraceSpan parse_span = DDLTraceSpan("parse user", "json");
+			user_info_document.ParseInsitu(request->response.data());
 		}
-		else
+
+		rapidjson::Document directory_item_document = rapidjson::Document(&user_info_document.GetAllocator());
+		directory_item_document.Parse(state->directory_item.c_str());
+
+		if (user_info_document.HasParseError() || !user_info_document.IsObject() || directory_item_document.HasParseError())
 		{
-			offset += 30;
+			DDL::Logger::LogEvent("could not parse user info for user '" + std::to_string(state->user_id) + "', will retry download later",
+				DDLLogLevel::Warning);
+
+			DDL::Utils::IO::CreateNewFile(state->user_root + "user_d.json", state->directory_item);
+
+			finish_request(state, false);
+			return;
 		}
 
-		page_number++;
-	}
+		rapidjson::Value key = rapidjson::Value("directory_item", user_info_document.GetAllocator());
+		user_info_document.AddMember(key, directory_item_document.Move(), user_info_document.GetAllocator());
+
+		DDL::Utils::IO::CreateNewFile(state->user_root + "user.json", DDL::Utils::Json::Serialize(&user_info_document));
 
-	return complete_download;
+		finish_request(state, true);
+	});
 }
 
-bool download_avatar(std::string user_local_root, std::string avatar_template, int user_id)
+void DDLUserDownloader::queue_avatars(DDLUserDownloadState* state, std::string avatar_template)
 {
-	bool download_all_sizes = true;
-	bool complete_download = true;
-
 	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
-
-	if (!config)
-	{
-		DDL::Logger::LogEvent("error while downloading user avatar: could not get website config, defaulting to download all sizes", DDLLogLevel::Warning);
-	}
-	else
-	{
-		download_all_sizes = config->download_all_avatar_sizes;
-	}
+	DDLBlobStore* blob_store = DDL::Discourse::Storage::GetBlobStore();
 
 	int sizes[] = {
 		30,
@@ -108,12 +137,11 @@ bool download_avatar(std::string user_local_root, std::string avatar_template, i
 
 	for (int size : sizes)
 	{
-		if (!download_all_sizes && size != 360)
+		if (!config->download_all_avatar_sizes && size != 360)
 		{
 			continue;
 		}
 
-		int http_code = -1;
 		std::string avatar_url = DDL::Utils::String::Replace(avatar_template, "{size}", std::to_string(size));
 
 		if (!avatar_url.starts_with("http://") && !avatar_url.starts_with("ftp://") && !avatar_url.starts_with("https://"))
@@ -121,22 +149,154 @@ bool download_avatar(std::string user_local_root, std::string avatar_template, i
 			avatar_url = config->website_url + avatar_url;
 		}
 
-		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(avatar_url, &http_code);
+		std::string extension = avatar_url.substr(avatar_url.find_last_of('.'));
+		std::string file_path = state->user_root + "avatar_" + std::to_string(size) + extension;
 
-		if (http_code == 200)
+		// Users with the same avatar (such as the default letter avatars) share a url, so it only needs downloading once
+		std::string blob_path = "";
+
+		if (blob_store->FindBlob(avatar_url, &blob_path))
 		{
-			std::string file_path = user_local_root + "avatar_" + std::to_string(size) + avatar_url.substr(avatar_url.find_last_of('.'));
-			DDL::Utils::IO::CreateNewFileBinaryMode(file_path, response);
+			if (!blob_store->LinkBlob(blob_path, file_path))
+			{
+				state->complete = false;
+			}
+
+			continue;
 		}
-		else
+
+		state->remaining_requests++;
+
+		if (pending_avatars.contains(avatar_url))
+		{
+			pending_avatars[avatar_url].push_back(std::pair<DDLUserDownloadState*, std::string>(state, file_path));
+			continue;
+		}
+
+		pending_avatars[avatar_url].push_back(std::pair<DDLUserDownloadState*, std::string>(state, file_path));
+
+		request_queue->AddDownload(avatar_url, blob_store->GetIncomingPath(), [this, avatar_url, extension, size](DDLNetworkRequest* request)
 		{
-			DDL::Logger::LogEvent("failed to download avatar for user '" + std::to_string(user_id) + "' at size '" + std::to_string(size)
-				+ "', this avatar size will NOT be saved (got http " + std::to_string(http_code) + ")", DDLLogLevel::Warning);
-			complete_download = false;
+			DDLBlobStore* blob_store = DDL::Discourse::Storage::GetBlobStore();
+			std::string blob_path = "";
+
+			bool avatar_result = request->http_code == 200 && blob_store->AddBlob(request->output_path, avatar_url, extension, &blob_path);
+
+			if (request->http_code != 200)
+			{
+				DDL::Logger::LogEvent("failed to download avatar '" + avatar_url + "' at size '" + std::to_string(size)
+					+ "', this avatar size will NOT be saved (got http " + std::to_string(request->http_code) + ")", DDLLogLevel::Warning);
+			}
+
+			std::vector<std::pair<DDLUserDownloadState*, std::string>> waiting_users = std::move(pending_avatars[avatar_url]);
+			pending_avatars.erase(avatar_url);
+
+			for (std::pair<DDLUserDownloadState*, std::string>& waiting_user : waiting_users)
+			{
+				finish_request(waiting_user.first, avatar_result && blob_store->LinkBlob(blob_path, waiting_user.second));
+			}
+		});
+	}
+}
+
+void DDLUserDownloader::queue_badges(DDLUserDownloadState* state)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	std::string badges_url = USER_BADGES_INFO_URL_FORMAT;
+	{
+		badges_url = DDL::Utils::String::Replace(badges_url, "<BASE_URL>", config->website_url);
+		badges_url = DDL::Utils::String::Replace(badges_url, "<USERNAME>", state->username);
+	}
+
+	state->remaining_requests++;
+
+	request_queue->AddRequest(badges_url, [this, state](DDLNetworkRequest* request)
+	{
+		if (request->http_code == 200)
+		{
+			DDL::Utils::IO::CreateNewFile(state->user_root + "badges.json", request->response);
 		}
+
+		// Badges are not always visible to guests, so a failure here doesn't make the user incomplete
+		finish_request(state, true);
+	});
+}
+
+void DDLUserDownloader::queue_actions_page(DDLUserDownloadState* state, int page_number)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	std::string actions_url = USER_ACTIONS_INFO_URL_FORMAT;
+	{
+		actions_url = DDL::Utils::String::Replace(actions_url, "<BASE_URL>", config->website_url);
+		actions_url = DDL::Utils::String::Replace(actions_url, "<USERNAME>", state->username);
 	}
 
-	return complete_download;
+	state->remaining_requests++;
+
+	request_queue->AddRequest(actions_url + std::to_string(page_number * USER_ACTIONS_PAGE_SIZE), [this, state, page_number](DDLNetworkRequest* request)
+	{
+		WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+		if (request->http_code != 200)
+		{
+			DDL::Logger::LogEvent("failed to download user actions page " + std::to_string(page_number) + " (offset "
+				+ std::to_string(page_number * USER_ACTIONS_PAGE_SIZE) + ") for user " + std::to_string(state->user_id)
+				+ ", page will be skipped!", DDLLogLevel::Error);
+
+			finish_request(state, false);
+			return;
+		}
+
+		DDL::Utils::IO::CreateNewFile(state->user_root + "actions/page_" + std::to_string(page_number) + ".json", request->response);
+
+		rapidjson::Document actions_document = rapidjson::Document();
+		{
+			DDLTraceSpan parse_span = DDLTraceSpan("parse user actions", "json");
+			actions_document.ParseInsitu(request->response.data());
+		}
+
+		bool has_more_actions = !actions_document.HasParseError() && actions_document.IsObject() && actions_document.HasMember("user_actions")
+			&& actions_document["user_actions"].IsArray() && actions_document["user_actions"].Size() > 0;
+
+		// Queued before finishing this page, so the user isn't finished while there are still pages to go
+		if (config->download_all_user_actions && has_more_actions)
+		{
+			queue_actions_page(state, page_number + 1);
+		}
+
+		finish_request(state, true);
+	});
+}
+
+void DDLUserDownloader::finish_request(DDLUserDownloadState* state, bool success)
+{
+	if (!success)
+	{
+		state->complete = false;
+	}
+
+	state->remaining_requests--;
+
+	if (state->remaining_requests > 0)
+	{
+		return;
+	}
+
+	pending_user_count--;
+
+	if (state->on_user_finished)
+	{
+		state->on_user_finished(state->user_id, state->complete);
+	}
+
+	delete state;
+}
+
+int DDLUserDownloader::GetPendingUserCount()
+{
+	return pending_user_count;
 }
 
 void download_user_list(bool only_download_incomplete)
@@ -155,8 +315,6 @@ void download_user_list(bool only_download_incomplete)
 			DDLLogLevel::Warning);
 	}
 
-	bool keep_searching = true;
-	int page_num = -1;
 	std::string user_list_url = DIRECTORY_LIST_URL_FORMAT;
 	{
 		user_list_url = DDL::Utils::String::Replace(user_list_url, "<BASE_URL>", config->website_url);
@@ -169,164 +327,178 @@ void download_user_list(bool only_download_incomplete)
 
 	DDL::Utils::IO::ValidatePath(directory_local_root);
 
-	int total_downloaded_users = 0;
+	DDLRequestQueue request_queue = DDLRequestQueue(DDL::Utils::Network::GetMaxConcurrentRequests());
+	DDLUserDownloader user_downloader = DDLUserDownloader(&request_queue);
 
-	while (keep_searching)
+	if (!only_download_incomplete)
 	{
-		page_num++;
-		int http_code = -1;
+		DDL::Discourse::Downloader::BeginResumeUsers();
+	}
+
+	bool keep_searching = true;
+	bool directory_page_deferred = false;
+	int next_page_num = only_download_incomplete ? 0 : DDL::Discourse::Downloader::GetResumeDirectoryPage();
+	int next_unfinished_page = next_page_num;
+	int total_user_count = 0;
+	int total_downloaded_users = 0;
 
-		std::string response = DDL::Utils::Network::PerformHTTPRequestWithRetries(user_list_url + std::to_string(page_num), &http_code);
+	// Pages finish in order, so that a resumed download never skips a page which still had users in flight
+	std::map<int, std::vector<int>> page_user_ids = std::map<int, std::vector<int>>();
+	std::map<int, int> page_remaining_users = std::map<int, int>();
 
-		if (http_code != 200)
+	std::function<void()> finish_directory_pages = [&]()
+	{
+		// Retrying incomplete users doesn't move the resume position, as it only covers some of each page's users
+		if (only_download_incomplete)
 		{
-			if (http_code == 403 && config->fail_on_403)
-			{
-				DDL::Logger::LogEvent("stopping user search because a user list request returned 403 and the user list api is "
-					"most likely blocked. if this is not the case, please edit website.cfg", DDLLogLevel::Error);
-				keep_searching = false;
-			}
-
-			continue;
+			return;
 		}
 
-		rapidjson::Document* directory_page = new rapidjson::Document();
-		directory_page->Parse(response.c_str());
-
-		DDL::Utils::IO::CreateNewFile(directory_local_root + "page_" + std::to_string(page_num) + ".json", response);
+		while (page_remaining_users.contains(next_unfinished_page) && page_remaining_users[next_unfinished_page] == 0)
+		{
+			DDL::Discourse::Downloader::RecordFinishedDirectoryPage(next_unfinished_page, &page_user_ids[next_unfinished_page]);
 
-		int total_user_count = (*directory_page)["meta"]["total_rows_directory_items"].GetInt();
+			page_user_ids.erase(next_unfinished_page);
+			page_remaining_users.erase(next_unfinished_page);
+			next_unfinished_page++;
+		}
+	};
 
-		rapidjson::GenericArray directory_items = (*directory_page)["directory_items"].GetArray();
+	std::function<void()> request_next_directory_page = nullptr;
 
-		if (directory_items.Size() == 0)
+	std::function<void(int, int, bool)> on_user_finished = [&](int page_num, int user_id, bool complete)
+	{
+		// Incomplete users are left out of the journal, so that they are downloaded again if the download is resumed before
+		// their page finishes
+		if (!only_download_incomplete && complete)
 		{
-			keep_searching = false;
-			break;
+			DDL::Discourse::Downloader::RecordFinishedUser(page_num, user_id);
 		}
 
-		for (int i = 0; i < directory_items.Size(); i++)
-		{
-			rapidjson::Value item = directory_items[i].GetObj();
+		page_remaining_users[page_num]--;
+		finish_directory_pages();
 
-			std::string username = item["user"]["username"].GetString();
-			std::string avatar_template = item["user"]["avatar_template"].GetString();
-			int user_id = item["user"]["id"].GetInt();
+		if (!complete)
+		{
+			DDL::Logger::LogEvent("one or more requests for user " + std::to_string(user_id) + " failed, will retry later", DDLLogLevel::Warning);
 
-			if (only_download_incomplete && !DDL::Utils::List::VectorContains(incomplete_users, user_id))
+			if (!DDL::Utils::List::VectorContains(incomplete_users, user_id))
 			{
-				continue;
+				incomplete_users.push_back(user_id);
 			}
+		}
 
-			DDL::Logger::LogEvent("downloading user " + std::to_string(user_id) + " (" + std::to_string(total_downloaded_users)
-				+ "/" + std::to_string(total_user_count) + ")...");
+		total_downloaded_users++;
+		DDL::Metrics::GetCounter("ddl_users_saved_total", "The number of users downloaded and saved.")->Increment();
 
-			std::string user_data_root = JSON_USER_ROOT_FORMAT;
-			{
-				user_data_root = DDL::Utils::String::Replace(user_data_root, "<JSON_ROOT>", config->json_path);
-				user_data_root = DDL::Utils::String::Replace(user_data_root, "<USER_ID>", std::to_string(user_id));
-			}
-
-			std::string user_info_url = USER_INFO_URL_FORMAT;
-			{
-				user_info_url = DDL::Utils::String::Replace(user_info_url, "<BASE_URL>", config->website_url);
-				user_info_url = DDL::Utils::String::Replace(user_info_url, "<USERNAME>", username);
-			}
+		if (total_downloaded_users % USER_PROGRESS_INTERVAL == 0)
+		{
+			DDL::Logger::LogEvent("downloaded " + std::to_string(total_downloaded_users) + "/" + std::to_string(total_user_count) + " users so far...");
+		}
 
-			DDL::Utils::IO::ValidatePath(user_data_root);
+		// Resume reading the directory once the download backlog has room again
+		if (directory_page_deferred && user_downloader.GetPendingUserCount() < config->max_pending_users)
+		{
+			directory_page_deferred = false;
+			request_next_directory_page();
+		}
+	};
 
-			int user_http_code = -1;
-			std::string user_response = DDL::Utils::Network::PerformHTTPRequestWithRetries(user_info_url, &user_http_code);
+	request_next_directory_page = [&]()
+	{
+		int page_num = next_page_num;
+		next_page_num++;
 
-			if (user_http_code == 200)
+		request_queue.AddRequest(user_list_url + std::to_string(page_num), [&, page_num](DDLNetworkRequest* request)
+		{
+			if (request->http_code == 200)
 			{
-				rapidjson::Document user_info_document = rapidjson::Document();
-				user_info_document.Parse(user_response.c_str());
+				DDL::Utils::IO::CreateNewFile(directory_local_root + "page_" + std::to_string(page_num) + ".json", request->response);
 
-				rapidjson::Value key = rapidjson::Value("directory_item", user_info_document.GetAllocator());
-				rapidjson::Value value = rapidjson::Value(item, user_info_document.GetAllocator());
-
-				user_info_document.AddMember(key, value, user_info_document.GetAllocator());
-
-				std::string json_string = DDL::Utils::Json::Serialize(&user_info_document);
+				rapidjson::Document directory_page = rapidjson::Document();
+				{
+					DDLTraceSpan parse_span = DDLTraceSpan("parse user directory", "json");
+					directory_page.ParseInsitu(request->response.data());
+				}
 
-				DDL::Utils::IO::CreateNewFile(user_data_root + "user.json", json_string);
-			}
-			else if (!only_download_incomplete)
-			{
-				DDL::Logger::LogEvent("could not download full user info for user '" + std::to_string(user_id)
-					+ "', will retry download later (directory entry will be saved)", DDLLogLevel::Warning);
+				total_user_count = directory_page["meta"]["total_rows_directory_items"].GetInt();
 
-				std::string json_string = DDL::Utils::Json::Serialize(&item);
-				DDL::Utils::IO::CreateNewFile(user_data_root + "user_d.json", json_string);
+				rapidjson::GenericArray directory_items = directory_page["directory_items"].GetArray();
 
-				if (!DDL::Utils::List::VectorContains(incomplete_users, user_id))
+				if (directory_items.Size() == 0)
 				{
-					incomplete_users.push_back(user_id);
+					keep_searching = false;
 				}
-			}
 
-			// Download avatar
-			{
-				bool avatar_result = download_avatar(user_data_root, avatar_template, user_id);
+				page_user_ids[page_num] = std::vector<int>();
+				page_remaining_users[page_num] = 0;
 
-				if (!avatar_result)
+				for (rapidjson::Value& item : directory_items)
 				{
-					DDL::Logger::LogEvent("one or more avatar sizes failed to download, will retry later", DDLLogLevel::Warning);
+					int user_id = item["user"]["id"].GetInt();
 
-					if (!DDL::Utils::List::VectorContains(incomplete_users, user_id))
+					if (only_download_incomplete && !DDL::Utils::List::VectorContains(incomplete_users, user_id))
 					{
-						incomplete_users.push_back(user_id);
+						continue;
 					}
-				}
-			}
 
-			// Download user badges
-			{
-				std::string badges_url = USER_BADGES_INFO_URL_FORMAT;
-				{
-					badges_url = DDL::Utils::String::Replace(badges_url, "<BASE_URL>", config->website_url);
-					badges_url = DDL::Utils::String::Replace(badges_url, "<USERNAME>", username);
-				}
+					page_user_ids[page_num].push_back(user_id);
 
-				int badges_http_code = -1;
-				std::string badges_response = DDL::Utils::Network::PerformHTTPRequestWithRetries(badges_url, &badges_http_code);
+					if (!only_download_incomplete && DDL::Discourse::Downloader::WasUserFinished(user_id))
+					{
+						total_downloaded_users++;
+						continue;
+					}
 
-				if (badges_http_code == 200)
-				{
-					rapidjson::Document badges_document = rapidjson::Document();
-					badges_document.Parse(badges_response.c_str());
+					page_remaining_users[page_num]++;
 
-					DDL::Utils::IO::CreateNewFile(user_data_root + "badges.json", badges_response);
-				}
-				else
-				{
-					// badges download failed
+					user_downloader.QueueUser(&item, [&, page_num](int finished_user_id, bool complete)
+					{
+						on_user_finished(page_num, finished_user_id, complete);
+					});
 				}
-			}
 
-			// Download user actions
-			if (!download_user_actions(user_data_root, username, user_id))
+				finish_directory_pages();
+			}
+			else if (request->http_code == 403 && config->fail_on_403)
 			{
-				DDL::Logger::LogEvent("one or more actions pages failed to download, will retry later", DDLLogLevel::Warning);
+				DDL::Logger::LogEvent("stopping user search because a user list request returned 403 and the user list api is "
+					"most likely blocked. if this is not the case, please edit website.cfg", DDLLogLevel::Error);
+				keep_searching = false;
+			}
+			else
+			{
+				DDL::Logger::LogEvent("got http " + std::to_string(request->http_code) + " while downloading user list page "
+					+ std::to_string(page_num) + ", users on this page will be missed!", DDLLogLevel::Error);
+			}
 
-				if (!DDL::Utils::List::VectorContains(incomplete_users, user_id))
-				{
-					incomplete_users.push_back(user_id);
-				}
+			if (!keep_searching)
+			{
+				return;
 			}
 
-			// Download private messages
+			if (user_downloader.GetPendingUserCount() >= config->max_pending_users)
 			{
-				// @todo
+				directory_page_deferred = true;
+				return;
 			}
 
-			total_downloaded_users++;
-		}
+			request_next_directory_page();
+		});
+	};
 
-		//DDL::Logger::LogEvent("downloading users... (" + std::to_string(total_downloaded_users) + "/"
-		//	+ std::to_string(total_user_count) + ")");
+	if (next_page_num > 0)
+	{
+		DDL::Logger::LogEvent("skipping directory pages 0 to " + std::to_string(next_page_num - 1) + " as their users seem to already be downloaded");
 	}
+
+	request_next_directory_page();
+	request_queue.Run();
+
+	DDL::Discourse::Downloader::FlushResumeJournal();
+
+	DDL::Logger::LogEvent("downloaded " + std::to_string(total_downloaded_users) + " users, " + std::to_string(incomplete_users.size())
+		+ " of which are incomplete");
 }
 
 void DDL::Discourse::Downloader::DownloadUsers()
@@ -343,6 +515,9 @@ void DDL::Discourse::Downloader::DownloadUsers()
 	{
 		DDL::Logger::LogEvent("user profile downloading has been disabled in config - if this is not what you want, please edit website.cfg",
 			DDLLogLevel::Warning);
+
+		// Users are the last step that can be resumed, so there is nothing left to resume once categories have finished
+		DDL::Discourse::Downloader::FinishResumeDownload();
 		return;
 	}
 
@@ -350,5 +525,8 @@ void DDL::Discourse::Downloader::DownloadUsers()
 
 	download_user_list(false);
 
+	DDL::Discourse::Downloader::FinishResumeDownload();
+
+	DDL::Discourse::Storage::GetBlobStore()->LogStatistics();
 	DDL::Logger::LogEvent("finished downloading user data");
-}
\ No newline at end of file
+}
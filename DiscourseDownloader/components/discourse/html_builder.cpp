@@ -1,8 +1,177 @@
 #include "discourse.h"
 
+#include <atomic>
+#include <chrono>
+
 #include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/threading/threading.h"
+#include "components/discourse/builder/builder.h"
+#include "components/discourse/storage/storage.h"
+
+#define HTML_BUILD_PROGRESS_INTERVAL 5000 //!< Number of pages between each progress message.
+
+/**
+* Calculates the number of pages rendered per second since the build started.
+*/
+double get_pages_per_second(int page_count, std::chrono::steady_clock::time_point start_time)
+{
+	double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	if (elapsed_seconds <= 0.0)
+	{
+		return 0.0;
+	}
+
+	return page_count / elapsed_seconds;
+}
 
 void DDL::Discourse::BuildArchiveWebsite()
 {
-	DDL::Logger::LogEvent("html builder is not yet implemented");
-}
\ No newline at end of file
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - html archive will NOT be built!", DDLLogLevel::Error);
+		return;
+	}
+
+	DDLBuildContext context = DDLBuildContext();
+
+	if (!DDL::Discourse::Builder::LoadBuildContext(&context))
+	{
+		return;
+	}
+
+	std::vector<DDLCategoryBuildState*> categories = DDL::Discourse::Builder::LoadCategories();
+
+	if (categories.size() == 0)
+	{
+		DDL::Logger::LogEvent("no downloaded categories were found in '" + config->json_path + "', html archive will NOT be built!", DDLLogLevel::Error);
+		return;
+	}
+
+	// Deleting the manifest forces every page to be rebuilt
+	DDLBuildManifest manifest = DDLBuildManifest();
+	std::string manifest_path = config->site_directory_root + HTML_BUILD_MANIFEST_FILENAME;
+	int previous_page_count = manifest.Load(manifest_path);
+
+	context.manifest = &manifest;
+
+	DDLWorkStealingPool pool = DDLWorkStealingPool(config->html_build_threads);
+
+	if (previous_page_count > 0)
+	{
+		DDL::Logger::LogEvent("updating html archive for " + std::to_string(categories.size()) + " categories using "
+			+ std::to_string(pool.GetThreadCount()) + " threads, " + std::to_string(previous_page_count) + " pages were built previously...");
+	}
+	else
+	{
+		DDL::Logger::LogEvent("building html archive for " + std::to_string(categories.size()) + " categories using "
+			+ std::to_string(pool.GetThreadCount()) + " threads...");
+	}
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	std::atomic<int> checked_pages = 0;
+	std::atomic<int> rendered_pages = 0;
+	std::atomic<int> unchanged_pages = 0;
+	std::atomic<int> failed_pages = 0;
+
+	std::function<void(DDLPageResult)> on_page_finished = [&](DDLPageResult result)
+	{
+		if (result == DDLPageResult::Page_Failed)
+		{
+			failed_pages++;
+			return;
+		}
+
+		if (result == DDLPageResult::Page_Unchanged)
+		{
+			unchanged_pages++;
+		}
+		else
+		{
+			rendered_pages++;
+		}
+
+		int page_count = ++checked_pages;
+
+		if (page_count % HTML_BUILD_PROGRESS_INTERVAL == 0)
+		{
+			DDL::Logger::LogEvent("checked " + std::to_string(page_count) + " pages so far, " + std::to_string(unchanged_pages) + " unchanged ("
+				+ std::to_string((int)get_pages_per_second(page_count, start_time)) + " pages/sec)...");
+		}
+	};
+
+	// Each category lists its own topics and queues them from a worker, so idle workers start stealing topics right away
+	for (DDLCategoryBuildState* category : categories)
+	{
+		pool.Submit([&, category]()
+		{
+			std::vector<int> topic_ids = DDL::Discourse::Storage::ListTopics(category->category_id);
+
+			for (int topic_id : topic_ids)
+			{
+				pool.Submit([&, category, topic_id]()
+				{
+					DDLTopicSummary summary = DDLTopicSummary();
+					DDLPageResult result = DDL::Discourse::Builder::RenderTopicPage(&context, category->category_id, topic_id, &summary);
+
+					if (result != DDLPageResult::Page_Failed)
+					{
+						std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(category->topics_mutex);
+						category->topics.push_back(summary);
+					}
+
+					on_page_finished(result);
+				});
+			}
+		});
+	}
+
+	pool.Wait();
+
+	for (DDLCategoryBuildState* category : categories)
+	{
+		pool.Submit([&, category]()
+		{
+			DDLPageResult result = DDL::Discourse::Builder::RenderCategoryPage(&context, category);
+
+			if (result == DDLPageResult::Page_Failed)
+			{
+				DDL::Logger::LogEvent("failed to write page for category " + std::to_string(category->category_id), DDLLogLevel::Error);
+			}
+
+			on_page_finished(result);
+		});
+	}
+
+	pool.Wait();
+
+	DDLPageResult index_result = DDL::Discourse::Builder::RenderIndexPage(&context, &categories);
+
+	if (index_result == DDLPageResult::Page_Failed)
+	{
+		DDL::Logger::LogEvent("failed to write index page", DDLLogLevel::Error);
+	}
+
+	on_page_finished(index_result);
+
+	double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	DDL::Logger::LogEvent("html archive build finished, rendered " + std::to_string(rendered_pages) + " pages and skipped "
+		+ std::to_string(unchanged_pages) + " unchanged pages in " + std::to_string((int)elapsed_seconds) + "s ("
+		+ std::to_string((int)get_pages_per_second(checked_pages, start_time)) + " pages/sec)");
+
+	manifest.Save(manifest_path);
+
+	if (failed_pages > 0)
+	{
+		DDL::Logger::LogEvent(std::to_string(failed_pages) + " pages could not be built, see above for details", DDLLogLevel::Warning);
+	}
+
+	for (DDLCategoryBuildState* category : categories)
+	{
+		delete category;
+	}
+}
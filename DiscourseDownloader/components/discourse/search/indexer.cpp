@@ -0,0 +1,273 @@
+#include "search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <unordered_map>
+
+#include "components/3rdparty/rapidjson/document.h"
+
+#include "components/discourse/builder/builder.h"
+#include "components/discourse/storage/storage.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+
+/**
+* Appends a string to an index file, prefixed with its length.
+*/
+void append_index_string(std::string* output, std::string_view string)
+{
+	DDL::Discourse::Search::AppendVarint(output, string.length());
+	output->append(string);
+}
+
+/**
+* Starts a new index file with the magic number and version.
+*/
+void begin_index_file(std::string* output)
+{
+	uint32_t header[2] = { SEARCH_INDEX_MAGIC, SEARCH_INDEX_VERSION };
+	output->append((const char*)header, sizeof(header));
+}
+
+/**
+* Retrieves a string member from a JSON object, or an empty view if it is missing or not a string.
+*/
+std::string_view get_index_json_view(rapidjson::Value& object, const char* name)
+{
+	if (!object.HasMember(name) || !object[name].IsString())
+	{
+		return std::string_view();
+	}
+
+	return std::string_view(object[name].GetString(), object[name].GetStringLength());
+}
+
+bool DDL::Discourse::Search::BuildSearchIndex()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		DDL::Logger::LogEvent("could not get website config - search index will NOT be built!", DDLLogLevel::Error);
+		return false;
+	}
+
+	std::vector<DDLCategoryBuildState*> categories = DDL::Discourse::Builder::LoadCategories();
+
+	if (categories.size() == 0)
+	{
+		DDL::Logger::LogEvent("no downloaded categories were found in '" + config->json_path + "', search index will NOT be built!", DDLLogLevel::Error);
+		return false;
+	}
+
+	DDL::Logger::LogEvent("building search index for " + std::to_string(categories.size()) + " categories...");
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+	std::string topic_table = "";
+	std::string document_table = "";
+	uint32_t topic_count = 0;
+	uint32_t document_count = 0;
+	uint64_t total_length = 0;
+
+	std::unordered_map<std::string, DDLSearchTermPostings> postings = std::unordered_map<std::string, DDLSearchTermPostings>();
+	std::unordered_map<std::string, uint32_t> term_frequencies = std::unordered_map<std::string, uint32_t>();
+	std::vector<std::string> terms = std::vector<std::string>();
+
+	std::string topic_data = "";
+	std::string post_data = "";
+
+	for (DDLCategoryBuildState* category : categories)
+	{
+		std::vector<int> topic_ids = DDL::Discourse::Storage::ListTopics(category->category_id);
+		std::sort(topic_ids.begin(), topic_ids.end());
+
+		for (int topic_id : topic_ids)
+		{
+			if (!DDL::Discourse::Storage::LoadTopic(category->category_id, topic_id, &topic_data))
+			{
+				continue;
+			}
+
+			rapidjson::Document topic_json = rapidjson::Document();
+			topic_json.ParseInsitu(topic_data.data());
+
+			if (topic_json.HasParseError() || !topic_json.IsObject() || !topic_json.HasMember("post_stream")
+				|| !topic_json["post_stream"].HasMember("stream") || !topic_json["post_stream"]["stream"].IsArray())
+			{
+				DDL::Logger::LogEvent("could not parse topic " + std::to_string(topic_id) + ", it will not be searchable", DDLLogLevel::Warning);
+				continue;
+			}
+
+			std::string_view title = get_index_json_view(topic_json, "title");
+			std::string_view slug = get_index_json_view(topic_json, "slug");
+
+			// Matches the slug used for the topic's page by the html builder
+			if (slug.length() == 0 || slug.find_first_of("/\\.") != std::string_view::npos)
+			{
+				slug = "topic";
+			}
+
+			DDL::Discourse::Search::AppendVarint(&topic_table, topic_id);
+			DDL::Discourse::Search::AppendVarint(&topic_table, category->category_id);
+			append_index_string(&topic_table, title);
+			append_index_string(&topic_table, slug);
+
+			for (rapidjson::Value& post_id_json : topic_json["post_stream"]["stream"].GetArray())
+			{
+				if (!post_id_json.IsInt() || !DDL::Discourse::Storage::LoadPost(category->category_id, topic_id, post_id_json.GetInt(), &post_data))
+				{
+					continue;
+				}
+
+				rapidjson::Document post_json = rapidjson::Document();
+				post_json.ParseInsitu(post_data.data());
+
+				if (post_json.HasParseError() || !post_json.IsObject() || !post_json.HasMember("post_number") || !post_json["post_number"].IsInt())
+				{
+					continue;
+				}
+
+				int post_number = post_json["post_number"].GetInt();
+				std::string_view raw = get_index_json_view(post_json, "raw");
+
+				terms.clear();
+
+				// The raw markdown is closer to what the author wrote, but is only present for some endpoints
+				if (raw.length() > 0)
+				{
+					DDL::Discourse::Search::Tokenize(raw, false, &terms);
+				}
+				else
+				{
+					DDL::Discourse::Search::Tokenize(get_index_json_view(post_json, "cooked"), true, &terms);
+				}
+
+				// The title belongs to the first post, so that a search for it finds the topic itself
+				if (post_number == 1)
+				{
+					DDL::Discourse::Search::Tokenize(title, false, &terms);
+				}
+
+				term_frequencies.clear();
+
+				for (std::string& term : terms)
+				{
+					term_frequencies[term]++;
+				}
+
+				for (std::pair<const std::string, uint32_t>& term_frequency : term_frequencies)
+				{
+					DDLSearchTermPostings& term_postings = postings[term_frequency.first];
+
+					DDL::Discourse::Search::AppendVarint(&term_postings.postings, document_count - term_postings.last_document);
+					DDL::Discourse::Search::AppendVarint(&term_postings.postings, term_frequency.second);
+
+					term_postings.last_document = document_count;
+					term_postings.document_count++;
+				}
+
+				DDL::Discourse::Search::AppendVarint(&document_table, topic_count);
+				DDL::Discourse::Search::AppendVarint(&document_table, post_id_json.GetInt());
+				DDL::Discourse::Search::AppendVarint(&document_table, post_number);
+				DDL::Discourse::Search::AppendVarint(&document_table, terms.size());
+
+				total_length += terms.size();
+				document_count++;
+			}
+
+			topic_count++;
+
+			if (topic_count % SEARCH_PROGRESS_INTERVAL == 0)
+			{
+				DDL::Logger::LogEvent("indexed " + std::to_string(topic_count) + " topics (" + std::to_string(document_count) + " posts, "
+					+ std::to_string(postings.size()) + " unique terms) so far...");
+			}
+		}
+	}
+
+	for (DDLCategoryBuildState* category : categories)
+	{
+		delete category;
+	}
+
+	std::string index_root = DDL::Utils::String::Replace(SEARCH_INDEX_DIRECTORY_FORMAT, "<HTML_ROOT>", config->html_path);
+	DDL::Utils::IO::ValidatePath(index_root);
+
+	// Remove every shard from the previous build, as terms which no longer appear anywhere would otherwise leave stale shards behind
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(index_root, error))
+	{
+		std::string filename = entry.path().filename().string();
+
+		if (entry.is_regular_file() && filename.rfind("terms_", 0) == 0)
+		{
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+
+	std::string documents_file = "";
+	{
+		begin_index_file(&documents_file);
+		DDL::Discourse::Search::AppendVarint(&documents_file, topic_count);
+		documents_file += topic_table;
+		DDL::Discourse::Search::AppendVarint(&documents_file, document_count);
+		DDL::Discourse::Search::AppendVarint(&documents_file, total_length);
+		documents_file += document_table;
+	}
+
+	if (!DDL::Utils::IO::CreateNewFileBinaryMode(index_root + SEARCH_DOCUMENTS_FILENAME, documents_file))
+	{
+		DDL::Logger::LogEvent("failed to write '" + index_root + SEARCH_DOCUMENTS_FILENAME + "', search index will NOT be usable", DDLLogLevel::Error);
+		return false;
+	}
+
+	// Group the terms by shard, sorted so that each shard lists its terms in order
+	std::map<std::string, std::vector<std::string>> shards = std::map<std::string, std::vector<std::string>>();
+
+	for (std::pair<const std::string, DDLSearchTermPostings>& term_postings : postings)
+	{
+		shards[DDL::Discourse::Search::GetShardName(term_postings.first)].push_back(term_postings.first);
+	}
+
+	bool write_result = true;
+
+	for (std::pair<const std::string, std::vector<std::string>>& shard : shards)
+	{
+		std::sort(shard.second.begin(), shard.second.end());
+
+		std::string shard_file = "";
+		begin_index_file(&shard_file);
+		DDL::Discourse::Search::AppendVarint(&shard_file, shard.second.size());
+
+		for (std::string& term : shard.second)
+		{
+			DDLSearchTermPostings& term_postings = postings[term];
+
+			append_index_string(&shard_file, term);
+			DDL::Discourse::Search::AppendVarint(&shard_file, term_postings.document_count);
+			append_index_string(&shard_file, term_postings.postings);
+		}
+
+		std::string shard_path = index_root + DDL::Utils::String::Replace(SEARCH_SHARD_FILENAME_FORMAT, "<PREFIX>", shard.first);
+
+		if (!DDL::Utils::IO::CreateNewFileBinaryMode(shard_path, shard_file))
+		{
+			DDL::Logger::LogEvent("failed to write search shard '" + shard_path + "'", DDLLogLevel::Error);
+			write_result = false;
+		}
+	}
+
+	double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	DDL::Logger::LogEvent("search index build finished, indexed " + std::to_string(document_count) + " posts from " + std::to_string(topic_count)
+		+ " topics (" + std::to_string(postings.size()) + " unique terms in " + std::to_string(shards.size()) + " shards) in "
+		+ std::to_string((int)elapsed_seconds) + "s");
+
+	return write_result;
+}
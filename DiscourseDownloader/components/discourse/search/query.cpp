@@ -0,0 +1,299 @@
+#include "search.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+#include "components/discourse/builder/builder.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+
+/**
+* Checks that an index file starts with the expected magic number and version.
+*
+* @returns The offset of the data following the header, or 0 if the header is invalid.
+*/
+size_t read_index_header(std::string_view data)
+{
+	uint32_t header[2] = { 0, 0 };
+
+	if (data.length() < sizeof(header))
+	{
+		return 0;
+	}
+
+	memcpy(header, data.data(), sizeof(header));
+
+	if (header[0] != SEARCH_INDEX_MAGIC || header[1] != SEARCH_INDEX_VERSION)
+	{
+		return 0;
+	}
+
+	return sizeof(header);
+}
+
+/**
+* Reads a length-prefixed string from an index file.
+*/
+bool read_index_string(std::string_view data, size_t* offset, std::string_view* string)
+{
+	uint64_t length = 0;
+
+	if (!DDL::Discourse::Search::ReadVarint(data, offset, &length) || length > data.length() - *offset)
+	{
+		return false;
+	}
+
+	*string = data.substr(*offset, length);
+	*offset += length;
+
+	return true;
+}
+
+/**
+* Reads the number of records that follow in an index file. Every record takes at least one byte, so a count larger than
+* the rest of the file can only come from a damaged file, and is rejected before anything is allocated for it.
+*/
+bool read_index_count(std::string_view data, size_t* offset, uint64_t* count)
+{
+	return DDL::Discourse::Search::ReadVarint(data, offset, count) && *count <= data.length() - *offset;
+}
+
+/**
+* Loads the topic and post tables from the documents file.
+*/
+bool load_documents(std::string path, std::vector<DDLSearchTopic>* topics, std::vector<DDLSearchDocument>* documents, uint64_t* total_length)
+{
+	std::string data = "";
+
+	if (!DDL::Utils::IO::ReadBinaryFile(path, &data))
+	{
+		return false;
+	}
+
+	size_t offset = read_index_header(data);
+	uint64_t count = 0;
+
+	if (offset == 0 || !read_index_count(data, &offset, &count))
+	{
+		return false;
+	}
+
+	topics->resize(count);
+
+	for (DDLSearchTopic& topic : *topics)
+	{
+		uint64_t topic_id = 0;
+		uint64_t category_id = 0;
+		std::string_view title = std::string_view();
+		std::string_view slug = std::string_view();
+
+		if (!DDL::Discourse::Search::ReadVarint(data, &offset, &topic_id) || !DDL::Discourse::Search::ReadVarint(data, &offset, &category_id)
+			|| !read_index_string(data, &offset, &title) || !read_index_string(data, &offset, &slug))
+		{
+			return false;
+		}
+
+		topic.topic_id = topic_id;
+		topic.category_id = category_id;
+		topic.title = title;
+		topic.slug = slug;
+	}
+
+	if (!read_index_count(data, &offset, &count) || !DDL::Discourse::Search::ReadVarint(data, &offset, total_length))
+	{
+		return false;
+	}
+
+	documents->resize(count);
+
+	for (DDLSearchDocument& document : *documents)
+	{
+		uint64_t fields[4] = { 0, 0, 0, 0 };
+
+		for (uint64_t& field : fields)
+		{
+			if (!DDL::Discourse::Search::ReadVarint(data, &offset, &field))
+			{
+				return false;
+			}
+		}
+
+		if (fields[0] >= topics->size())
+		{
+			return false;
+		}
+
+		document.topic_index = fields[0];
+		document.post_id = fields[1];
+		document.post_number = fields[2];
+		document.length = fields[3];
+	}
+
+	return true;
+}
+
+/**
+* Finds a term within a shard.
+*
+* @returns `true` if the shard contains the term, otherwise returns `false`.
+*/
+bool find_term_postings(std::string_view shard, std::string_view term, uint64_t* document_count, std::string_view* postings)
+{
+	size_t offset = read_index_header(shard);
+	uint64_t term_count = 0;
+
+	if (offset == 0 || !read_index_count(shard, &offset, &term_count))
+	{
+		return false;
+	}
+
+	for (uint64_t i = 0; i < term_count; i++)
+	{
+		std::string_view shard_term = std::string_view();
+
+		if (!read_index_string(shard, &offset, &shard_term) || !DDL::Discourse::Search::ReadVarint(shard, &offset, document_count)
+			|| !read_index_string(shard, &offset, postings))
+		{
+			return false;
+		}
+
+		// Terms are sorted, so there is no point looking any further once past where the term would be
+		if (shard_term == term)
+		{
+			return true;
+		}
+		else if (shard_term > term)
+		{
+			return false;
+		}
+	}
+
+	return false;
+}
+
+bool DDL::Discourse::Search::Search(std::string query, int result_count, std::vector<DDLSearchResult>* results)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+	std::string index_root = DDL::Utils::String::Replace(SEARCH_INDEX_DIRECTORY_FORMAT, "<HTML_ROOT>", config->html_path);
+
+	std::vector<DDLSearchTopic> topics = std::vector<DDLSearchTopic>();
+	std::vector<DDLSearchDocument> documents = std::vector<DDLSearchDocument>();
+	uint64_t total_length = 0;
+
+	if (!load_documents(index_root + SEARCH_DOCUMENTS_FILENAME, &topics, &documents, &total_length))
+	{
+		DDL::Logger::LogEvent("could not read search index from '" + index_root + "', has it been built?", DDLLogLevel::Error);
+		return false;
+	}
+
+	results->clear();
+
+	if (documents.size() == 0)
+	{
+		return true;
+	}
+
+	std::vector<std::string> terms = std::vector<std::string>();
+	Tokenize(query, false, &terms);
+
+	double average_length = std::max(1.0, (double)total_length / documents.size());
+	std::vector<double> scores = std::vector<double>(documents.size(), 0.0);
+	std::unordered_set<std::string> searched_terms = std::unordered_set<std::string>();
+	std::string shard = "";
+
+	for (std::string& term : terms)
+	{
+		if (!searched_terms.insert(term).second)
+		{
+			continue;
+		}
+
+		std::string shard_path = index_root + DDL::Utils::String::Replace(SEARCH_SHARD_FILENAME_FORMAT, "<PREFIX>", GetShardName(term));
+		uint64_t document_count = 0;
+		std::string_view postings = std::string_view();
+
+		if (!DDL::Utils::IO::IsFile(shard_path) || !DDL::Utils::IO::ReadBinaryFile(shard_path, &shard)
+			|| !find_term_postings(shard, term, &document_count, &postings))
+		{
+			continue;
+		}
+
+		double idf = std::log(1.0 + (documents.size() - document_count + 0.5) / (document_count + 0.5));
+		size_t offset = 0;
+		uint64_t document_index = 0;
+
+		while (offset < postings.length())
+		{
+			uint64_t delta = 0;
+			uint64_t frequency = 0;
+
+			if (!ReadVarint(postings, &offset, &delta) || !ReadVarint(postings, &offset, &frequency))
+			{
+				DDL::Logger::LogEvent("search shard '" + shard_path + "' is damaged, results may be incomplete", DDLLogLevel::Warning);
+				break;
+			}
+
+			document_index += delta;
+
+			if (document_index >= documents.size())
+			{
+				break;
+			}
+
+			double length_ratio = documents[document_index].length / average_length;
+			double term_weight = (frequency * (SEARCH_BM25_K1 + 1.0))
+				/ (frequency + SEARCH_BM25_K1 * (1.0 - SEARCH_BM25_B + SEARCH_BM25_B * length_ratio));
+
+			scores[document_index] += idf * term_weight;
+		}
+	}
+
+	std::vector<uint32_t> matches = std::vector<uint32_t>();
+
+	for (uint32_t i = 0; i < scores.size(); i++)
+	{
+		if (scores[i] > 0.0)
+		{
+			matches.push_back(i);
+		}
+	}
+
+	size_t kept_matches = std::min(matches.size(), (size_t)std::max(result_count, 0));
+
+	std::partial_sort(matches.begin(), matches.begin() + kept_matches, matches.end(), [&scores](uint32_t a, uint32_t b)
+	{
+		return (scores[a] != scores[b]) ? scores[a] > scores[b] : a < b;
+	});
+
+	for (size_t i = 0; i < kept_matches; i++)
+	{
+		DDLSearchDocument& document = documents[matches[i]];
+		DDLSearchTopic& topic = topics[document.topic_index];
+
+		DDLSearchResult result = DDLSearchResult();
+		result.score = scores[matches[i]];
+		result.topic_id = topic.topic_id;
+		result.category_id = topic.category_id;
+		result.post_id = document.post_id;
+		result.post_number = document.post_number;
+		result.title = topic.title;
+		result.slug = topic.slug;
+
+		results->push_back(result);
+	}
+
+	return true;
+}
+
+std::string DDL::Discourse::Search::GetResultPagePath(DDLSearchResult* result)
+{
+	DDLTopicSummary topic = DDLTopicSummary();
+	topic.topic_id = result->topic_id;
+	topic.slug = result->slug;
+
+	return DDL::Discourse::Builder::GetTopicPagePath(".", &topic).substr(2) + "#post_" + std::to_string(result->post_number);
+}
@@ -0,0 +1,117 @@
+#include "search.h"
+
+/**
+* Checks whether a byte can be part of a search term.
+*/
+bool is_term_character(unsigned char character)
+{
+	return (character >= 'a' && character <= 'z') || (character >= 'A' && character <= 'Z') || (character >= '0' && character <= '9')
+		|| character >= 0x80;
+}
+
+void DDL::Discourse::Search::Tokenize(std::string_view text, bool is_html, std::vector<std::string>* terms)
+{
+	std::string term = "";
+	size_t position = 0;
+
+	while (position <= text.length())
+	{
+		unsigned char character = (position < text.length()) ? text[position] : ' ';
+
+		if (is_term_character(character))
+		{
+			if (character >= 'A' && character <= 'Z')
+			{
+				character += 'a' - 'A';
+			}
+
+			term += (char)character;
+			position++;
+
+			continue;
+		}
+
+		if (term.length() >= SEARCH_MIN_TERM_LENGTH && term.length() <= SEARCH_MAX_TERM_LENGTH)
+		{
+			terms->push_back(term);
+		}
+
+		term.clear();
+
+		// Tags and entities end the current term, and their contents are not searchable
+		if (is_html && character == '<')
+		{
+			size_t tag_end = text.find('>', position);
+			position = (tag_end == std::string_view::npos) ? text.length() : tag_end;
+		}
+		else if (is_html && character == '&')
+		{
+			size_t entity_end = text.find_first_of("; <", position + 1);
+
+			if (entity_end != std::string_view::npos && text[entity_end] == ';')
+			{
+				position = entity_end;
+			}
+		}
+
+		position++;
+	}
+}
+
+std::string DDL::Discourse::Search::GetShardName(std::string_view term)
+{
+	std::string shard_name = "";
+	char hex[4] = { 0 };
+
+	// Letters and digits are kept as-is for readability, anything else is written as hex so it is safe in a filename
+	for (size_t i = 0; i < term.length() && i < SEARCH_MIN_TERM_LENGTH; i++)
+	{
+		unsigned char character = term[i];
+
+		if ((character >= 'a' && character <= 'z') || (character >= '0' && character <= '9'))
+		{
+			shard_name += (char)character;
+		}
+		else
+		{
+			sprintf_s(hex, sizeof(hex), "_%02x", character);
+			shard_name += hex;
+		}
+	}
+
+	return shard_name;
+}
+
+void DDL::Discourse::Search::AppendVarint(std::string* output, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		output->push_back((char)((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	output->push_back((char)value);
+}
+
+bool DDL::Discourse::Search::ReadVarint(std::string_view data, size_t* offset, uint64_t* value)
+{
+	*value = 0;
+
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (*offset >= data.length())
+		{
+			return false;
+		}
+
+		uint8_t byte = data[(*offset)++];
+		*value |= (uint64_t)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
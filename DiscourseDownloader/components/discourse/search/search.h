@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+
+#define SEARCH_INDEX_DIRECTORY_FORMAT std::string("<HTML_ROOT>/search/")
+#define SEARCH_DOCUMENTS_FILENAME std::string("documents.ddls")
+#define SEARCH_SHARD_FILENAME_FORMAT std::string("terms_<PREFIX>.ddls")
+#define SEARCH_INDEX_MAGIC 0x534C4444 //!< Magic number at the start of every search index file ("DDLS").
+#define SEARCH_INDEX_VERSION 1
+
+#define SEARCH_MIN_TERM_LENGTH 2  //!< Shorter tokens are not indexed. Also the number of bytes used to pick a term's shard.
+#define SEARCH_MAX_TERM_LENGTH 64 //!< Longer tokens (usually urls or base64 blobs) are not indexed.
+#define SEARCH_BM25_K1 1.2 //!< Controls how quickly repeated occurrences of a term stop adding to a post's score.
+#define SEARCH_BM25_B 0.75 //!< Controls how much longer posts are penalized.
+#define SEARCH_DEFAULT_RESULT_COUNT 10
+#define SEARCH_PROGRESS_INTERVAL 1000 //!< Number of topics between each progress message while building the index.
+
+/**
+* Structure representing a topic in the search index.
+*/
+struct DDLSearchTopic
+{
+	int topic_id = -1;
+	int category_id = -1;
+	std::string title = ""; //!< The topic title, unescaped.
+	std::string slug = "";  //!< The topic slug, used to link to the topic page.
+};
+
+/**
+* Structure representing a single post in the search index. Posts are numbered by their position in the documents file.
+*/
+struct DDLSearchDocument
+{
+	int topic_index = -1; //!< The index of the post's topic within the documents file.
+	int post_id = -1;
+	int post_number = -1;
+	int length = 0; //!< The number of tokens in the post, used to normalize its score.
+};
+
+/**
+* Structure representing the postings list of a single term while the index is being built.
+*/
+struct DDLSearchTermPostings
+{
+	std::string postings = "";   //!< The encoded postings list.
+	uint32_t document_count = 0; //!< The number of posts containing the term.
+	uint32_t last_document = 0;  //!< The last post added to the list, which the next entry is encoded relative to.
+};
+
+/**
+* Structure representing a single search result.
+*/
+struct DDLSearchResult
+{
+	double score = 0.0;
+	int topic_id = -1;
+	int category_id = -1;
+	int post_id = -1;
+	int post_number = -1;
+	std::string title = ""; //!< The topic title, unescaped.
+	std::string slug = "";  //!< The topic slug.
+};
+
+/**
+* Namespace containing functions for building and querying the offline full-text search index.
+*
+* The index is written to the `search` directory of the HTML archive, so that it can be served alongside the site and
+* read by a script on the client. Every integer is written as an unsigned LEB128 varint, other than the magic number and
+* version at the start of each file, which are little-endian 32-bit integers. Strings are written as their length
+* followed by their bytes.
+*
+* `documents.ddls` lists every topic and post:
+* - magic, version, topic count, then for each topic: topic ID, category ID, title, slug
+* - post count, total token count, then for each post: topic index, post ID, post number, token count
+*
+* The terms are split into shards by their first #SEARCH_MIN_TERM_LENGTH bytes, so that a query only has to fetch the
+* shards for the terms it contains. Each `terms_<PREFIX>.ddls` file contains:
+* - magic, version, term count, then for each term (in byte order): term, post count, postings length in bytes, postings
+*
+* A postings list is a sequence of (post index delta, term frequency) pairs in increasing post order, with each post
+* index stored as the difference from the previous one (the first is stored as-is).
+*/
+namespace DDL::Discourse::Search
+{
+	/**
+	* Splits text into search terms. Terms are runs of ASCII letters and digits, and any non-ASCII characters, with ASCII
+	* letters converted to lowercase. Terms outside of #SEARCH_MIN_TERM_LENGTH and #SEARCH_MAX_TERM_LENGTH are skipped.
+	*
+	* @param text - The text to split.
+	* @param is_html - Whether or not the text is HTML, in which case tags and entities are skipped.
+	* @param terms - Pointer to a list, which every term found will be appended to.
+	*/
+	void Tokenize(std::string_view text, bool is_html, std::vector<std::string>* terms);
+
+	/**
+	* Retrieves the name of the shard that a term is stored in.
+	*
+	* @param term - The term.
+	*
+	* @returns The shard name, as used in the shard filename.
+	*/
+	std::string GetShardName(std::string_view term);
+
+	/**
+	* Appends an unsigned LEB128 varint to a buffer.
+	*
+	* @param output - The buffer to append to.
+	* @param value - The value to append.
+	*/
+	void AppendVarint(std::string* output, uint64_t value);
+
+	/**
+	* Reads an unsigned LEB128 varint from a buffer.
+	*
+	* @param data - The buffer to read from.
+	* @param offset - Pointer to the offset to read from, which is moved past the varint.
+	* @param value - Pointer to write the value to.
+	*
+	* @returns `true` if a complete varint was read, otherwise returns `false`.
+	*/
+	bool ReadVarint(std::string_view data, size_t* offset, uint64_t* value);
+
+	/**
+	* Builds the search index from every downloaded topic and post, replacing any existing index.
+	*
+	* @returns `true` if the index was built, otherwise returns `false`.
+	*/
+	bool BuildSearchIndex();
+
+	/**
+	* Searches the index, ranking posts using BM25.
+	*
+	* @param query - The text to search for.
+	* @param result_count - The maximum number of results to return.
+	* @param results - Pointer to a list, which the results will be written to with the best match first.
+	*
+	* @returns `true` if the index could be read, otherwise returns `false`.
+	*/
+	bool Search(std::string query, int result_count, std::vector<DDLSearchResult>* results);
+
+	/**
+	* Builds the path of the page a search result is shown on, relative to the HTML root.
+	*
+	* @param result - The search result.
+	*
+	* @returns The path to the topic page, including an anchor to the post.
+	*/
+	std::string GetResultPagePath(DDLSearchResult* result);
+}
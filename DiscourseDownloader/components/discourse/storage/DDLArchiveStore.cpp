@@ -0,0 +1,379 @@
+#include "storage.h"
+
+#include <filesystem>
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/trace/trace.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+
+DDLArchiveStore::DDLArchiveStore(std::string _archive_root, uint64_t _max_segment_size)
+{
+	archive_root = _archive_root;
+	max_segment_size = _max_segment_size;
+
+	DDL::Utils::IO::ValidatePath(archive_root);
+
+	load_index();
+	open_active_segment();
+	open_index();
+
+	DDL::Logger::LogEvent("opened archive store with " + std::to_string(topic_index.size()) + " topics and "
+		+ std::to_string(post_index.size()) + " posts across " + std::to_string(active_segment + 1) + " segments");
+}
+
+DDLArchiveStore::~DDLArchiveStore()
+{
+	segment_stream.close();
+	index_stream.close();
+}
+
+bool DDLArchiveStore::WriteTopic(int category_id, int topic_id, std::string* data)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	return append_record(DDLArchiveRecordType::Topic, category_id, topic_id, topic_id, data->c_str(), data->length());
+}
+
+bool DDLArchiveStore::WritePost(int category_id, int topic_id, int post_id, const char* data, size_t length)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	return append_record(DDLArchiveRecordType::Post, category_id, topic_id, post_id, data, length);
+}
+
+bool DDLArchiveStore::ReadTopic(int topic_id, std::string* data)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	if (!topic_index.contains(topic_id))
+	{
+		return false;
+	}
+
+	return read_record(&topic_index.at(topic_id), data);
+}
+
+bool DDLArchiveStore::ReadPost(int post_id, std::string* data)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	if (!post_index.contains(post_id))
+	{
+		return false;
+	}
+
+	return read_record(&post_index.at(post_id), data);
+}
+
+bool DDLArchiveStore::ContainsTopic(int topic_id)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	return topic_index.contains(topic_id);
+}
+
+bool DDLArchiveStore::ContainsPost(int post_id)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	return post_index.contains(post_id);
+}
+
+bool DDLArchiveStore::GetPostStamp(int post_id, uint64_t* stamp)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	if (!post_index.contains(post_id))
+	{
+		return false;
+	}
+
+	DDLArchiveIndexEntry& entry = post_index.at(post_id);
+	*stamp = ((uint64_t)entry.segment << 48) ^ entry.offset;
+
+	return true;
+}
+
+std::vector<int> DDLArchiveStore::GetTopicIds(int category_id)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	std::vector<int> topic_ids = std::vector<int>();
+
+	for (std::pair<const int, DDLArchiveIndexEntry>& it : topic_index)
+	{
+		if (it.second.category_id == category_id)
+		{
+			topic_ids.push_back(it.first);
+		}
+	}
+
+	return topic_ids;
+}
+
+DDLResult DDLArchiveStore::ExportToDirectory(std::string json_root)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	DDL::Logger::LogEvent("exporting " + std::to_string(topic_index.size()) + " topics and " + std::to_string(post_index.size())
+		+ " posts from archive store to '" + json_root + "'...");
+
+	segment_stream.flush();
+
+	int failed_records = 0;
+	std::string record_data = "";
+
+	for (std::pair<const int, DDLArchiveIndexEntry>& it : topic_index)
+	{
+		std::string topic_directory = DDL::Discourse::Storage::GetTopicDirectory(json_root, it.second.category_id, it.second.topic_id);
+		DDL::Utils::IO::ValidatePath(topic_directory + "posts/");
+
+		if (!read_record(&it.second, &record_data) || !DDL::Utils::IO::CreateNewFileBinaryMode(topic_directory + "topic.json", record_data))
+		{
+			DDL::Logger::LogEvent("failed to export topic " + std::to_string(it.first), DDLLogLevel::Error);
+			failed_records++;
+		}
+	}
+
+	for (std::pair<const int, DDLArchiveIndexEntry>& it : post_index)
+	{
+		std::string post_directory = DDL::Discourse::Storage::GetTopicDirectory(json_root, it.second.category_id, it.second.topic_id) + "posts/";
+
+		// Posts are normally exported alongside their topic, but may have been saved without one if the topic failed part-way
+		if (!topic_index.contains(it.second.topic_id))
+		{
+			DDL::Utils::IO::ValidatePath(post_directory);
+		}
+
+		if (!read_record(&it.second, &record_data)
+			|| !DDL::Utils::IO::CreateNewFileBinaryMode(post_directory + std::to_string(it.first) + ".json", record_data))
+		{
+			DDL::Logger::LogEvent("failed to export post " + std::to_string(it.first), DDLLogLevel::Error);
+			failed_records++;
+		}
+	}
+
+	if (failed_records > 0)
+	{
+		DDL::Logger::LogEvent("archive export finished, but " + std::to_string(failed_records) + " records could not be exported", DDLLogLevel::Warning);
+		return DDLResult::Error_IncompleteDownload;
+	}
+
+	DDL::Logger::LogEvent("archive export finished");
+	return DDLResult::Success_OK;
+}
+
+void DDLArchiveStore::Flush()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	segment_stream.flush();
+	index_stream.flush();
+}
+
+std::string DDLArchiveStore::get_segment_path(uint32_t segment)
+{
+	std::string segment_number = std::to_string(segment);
+
+	while (segment_number.length() < 5)
+	{
+		segment_number = "0" + segment_number;
+	}
+
+	std::string segment_path = ARCHIVE_SEGMENT_FILE_FORMAT;
+	{
+		segment_path = DDL::Utils::String::Replace(segment_path, "<ARCHIVE_ROOT>", archive_root);
+		segment_path = DDL::Utils::String::Replace(segment_path, "<SEGMENT>", segment_number);
+	}
+
+	return segment_path;
+}
+
+void DDLArchiveStore::load_index()
+{
+	std::string index_path = DDL::Utils::String::Replace(ARCHIVE_INDEX_FILE_FORMAT, "<ARCHIVE_ROOT>", archive_root);
+
+	if (!DDL::Utils::IO::IsFile(index_path))
+	{
+		return;
+	}
+
+	std::unordered_map<uint32_t, uint64_t> segment_sizes = std::unordered_map<uint32_t, uint64_t>();
+	std::ifstream index_file = std::ifstream(index_path, std::ios::in | std::ios::binary);
+
+	uint64_t valid_index_size = 0;
+	int discarded_entries = 0;
+	DDLArchiveIndexEntry entry = DDLArchiveIndexEntry();
+
+	while (index_file.read((char*)&entry, sizeof(DDLArchiveIndexEntry)))
+	{
+		valid_index_size += sizeof(DDLArchiveIndexEntry);
+
+		if (!segment_sizes.contains(entry.segment))
+		{
+			std::error_code error;
+			uint64_t segment_size = std::filesystem::file_size(get_segment_path(entry.segment), error);
+
+			segment_sizes.insert(std::pair<uint32_t, uint64_t>(entry.segment, error ? 0 : segment_size));
+		}
+
+		if (entry.offset + entry.length > segment_sizes.at(entry.segment))
+		{
+			discarded_entries++;
+			continue;
+		}
+
+		if (entry.segment > active_segment)
+		{
+			active_segment = entry.segment;
+		}
+
+		if (entry.type == DDLArchiveRecordType::Topic)
+		{
+			topic_index.insert_or_assign(entry.record_id, entry);
+		}
+		else if (entry.type == DDLArchiveRecordType::Post)
+		{
+			post_index.insert_or_assign(entry.record_id, entry);
+		}
+	}
+
+	index_file.close();
+
+	// Drop any partially written entry, otherwise every entry appended after it would be misaligned
+	if (std::filesystem::file_size(index_path) != valid_index_size)
+	{
+		std::filesystem::resize_file(index_path, valid_index_size);
+	}
+
+	if (discarded_entries > 0)
+	{
+		DDL::Logger::LogEvent("discarded " + std::to_string(discarded_entries) + " archive index entries which point past the end of their segment, "
+			"these records will be downloaded again", DDLLogLevel::Warning);
+	}
+}
+
+void DDLArchiveStore::open_active_segment()
+{
+	segment_stream.close();
+
+	std::error_code error;
+	uint64_t segment_size = std::filesystem::file_size(get_segment_path(active_segment), error);
+
+	active_segment_size = error ? 0 : segment_size;
+
+	if (active_segment_size >= max_segment_size)
+	{
+		active_segment++;
+		active_segment_size = 0;
+	}
+
+	segment_stream = std::ofstream(get_segment_path(active_segment), std::ios::out | std::ios::app | std::ios::binary);
+}
+
+void DDLArchiveStore::open_index()
+{
+	index_stream.close();
+
+	std::string index_path = DDL::Utils::String::Replace(ARCHIVE_INDEX_FILE_FORMAT, "<ARCHIVE_ROOT>", archive_root);
+
+	// A failed write can leave part of an entry behind, which would misalign every entry appended after it
+	std::error_code error;
+	uint64_t index_size = std::filesystem::file_size(index_path, error);
+
+	if (!error && index_size % sizeof(DDLArchiveIndexEntry) != 0)
+	{
+		std::filesystem::resize_file(index_path, index_size - index_size % sizeof(DDLArchiveIndexEntry), error);
+	}
+
+	index_stream = std::ofstream(index_path, std::ios::out | std::ios::app | std::ios::binary);
+}
+
+bool DDLArchiveStore::append_record(DDLArchiveRecordType type, int category_id, int topic_id, int record_id, const char* data, size_t length)
+{
+	DDLTraceSpan write_span = DDLTraceSpan("append archive record", "io");
+
+	if (active_segment_size >= max_segment_size)
+	{
+		open_active_segment();
+	}
+
+	DDLArchiveRecordHeader header = DDLArchiveRecordHeader();
+	header.type = type;
+	header.category_id = category_id;
+	header.topic_id = topic_id;
+	header.record_id = record_id;
+	header.length = length;
+
+	segment_stream.write((char*)&header, sizeof(DDLArchiveRecordHeader));
+	segment_stream.write(data, length);
+
+	// Records are flushed before being indexed, otherwise a write failing later on would leave entries pointing at lost data
+	segment_stream.flush();
+
+	if (!segment_stream.good())
+	{
+		DDL::Logger::LogEvent("failed to write record " + std::to_string(record_id) + " to archive segment " + std::to_string(active_segment),
+			DDLLogLevel::Error);
+
+		// Reopening picks the segment size back up from the file, so the next record is placed after whatever was written
+		segment_stream.clear();
+		open_active_segment();
+
+		return false;
+	}
+
+	DDLArchiveIndexEntry entry = DDLArchiveIndexEntry();
+	entry.type = type;
+	entry.category_id = category_id;
+	entry.topic_id = topic_id;
+	entry.record_id = record_id;
+	entry.segment = active_segment;
+	entry.offset = active_segment_size + sizeof(DDLArchiveRecordHeader);
+	entry.length = header.length;
+
+	active_segment_size += sizeof(DDLArchiveRecordHeader) + header.length;
+
+	index_stream.write((char*)&entry, sizeof(DDLArchiveIndexEntry));
+
+	// Without an index entry the record can never be found, so it is left in the segment unused
+	if (!index_stream.good())
+	{
+		DDL::Logger::LogEvent("failed to write index entry for record " + std::to_string(record_id) + " to archive index", DDLLogLevel::Error);
+
+		index_stream.clear();
+		open_index();
+
+		return false;
+	}
+
+	if (type == DDLArchiveRecordType::Topic)
+	{
+		topic_index.insert_or_assign(record_id, entry);
+	}
+	else
+	{
+		post_index.insert_or_assign(record_id, entry);
+	}
+
+	return true;
+}
+
+bool DDLArchiveStore::read_record(DDLArchiveIndexEntry* entry, std::string* data)
+{
+	if (entry->segment == active_segment)
+	{
+		segment_stream.flush();
+	}
+
+	std::ifstream segment_file = std::ifstream(get_segment_path(entry->segment), std::ios::in | std::ios::binary);
+
+	if (!segment_file.good())
+	{
+		return false;
+	}
+
+	data->resize(entry->length);
+
+	segment_file.seekg(entry->offset);
+	segment_file.read(data->data(), entry->length);
+
+	return segment_file.good();
+}
@@ -0,0 +1,158 @@
+#include "storage.h"
+
+#include <filesystem>
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/utils/hash/hash.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+
+DDLBlobStore::DDLBlobStore(std::string _blob_root)
+{
+	blob_root = _blob_root;
+
+	DDL::Utils::IO::ValidatePath(blob_root);
+
+	// Anything left over from a download which was interrupted last time
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(blob_root, error))
+	{
+		if (entry.is_regular_file() && entry.path().filename().string().starts_with("incoming_"))
+		{
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+
+	load_url_index();
+
+	url_index_stream = std::ofstream(blob_root + "urls", std::ios::out | std::ios::app | std::ios::binary);
+
+	DDL::Logger::LogEvent("opened blob store with " + std::to_string(url_index.size()) + " known urls");
+}
+
+DDLBlobStore::~DDLBlobStore()
+{
+	url_index_stream.close();
+}
+
+void DDLBlobStore::load_url_index()
+{
+	if (!DDL::Utils::IO::IsFile(blob_root + "urls"))
+	{
+		return;
+	}
+
+	for (std::string& line : DDL::Utils::IO::GetFileContentsAsLines(blob_root + "urls"))
+	{
+		size_t separator = line.find(',');
+
+		// A line which was only partially written before the application was closed won't have a url after it
+		if (separator == std::string::npos || separator == 0 || separator + 1 >= line.length())
+		{
+			continue;
+		}
+
+		url_index[line.substr(separator + 1)] = line.substr(0, separator);
+	}
+}
+
+bool DDLBlobStore::FindBlob(std::string url, std::string* blob_path)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	if (!url_index.contains(url) || !DDL::Utils::IO::IsFile(blob_root + url_index.at(url)))
+	{
+		return false;
+	}
+
+	*blob_path = blob_root + url_index.at(url);
+	reused_urls++;
+
+	return true;
+}
+
+std::string DDLBlobStore::GetIncomingPath()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	return blob_root + "incoming_" + std::to_string(next_incoming_file++);
+}
+
+bool DDLBlobStore::AddBlob(std::string incoming_path, std::string url, std::string extension, std::string* blob_path)
+{
+	std::string data = "";
+
+	if (!DDL::Utils::IO::ReadBinaryFile(incoming_path, &data))
+	{
+		DDL::Logger::LogEvent("could not read downloaded file '" + incoming_path + "', it will not be added to the blob store", DDLLogLevel::Error);
+		return false;
+	}
+
+	char hash[17] = { 0 };
+	sprintf_s(hash, sizeof(hash), "%016llx", (unsigned long long)DDL::Utils::Hash::FNV1a64(data.data(), data.length()));
+
+	std::string blob_directory = std::string(hash, 2) + "/";
+	std::string blob_name = blob_directory + hash + "_" + std::to_string(data.length()) + extension;
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+	std::error_code error;
+
+	if (DDL::Utils::IO::IsFile(blob_root + blob_name))
+	{
+		std::filesystem::remove(incoming_path, error);
+		reused_blobs++;
+	}
+	else
+	{
+		DDL::Utils::IO::ValidatePath(blob_root + blob_directory);
+		std::filesystem::rename(incoming_path, blob_root + blob_name, error);
+
+		if (error)
+		{
+			DDL::Logger::LogEvent("could not move '" + incoming_path + "' into the blob store: " + error.message(), DDLLogLevel::Error);
+			return false;
+		}
+
+		added_blobs++;
+	}
+
+	url_index[url] = blob_name;
+	url_index_stream << blob_name << "," << url << "\n";
+	url_index_stream.flush();
+
+	*blob_path = blob_root + blob_name;
+	return true;
+}
+
+bool DDLBlobStore::LinkBlob(std::string blob_path, std::string target_path)
+{
+	std::error_code error;
+
+	// Linking fails if the target already exists, and the old file may be a copy rather than a link to this blob anyway
+	std::filesystem::remove(target_path, error);
+	std::filesystem::create_hard_link(blob_path, target_path, error);
+
+	if (!error)
+	{
+		return true;
+	}
+
+	error.clear();
+	std::filesystem::copy_file(blob_path, target_path, std::filesystem::copy_options::overwrite_existing, error);
+
+	if (error)
+	{
+		DDL::Logger::LogEvent("could not place '" + blob_path + "' at '" + target_path + "': " + error.message(), DDLLogLevel::Error);
+		return false;
+	}
+
+	return true;
+}
+
+void DDLBlobStore::LogStatistics()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(store_mutex);
+
+	DDL::Logger::LogEvent("blob store: " + std::to_string(added_blobs) + " new files stored, " + std::to_string(reused_blobs)
+		+ " downloads matched an existing file, " + std::to_string(reused_urls) + " downloads skipped as their url was already stored");
+}
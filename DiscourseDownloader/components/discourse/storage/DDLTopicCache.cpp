@@ -0,0 +1,258 @@
+#include "storage.h"
+
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+
+bool DDLTopicCache::Open(std::string path)
+{
+	Close();
+
+	if (!file.Open(path))
+	{
+		return false;
+	}
+
+	const char* data = file.GetData();
+	size_t size = file.GetSize();
+
+	if (size < sizeof(DDLTopicCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	header = (const DDLTopicCacheHeader*)data;
+
+	uint64_t records_size = (uint64_t)header->topic_count * sizeof(DDLTopicCacheRecord);
+	uint64_t post_ids_size = (uint64_t)header->post_id_count * sizeof(int32_t);
+
+	if (header->magic != TOPIC_CACHE_MAGIC || header->version != TOPIC_CACHE_VERSION
+		|| sizeof(DDLTopicCacheHeader) + records_size + post_ids_size + header->url_length != size)
+	{
+		Close();
+		return false;
+	}
+
+	records = (const DDLTopicCacheRecord*)(data + sizeof(DDLTopicCacheHeader));
+	post_ids = (const int32_t*)(data + sizeof(DDLTopicCacheHeader) + records_size);
+	urls = data + sizeof(DDLTopicCacheHeader) + records_size + post_ids_size;
+
+	// A damaged record could otherwise point anywhere in memory
+	for (uint32_t i = 0; i < header->topic_count; i++)
+	{
+		const DDLTopicCacheRecord& record = records[i];
+
+		if ((uint64_t)record.first_post_index + record.post_id_count > header->post_id_count
+			|| (uint64_t)record.url_offset + record.url_length > header->url_length)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void DDLTopicCache::Close()
+{
+	file.Close();
+
+	header = nullptr;
+	records = nullptr;
+	post_ids = nullptr;
+	urls = nullptr;
+}
+
+uint32_t DDLTopicCache::GetTopicCount()
+{
+	return header ? header->topic_count : 0;
+}
+
+const DDLTopicCacheRecord* DDLTopicCache::GetTopic(uint32_t index)
+{
+	return &records[index];
+}
+
+const int32_t* DDLTopicCache::GetPostIDs(const DDLTopicCacheRecord* record)
+{
+	return post_ids + record->first_post_index;
+}
+
+std::string_view DDLTopicCache::GetURL(const DDLTopicCacheRecord* record)
+{
+	return std::string_view(urls + record->url_offset, record->url_length);
+}
+
+void DDLTopicCacheWriter::AddTopic(int topic_id, int posts_count, std::string_view url, const std::vector<int>* topic_post_ids)
+{
+	DDLTopicCacheRecord record = DDLTopicCacheRecord();
+	record.topic_id = topic_id;
+	record.posts_count = posts_count;
+	record.first_post_index = post_ids.size();
+	record.url_offset = urls.length();
+	record.url_length = url.length();
+
+	if (topic_post_ids)
+	{
+		record.post_id_count = topic_post_ids->size();
+		post_ids.insert(post_ids.end(), topic_post_ids->begin(), topic_post_ids->end());
+	}
+
+	urls.append(url);
+	records.push_back(record);
+}
+
+bool DDLTopicCacheWriter::Save(std::string path)
+{
+	std::sort(records.begin(), records.end(), [](const DDLTopicCacheRecord& a, const DDLTopicCacheRecord& b)
+	{
+		return a.topic_id < b.topic_id;
+	});
+
+	DDLTopicCacheHeader header = DDLTopicCacheHeader();
+	header.topic_count = records.size();
+	header.post_id_count = post_ids.size();
+	header.url_length = urls.length();
+
+	std::string cache_contents = "";
+	{
+		cache_contents.reserve(sizeof(header) + records.size() * sizeof(DDLTopicCacheRecord) + post_ids.size() * sizeof(int32_t) + urls.length());
+
+		cache_contents.append((const char*)&header, sizeof(header));
+		cache_contents.append((const char*)records.data(), records.size() * sizeof(DDLTopicCacheRecord));
+		cache_contents.append((const char*)post_ids.data(), post_ids.size() * sizeof(int32_t));
+		cache_contents.append(urls);
+	}
+
+	if (!DDL::Utils::IO::CreateNewFileBinaryMode(path + ".tmp", cache_contents))
+	{
+		return false;
+	}
+
+	std::error_code rename_error;
+	std::filesystem::rename(path + ".tmp", path, rename_error);
+
+	return !rename_error;
+}
+
+/**
+* Parses an integer field from a text cache entry.
+*
+* @returns `true` if the whole field is an integer, otherwise returns `false`.
+*/
+bool parse_legacy_cache_int(std::string_view field, int* value)
+{
+	std::from_chars_result result = std::from_chars(field.data(), field.data() + field.length(), *value);
+	return field.length() > 0 && result.ec == std::errc() && result.ptr == field.data() + field.length();
+}
+
+bool DDL::Discourse::Storage::ConvertLegacyTopicCache(std::string text_path, std::string cache_path, bool is_data_cache)
+{
+	std::string text = "";
+
+	if (!DDL::Utils::IO::ReadBinaryFile(text_path, &text))
+	{
+		return false;
+	}
+
+	DDLTopicCacheWriter writer = DDLTopicCacheWriter();
+	std::vector<int> post_ids = std::vector<int>();
+	int skipped_entries = 0;
+
+	for (std::string& entry : DDL::Utils::String::Split(text, "\n"))
+	{
+		if (entry.ends_with("\r"))
+		{
+			entry.pop_back();
+		}
+
+		if (entry.length() == 0)
+		{
+			continue;
+		}
+
+		std::vector<std::string> components = DDL::Utils::String::Split(entry, "|");
+		int topic_id = -1;
+
+		// Url caches are all or nothing, as a missing topic would never be downloaded
+		if (!is_data_cache)
+		{
+			if (components.size() != 2 || !parse_legacy_cache_int(components.at(0), &topic_id))
+			{
+				DDL::Logger::LogEvent("url cache '" + text_path + "' contains an invalid entry and will not be converted", DDLLogLevel::Warning);
+				return false;
+			}
+
+			writer.AddTopic(topic_id, -1, components.at(1), nullptr);
+			continue;
+		}
+
+		int post_count = -1;
+
+		if (components.size() != 4 || !parse_legacy_cache_int(components.at(1), &topic_id) || !parse_legacy_cache_int(components.at(2), &post_count))
+		{
+			skipped_entries++;
+			continue;
+		}
+
+		post_ids.clear();
+		bool entry_valid = true;
+
+		if (components.at(3).length() > 0)
+		{
+			for (std::string& post_id_str : DDL::Utils::String::Split(components.at(3), ","))
+			{
+				int post_id = -1;
+
+				if (!parse_legacy_cache_int(post_id_str, &post_id))
+				{
+					entry_valid = false;
+					break;
+				}
+
+				post_ids.push_back(post_id);
+			}
+		}
+
+		if (!entry_valid || post_ids.size() != post_count)
+		{
+			skipped_entries++;
+			continue;
+		}
+
+		writer.AddTopic(topic_id, post_count, components.at(0), &post_ids);
+	}
+
+	if (skipped_entries > 0)
+	{
+		DDL::Logger::LogEvent("skipped " + std::to_string(skipped_entries) + " invalid entries while converting data cache '" + text_path
+			+ "', these topics cannot be verified", DDLLogLevel::Warning);
+	}
+
+	if (!writer.Save(cache_path))
+	{
+		DDL::Logger::LogEvent("failed to write converted cache '" + cache_path + "'", DDLLogLevel::Error);
+		return false;
+	}
+
+	DDL::Logger::LogEvent("converted '" + text_path + "' to '" + cache_path + "'");
+	return true;
+}
+
+bool DDL::Discourse::Storage::OpenTopicCache(std::string category_directory, bool is_data_cache, DDLTopicCache* cache)
+{
+	std::string cache_path = category_directory + (is_data_cache ? DATA_CACHE_FILENAME : URL_CACHE_FILENAME);
+	std::string text_path = category_directory + (is_data_cache ? LEGACY_DATA_CACHE_FILENAME : LEGACY_URL_CACHE_FILENAME);
+
+	if (!DDL::Utils::IO::IsFile(cache_path) && DDL::Utils::IO::IsFile(text_path))
+	{
+		ConvertLegacyTopicCache(text_path, cache_path, is_data_cache);
+	}
+
+	return DDL::Utils::IO::IsFile(cache_path) && cache->Open(cache_path);
+}
@@ -0,0 +1,257 @@
+#include "storage.h"
+
+#include <filesystem>
+
+#include "components/discourse/discourse.h"
+#include "components/diagnostics/logger/logger.h"
+#include "components/settings/settings.h"
+#include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
+#include "components/utils/converters/converters.h"
+
+DDLArchiveStore* archive_store = nullptr;
+std::once_flag archive_store_init_flag;
+
+DDLBlobStore* blob_store = nullptr;
+std::once_flag blob_store_init_flag;
+
+bool DDL::Discourse::Storage::IsArchiveEnabled()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		return false;
+	}
+
+	return DDL::Utils::String::ToLower(config->storage_backend) == "archive";
+}
+
+DDLArchiveStore* DDL::Discourse::Storage::GetArchiveStore()
+{
+	if (!IsArchiveEnabled())
+	{
+		return nullptr;
+	}
+
+	std::call_once(archive_store_init_flag, []()
+	{
+		WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+		uint64_t max_segment_size = (uint64_t)config->archive_segment_size_mb * 1024 * 1024;
+
+		if (max_segment_size == 0)
+		{
+			max_segment_size = (uint64_t)256 * 1024 * 1024;
+		}
+
+		archive_store = new DDLArchiveStore(config->json_path + "/archive/", max_segment_size);
+	});
+
+	return archive_store;
+}
+
+DDLBlobStore* DDL::Discourse::Storage::GetBlobStore()
+{
+	std::call_once(blob_store_init_flag, []()
+	{
+		blob_store = new DDLBlobStore(DDL::Settings::GetSiteConfig()->json_path + "/blobs/");
+	});
+
+	return blob_store;
+}
+
+std::string DDL::Discourse::Storage::GetTopicDirectory(std::string json_root, int category_id, int topic_id)
+{
+	std::string topic_directory = JSON_CATEGORY_ROOT_FORMAT + "topics/<TOPIC_ID>/";
+	{
+		topic_directory = DDL::Utils::String::Replace(topic_directory, "<JSON_ROOT>", json_root);
+		topic_directory = DDL::Utils::String::Replace(topic_directory, "<CAT_ID>", std::to_string(category_id));
+		topic_directory = DDL::Utils::String::Replace(topic_directory, "<TOPIC_ID>", std::to_string(topic_id));
+	}
+
+	return topic_directory;
+}
+
+bool DDL::Discourse::Storage::SaveTopic(int category_id, int topic_id, std::string* data)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->WriteTopic(category_id, topic_id, data);
+	}
+
+	std::string topic_directory = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id);
+	DDL::Utils::IO::ValidatePath(topic_directory + "posts/");
+
+	return DDL::Utils::IO::CreateNewFile(topic_directory + "topic.json", *data);
+}
+
+bool DDL::Discourse::Storage::SavePost(int category_id, int topic_id, int post_id, const char* data, size_t length)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->WritePost(category_id, topic_id, post_id, data, length);
+	}
+
+	std::string post_directory = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id) + "posts/";
+
+	return DDL::Utils::IO::CreateNewFile(post_directory + std::to_string(post_id) + ".json", data, length);
+}
+
+bool DDL::Discourse::Storage::LoadTopic(int category_id, int topic_id, std::string* data)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->ReadTopic(topic_id, data);
+	}
+
+	std::string topic_path = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id) + "topic.json";
+
+	if (!DDL::Utils::IO::IsFile(topic_path))
+	{
+		return false;
+	}
+
+	*data = DDL::Utils::IO::GetFileContentsAsString(topic_path);
+	return true;
+}
+
+bool DDL::Discourse::Storage::LoadPost(int category_id, int topic_id, int post_id, std::string* data)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->ReadPost(post_id, data);
+	}
+
+	std::string post_path = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id)
+		+ "posts/" + std::to_string(post_id) + ".json";
+
+	if (!DDL::Utils::IO::IsFile(post_path))
+	{
+		return false;
+	}
+
+	*data = DDL::Utils::IO::GetFileContentsAsString(post_path);
+	return true;
+}
+
+bool DDL::Discourse::Storage::TopicExists(int category_id, int topic_id)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->ContainsTopic(topic_id);
+	}
+
+	std::string topic_directory = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id);
+
+	return DDL::Utils::IO::IsDirectory(topic_directory)
+		&& DDL::Utils::IO::IsFile(topic_directory + "topic.json")
+		&& DDL::Utils::IO::IsDirectory(topic_directory + "posts/");
+}
+
+bool DDL::Discourse::Storage::PostExists(int category_id, int topic_id, int post_id)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->ContainsPost(post_id);
+	}
+
+	std::string post_path = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id)
+		+ "posts/" + std::to_string(post_id) + ".json";
+
+	return DDL::Utils::IO::IsFile(post_path);
+}
+
+bool DDL::Discourse::Storage::GetPostStamp(int category_id, int topic_id, int post_id, uint64_t* stamp)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->GetPostStamp(post_id, stamp);
+	}
+
+	std::string post_path = GetTopicDirectory(DDL::Settings::GetSiteConfig()->json_path, category_id, topic_id)
+		+ "posts/" + std::to_string(post_id) + ".json";
+
+	return DDL::Utils::IO::GetFileStamp(post_path, stamp);
+}
+
+std::vector<int> DDL::Discourse::Storage::ListTopics(int category_id)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (store)
+	{
+		return store->GetTopicIds(category_id);
+	}
+
+	std::vector<int> topic_ids = std::vector<int>();
+	std::string topics_directory = JSON_CATEGORY_ROOT_FORMAT + "topics/";
+	{
+		topics_directory = DDL::Utils::String::Replace(topics_directory, "<JSON_ROOT>", DDL::Settings::GetSiteConfig()->json_path);
+		topics_directory = DDL::Utils::String::Replace(topics_directory, "<CAT_ID>", std::to_string(category_id));
+	}
+
+	if (!DDL::Utils::IO::IsDirectory(topics_directory))
+	{
+		return topic_ids;
+	}
+
+	std::error_code error;
+
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(topics_directory, error))
+	{
+		std::string directory_name = entry.path().filename().string();
+
+		if (entry.is_directory() && directory_name.length() > 0 && directory_name.find_first_not_of("0123456789") == std::string::npos
+			&& DDL::Utils::IO::IsFile(topics_directory + directory_name + "/topic.json"))
+		{
+			topic_ids.push_back(DDL::Converters::StringToInt(directory_name));
+		}
+	}
+
+	return topic_ids;
+}
+
+DDLResult DDL::Discourse::Storage::ExportArchive(std::string json_root)
+{
+	DDLArchiveStore* store = GetArchiveStore();
+
+	if (!store)
+	{
+		DDL::Logger::LogEvent("cannot export archive store, storage_backend in website.cfg is not set to 'archive'", DDLLogLevel::Error);
+		return DDLResult::Error_Generic;
+	}
+
+	return store->ExportToDirectory(json_root);
+}
+
+void DDL::Discourse::Storage::Cleanup()
+{
+	if (archive_store)
+	{
+		archive_store->Flush();
+
+		delete archive_store;
+		archive_store = nullptr;
+	}
+
+	if (blob_store)
+	{
+		delete blob_store;
+		blob_store = nullptr;
+	}
+}
@@ -0,0 +1,550 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+#include <fstream>
+#include <mutex>
+
+#include "components/diagnostics/errors/errors.h"
+#include "components/utils/io/io.h"
+
+#define ARCHIVE_RECORD_MAGIC 0x52414444 //!< Magic number at the start of every archive record ("DDAR").
+#define ARCHIVE_SEGMENT_FILE_FORMAT std::string("<ARCHIVE_ROOT>segment_<SEGMENT>.ddla")
+#define ARCHIVE_INDEX_FILE_FORMAT std::string("<ARCHIVE_ROOT>index.ddli")
+
+#define TOPIC_CACHE_MAGIC 0x43544444 //!< Magic number at the start of every topic cache file ("DDTC").
+#define TOPIC_CACHE_VERSION 1
+#define URL_CACHE_FILENAME std::string("urlcache.ddlc")
+#define DATA_CACHE_FILENAME std::string("datacache.ddlc")
+#define LEGACY_URL_CACHE_FILENAME std::string("urlcache")   //!< The pipe-delimited text url cache used by older versions.
+#define LEGACY_DATA_CACHE_FILENAME std::string("datacache") //!< The pipe-delimited text data cache used by older versions.
+
+/**
+* Enumerator listing the types of record which can be stored in an archive.
+*/
+enum class DDLArchiveRecordType : uint8_t
+{
+	Topic = 1,
+	Post = 2,
+};
+
+#pragma pack(push, 1)
+
+/**
+* Header written before the data of every record in an archive segment. This allows the index to be checked
+* against (or rebuilt from) the segments themselves.
+*/
+struct DDLArchiveRecordHeader
+{
+	uint32_t magic = ARCHIVE_RECORD_MAGIC; //!< Always #ARCHIVE_RECORD_MAGIC.
+	DDLArchiveRecordType type = DDLArchiveRecordType::Topic; //!< The type of record that follows.
+	int32_t category_id = -1; //!< The ID of the category that the record belongs to.
+	int32_t topic_id = -1;    //!< The ID of the topic that the record belongs to.
+	int32_t record_id = -1;   //!< The ID of the topic or post.
+	uint32_t length = 0;      //!< The length of the record data, excluding this header.
+};
+
+/**
+* Entry in the archive index, describing where a single record is stored. Entries are only ever appended, so
+* if a record has been written more than once, the last entry for it wins.
+*/
+struct DDLArchiveIndexEntry
+{
+	DDLArchiveRecordType type = DDLArchiveRecordType::Topic; //!< The type of record.
+	int32_t category_id = -1; //!< The ID of the category that the record belongs to.
+	int32_t topic_id = -1;    //!< The ID of the topic that the record belongs to.
+	int32_t record_id = -1;   //!< The ID of the topic or post.
+	uint32_t segment = 0;     //!< The segment the record is stored in.
+	uint64_t offset = 0;      //!< The offset of the record data (past its header) within the segment.
+	uint32_t length = 0;      //!< The length of the record data.
+};
+
+/**
+* Header at the start of every topic cache file.
+*/
+struct DDLTopicCacheHeader
+{
+	uint32_t magic = TOPIC_CACHE_MAGIC; //!< Always #TOPIC_CACHE_MAGIC.
+	uint32_t version = TOPIC_CACHE_VERSION; //!< Always #TOPIC_CACHE_VERSION.
+	uint32_t topic_count = 0;   //!< The number of topic records following the header.
+	uint32_t post_id_count = 0; //!< The number of post IDs following the topic records.
+	uint32_t url_length = 0;    //!< The total length of the URLs following the post IDs.
+	uint32_t reserved = 0;
+};
+
+/**
+* Fixed-width record describing a single topic in a topic cache file.
+*/
+struct DDLTopicCacheRecord
+{
+	int32_t topic_id = -1;
+	int32_t posts_count = -1;      //!< The post count reported by the topic, or -1 in a url cache.
+	uint32_t first_post_index = 0; //!< The index of the topic's first post ID within the post ID section.
+	uint32_t post_id_count = 0;    //!< The number of post IDs saved for the topic.
+	uint32_t url_offset = 0;       //!< The offset of the topic's URL within the URL section.
+	uint32_t url_length = 0;       //!< The length of the topic's URL.
+};
+
+#pragma pack(pop)
+
+/**
+* Class representing a packed, append-only store for topic and post JSON.
+*
+* Rather than writing one file per post, records are appended to large segment files, and an index of where each
+* record lives is appended to a separate index file. The index is loaded into memory when the store is opened, so
+* lookups never need to touch the disk. Once a segment grows past the configured size, a new one is started.
+*/
+class DDLArchiveStore
+{
+private:
+	std::mutex store_mutex;
+
+	std::string archive_root = ""; //!< The directory containing the segment and index files.
+	uint64_t max_segment_size = 0; //!< The size at which a new segment is started.
+
+	std::unordered_map<int, DDLArchiveIndexEntry> topic_index = std::unordered_map<int, DDLArchiveIndexEntry>(); //!< Index entries for topics, keyed by topic ID.
+	std::unordered_map<int, DDLArchiveIndexEntry> post_index = std::unordered_map<int, DDLArchiveIndexEntry>(); //!< Index entries for posts, keyed by post ID.
+
+	uint32_t active_segment = 0;      //!< The segment that new records are appended to.
+	uint64_t active_segment_size = 0; //!< The current size of the active segment.
+	std::ofstream segment_stream;     //!< Output stream for the active segment.
+	std::ofstream index_stream;       //!< Output stream for the index file.
+
+	/**
+	* Builds the path to a segment file.
+	*
+	* @param segment - The segment number.
+	*
+	* @returns The path to the segment file.
+	*/
+	std::string get_segment_path(uint32_t segment);
+
+	/**
+	* Loads the index file, discarding any entries which point past the end of their segment (ie, if the
+	* application was closed while a record was being written).
+	*/
+	void load_index();
+
+	/**
+	* Opens the active segment for writing, starting a new segment if the current one is full.
+	*/
+	void open_active_segment();
+
+	/**
+	* Opens the index file for appending, first removing any partially written entry from the end of it.
+	*/
+	void open_index();
+
+	/**
+	* Appends a record to the active segment and index. The store mutex must be held when calling this.
+	*/
+	bool append_record(DDLArchiveRecordType type, int category_id, int topic_id, int record_id, const char* data, size_t length);
+
+	/**
+	* Reads the data for an index entry from its segment.
+	*/
+	bool read_record(DDLArchiveIndexEntry* entry, std::string* data);
+
+public:
+	/**
+	* Opens an archive store, creating it if it does not already exist.
+	*
+	* @param _archive_root - The directory to store segments and the index in.
+	* @param _max_segment_size - The size, in bytes, at which a new segment is started.
+	*/
+	DDLArchiveStore(std::string _archive_root, uint64_t _max_segment_size);
+
+	~DDLArchiveStore();
+
+	/**
+	* Appends a topic's JSON data to the store.
+	*
+	* @param category_id - The ID of the category the topic belongs to.
+	* @param topic_id - The ID of the topic.
+	* @param data - The topic JSON.
+	*
+	* @returns `true` if the topic was written successfully, otherwise returns `false`.
+	*/
+	bool WriteTopic(int category_id, int topic_id, std::string* data);
+
+	/**
+	* Appends a post's JSON data to the store.
+	*
+	* @param category_id - The ID of the category the post belongs to.
+	* @param topic_id - The ID of the topic the post belongs to.
+	* @param post_id - The ID of the post.
+	* @param data - The post JSON.
+	* @param length - The length of the post JSON.
+	*
+	* @returns `true` if the post was written successfully, otherwise returns `false`.
+	*/
+	bool WritePost(int category_id, int topic_id, int post_id, const char* data, size_t length);
+
+	/**
+	* Reads a topic's JSON data from the store.
+	*
+	* @param topic_id - The ID of the topic.
+	* @param data - Pointer to a string, which the topic JSON will be written to.
+	*
+	* @returns `true` if the topic was found and read successfully, otherwise returns `false`.
+	*/
+	bool ReadTopic(int topic_id, std::string* data);
+
+	/**
+	* Reads a post's JSON data from the store.
+	*
+	* @param post_id - The ID of the post.
+	* @param data - Pointer to a string, which the post JSON will be written to.
+	*
+	* @returns `true` if the post was found and read successfully, otherwise returns `false`.
+	*/
+	bool ReadPost(int post_id, std::string* data);
+
+	bool ContainsTopic(int topic_id);
+	bool ContainsPost(int post_id);
+
+	/**
+	* Retrieves a stamp identifying the last write of a post, without reading the post itself. Records are never
+	* overwritten in place, so the stamp changes whenever the post is written again.
+	*
+	* @param post_id - The ID of the post.
+	* @param stamp - Pointer to an integer, which the stamp will be written to.
+	*
+	* @returns `true` if the post was found, otherwise returns `false`.
+	*/
+	bool GetPostStamp(int post_id, uint64_t* stamp);
+
+	/**
+	* Retrieves the IDs of every topic stored for a category.
+	*
+	* @param category_id - The ID of the category.
+	*
+	* @returns The IDs of the category's topics, in no particular order.
+	*/
+	std::vector<int> GetTopicIds(int category_id);
+
+	/**
+	* Writes every record in the store out using the regular directory layout, identical to what the files
+	* storage backend would have produced.
+	*
+	* @param json_root - The JSON root directory to export to.
+	*
+	* @returns #DDLResult::Success_OK if every record was exported, otherwise returns an error code.
+	*/
+	DDLResult ExportToDirectory(std::string json_root);
+
+	/**
+	* Flushes any buffered writes to disk.
+	*/
+	void Flush();
+};
+
+/**
+* Class representing a content-addressed store for downloaded images, such as avatars.
+*
+* Every distinct file is stored once, named by the hash and size of its contents, and linked into place wherever it is
+* needed. Many users share identical avatars (especially the default letter avatars), so this saves both disk space and,
+* since the URL each file was downloaded from is remembered, repeated requests for the same URL.
+*
+* Blobs are stored as `<BLOB_ROOT>/<first 2 hash digits>/<hash>_<size><extension>`. The URLs are recorded in a file named
+* `urls` in the blob root, with one `<blob name>,<url>` line per download, which is appended to as new files are added.
+*/
+class DDLBlobStore
+{
+private:
+	std::mutex store_mutex;
+
+	std::string blob_root = ""; //!< The directory containing the blobs.
+	std::unordered_map<std::string, std::string> url_index = std::unordered_map<std::string, std::string>(); //!< The blob downloaded from each URL, relative to the blob root.
+	std::ofstream url_index_stream; //!< Output stream for the URL index file.
+	int next_incoming_file = 0; //!< Number used to keep the names of files which are still being downloaded unique.
+
+	int reused_urls = 0;   //!< The number of times a URL was found in the index rather than downloaded.
+	int reused_blobs = 0;  //!< The number of downloads which turned out to be identical to an existing blob.
+	int added_blobs = 0;   //!< The number of new blobs added.
+
+	/**
+	* Loads the URL index file.
+	*/
+	void load_url_index();
+
+public:
+	/**
+	* Opens a blob store, creating it if it does not already exist.
+	*
+	* @param _blob_root - The directory to store blobs in.
+	*/
+	DDLBlobStore(std::string _blob_root);
+
+	~DDLBlobStore();
+
+	/**
+	* Looks up the blob previously downloaded from a URL.
+	*
+	* @param url - The URL.
+	* @param blob_path - Pointer to a string, which the path to the blob will be written to.
+	*
+	* @returns `true` if the URL has been downloaded before and its blob still exists, otherwise returns `false`.
+	*/
+	bool FindBlob(std::string url, std::string* blob_path);
+
+	/**
+	* Builds a unique path for a new download to be written to, before it is added with #AddBlob. The path is inside the
+	* blob root, so that it can be moved into place without copying.
+	*
+	* @returns The path to download to.
+	*/
+	std::string GetIncomingPath();
+
+	/**
+	* Adds a downloaded file to the store. If an identical blob already exists, the downloaded file is deleted instead.
+	*
+	* @param incoming_path - The path that the file was downloaded to.
+	* @param url - The URL the file was downloaded from.
+	* @param extension - The file extension, including the leading `.`.
+	* @param blob_path - Pointer to a string, which the path to the blob will be written to.
+	*
+	* @returns `true` if the file was added, otherwise returns `false`.
+	*/
+	bool AddBlob(std::string incoming_path, std::string url, std::string extension, std::string* blob_path);
+
+	/**
+	* Places a blob at another path, using a hard link if possible or a copy if not (ie, if the paths are on different drives).
+	*
+	* @param blob_path - The path to the blob.
+	* @param target_path - The path to place the blob at. Any existing file at this path is replaced.
+	*
+	* @returns `true` if the blob was placed, otherwise returns `false`.
+	*/
+	bool LinkBlob(std::string blob_path, std::string target_path);
+
+	/**
+	* Logs how many downloads have been avoided or deduplicated since the store was opened.
+	*/
+	void LogStatistics();
+};
+
+/**
+* Class representing a read-only view of a topic cache file (`urlcache.ddlc` or `datacache.ddlc`), which lists the topics
+* of a category along with their URLs and, for data caches, the IDs of their saved posts.
+*
+* The file is memory-mapped and read in place, so opening even a very large cache only costs a single pass over the
+* records to check that they are in bounds. The file is laid out as a #DDLTopicCacheHeader, followed by the
+* #DDLTopicCacheRecord of every topic (sorted by topic ID), then every topic's post IDs as 32-bit integers, then every
+* topic's URL with nothing in between.
+*/
+class DDLTopicCache
+{
+private:
+	DDLMappedFile file = DDLMappedFile(); //!< The mapped cache file.
+	const DDLTopicCacheHeader* header = nullptr; //!< The header of the mapped file.
+	const DDLTopicCacheRecord* records = nullptr; //!< The topic records of the mapped file.
+	const int32_t* post_ids = nullptr; //!< The post ID section of the mapped file.
+	const char* urls = nullptr; //!< The URL section of the mapped file.
+
+public:
+	/**
+	* Opens a topic cache file, checking that it is complete and that every record lies within the file.
+	*
+	* @param path - The path to the cache file.
+	*
+	* @returns `true` if the cache was opened, otherwise returns `false`.
+	*/
+	bool Open(std::string path);
+
+	/**
+	* Closes the cache file. Any pointers or views returned by the cache are no longer valid after this.
+	*/
+	void Close();
+
+	/**
+	* Retrieves the number of topics in the cache.
+	*
+	* @returns The number of topics, or 0 if no cache is open.
+	*/
+	uint32_t GetTopicCount();
+
+	/**
+	* Retrieves a topic record.
+	*
+	* @param index - The index of the topic, which must be less than #GetTopicCount.
+	*
+	* @returns Pointer to the topic's record.
+	*/
+	const DDLTopicCacheRecord* GetTopic(uint32_t index);
+
+	/**
+	* Retrieves the saved post IDs of a topic.
+	*
+	* @param record - The topic record.
+	*
+	* @returns Pointer to the first of the record's `post_id_count` post IDs.
+	*/
+	const int32_t* GetPostIDs(const DDLTopicCacheRecord* record);
+
+	/**
+	* Retrieves the URL of a topic.
+	*
+	* @param record - The topic record.
+	*
+	* @returns View of the URL, which is only valid while the cache is open.
+	*/
+	std::string_view GetURL(const DDLTopicCacheRecord* record);
+};
+
+/**
+* Class used to build a topic cache file in memory and write it out.
+*/
+class DDLTopicCacheWriter
+{
+private:
+	std::vector<DDLTopicCacheRecord> records = std::vector<DDLTopicCacheRecord>(); //!< The record of every added topic.
+	std::vector<int32_t> post_ids = std::vector<int32_t>(); //!< The post IDs of every added topic.
+	std::string urls = ""; //!< The URLs of every added topic.
+
+public:
+	/**
+	* Adds a topic to the cache.
+	*
+	* @param topic_id - The ID of the topic.
+	* @param posts_count - The post count reported by the topic, or -1 if not known.
+	* @param url - The URL of the topic's JSON data.
+	* @param topic_post_ids - The IDs of the topic's saved posts, or `nullptr` if there are none.
+	*/
+	void AddTopic(int topic_id, int posts_count, std::string_view url, const std::vector<int>* topic_post_ids);
+
+	/**
+	* Writes the cache to disk. The file is written to a temporary file first and then renamed into place, so an existing
+	* cache is never left half-written.
+	*
+	* @param path - The path to save the cache to.
+	*
+	* @returns `true` if the cache was saved, otherwise returns `false`.
+	*/
+	bool Save(std::string path);
+};
+
+/**
+* Namespace containing functions for saving and loading downloaded topics and posts.
+*
+* Depending on the `storage_backend` setting in website.cfg, topics and posts are either written as individual files
+* (`files`, the default) or appended to a packed #DDLArchiveStore (`archive`). Code which reads or writes topic and post
+* JSON should always go through these functions rather than accessing the files directly.
+*/
+namespace DDL::Discourse::Storage
+{
+	/**
+	* Checks whether topics and posts are being stored in a packed archive.
+	*
+	* @returns `true` if the archive backend is in use, otherwise returns `false`.
+	*/
+	bool IsArchiveEnabled();
+
+	/**
+	* Retrieves the archive store, opening it on first use.
+	*
+	* @returns The archive store, or `nullptr` if the archive backend is not in use.
+	*/
+	DDLArchiveStore* GetArchiveStore();
+
+	/**
+	* Retrieves the blob store used for downloaded images, opening it on first use.
+	*
+	* @returns The blob store.
+	*/
+	DDLBlobStore* GetBlobStore();
+
+	/**
+	* Builds the path to the directory that a topic is saved to when using the files backend.
+	*
+	* @param json_root - The JSON root directory.
+	* @param category_id - The ID of the category the topic belongs to.
+	* @param topic_id - The ID of the topic.
+	*
+	* @returns The topic directory, including a trailing `/`.
+	*/
+	std::string GetTopicDirectory(std::string json_root, int category_id, int topic_id);
+
+	bool SaveTopic(int category_id, int topic_id, std::string* data);
+	bool SavePost(int category_id, int topic_id, int post_id, const char* data, size_t length);
+
+	bool LoadTopic(int category_id, int topic_id, std::string* data);
+	bool LoadPost(int category_id, int topic_id, int post_id, std::string* data);
+
+	/**
+	* Checks whether a topic has already been saved.
+	*
+	* @returns `true` if the topic exists in the active storage backend, otherwise returns `false`.
+	*/
+	bool TopicExists(int category_id, int topic_id);
+
+	/**
+	* Checks whether a post has already been saved.
+	*
+	* @returns `true` if the post exists in the active storage backend, otherwise returns `false`.
+	*/
+	bool PostExists(int category_id, int topic_id, int post_id);
+
+	/**
+	* Retrieves a stamp which changes whenever a saved post is written again, without reading the post. This is the
+	* location of the post's latest record when using the archive backend, or its file size and modification time
+	* otherwise.
+	*
+	* @param category_id - The ID of the category the post belongs to.
+	* @param topic_id - The ID of the topic the post belongs to.
+	* @param post_id - The ID of the post.
+	* @param stamp - Pointer to an integer, which the stamp will be written to.
+	*
+	* @returns `true` if the post exists in the active storage backend, otherwise returns `false`.
+	*/
+	bool GetPostStamp(int category_id, int topic_id, int post_id, uint64_t* stamp);
+
+	/**
+	* Retrieves the IDs of every topic saved for a category.
+	*
+	* @param category_id - The ID of the category.
+	*
+	* @returns The IDs of the category's topics, in no particular order.
+	*/
+	std::vector<int> ListTopics(int category_id);
+
+	/**
+	* Exports the archive store to the regular directory layout.
+	*
+	* @param json_root - The JSON root directory to export to.
+	*
+	* @returns #DDLResult::Success_OK if the export succeeded, otherwise returns an error code.
+	*/
+	DDLResult ExportArchive(std::string json_root);
+
+	/**
+	* Converts a pipe-delimited text url cache or data cache, as written by older versions, into a topic cache file. The
+	* text cache is left in place.
+	*
+	* @param text_path - The path to the text cache.
+	* @param cache_path - The path to write the topic cache to.
+	* @param is_data_cache - `true` if the text cache is a data cache, or `false` if it is a url cache.
+	*
+	* @returns `true` if the cache was converted, otherwise returns `false`.
+	*/
+	bool ConvertLegacyTopicCache(std::string text_path, std::string cache_path, bool is_data_cache);
+
+	/**
+	* Opens the url cache or data cache of a category, converting it from the old text format first if needed.
+	*
+	* @param category_directory - The category's directory, including the trailing `/`.
+	* @param is_data_cache - `true` to open the data cache, or `false` to open the url cache.
+	* @param cache - The cache to open.
+	*
+	* @returns `true` if the cache was opened, otherwise returns `false`.
+	*/
+	bool OpenTopicCache(std::string category_directory, bool is_data_cache, DDLTopicCache* cache);
+
+	/**
+	* Flushes and closes the archive and blob stores, if they are open.
+	*/
+	void Cleanup();
+}
@@ -41,6 +41,8 @@ bool DDL::Settings::LoadAllConfigurations()
 	ddl_website_config.download_topics = *site_config->GetBool("website_config", "download_topics");
 	ddl_website_config.download_misc = *site_config->GetBool("website_config", "download_misc");
 	ddl_website_config.perform_html_build = *site_config->GetBool("website_config", "perform_html_build");
+	ddl_website_config.html_build_threads = *site_config->GetInt("website_config", "html_build_threads");
+	ddl_website_config.build_search_index = *site_config->GetBool("website_config", "build_search_index");
 
 	// networking
 	ddl_website_config.max_http_retries = *site_config->GetInt("networking", "max_http_retries");
@@ -52,6 +54,11 @@ bool DDL::Settings::LoadAllConfigurations()
 	ddl_website_config.fail_on_403 = *site_config->GetBool("networking", "fail_on_403");
 	ddl_website_config.fail_on_404 = *site_config->GetBool("networking", "fail_on_404");
 	ddl_website_config.max_404s = *site_config->GetInt("networking", "max_404s");
+	ddl_website_config.max_concurrent_requests = *site_config->GetInt("networking", "max_concurrent_requests");
+	ddl_website_config.enable_rate_limiter = *site_config->GetBool("networking", "enable_rate_limiter");
+	ddl_website_config.initial_request_rate = *site_config->GetFloat("networking", "initial_request_rate");
+	ddl_website_config.min_request_rate = *site_config->GetFloat("networking", "min_request_rate");
+	ddl_website_config.max_request_rate = *site_config->GetFloat("networking", "max_request_rate");
 
 	// download
 	ddl_website_config.resume_download = *site_config->GetBool("download", "resume_download");
@@ -61,9 +68,14 @@ bool DDL::Settings::LoadAllConfigurations()
 	ddl_website_config.redownload_if_missing_cache = *site_config->GetBool("download", "redownload_if_missing_cache");
 	ddl_website_config.sanity_check_on_finish = *site_config->GetBool("download", "sanity_check_on_finish");
 	ddl_website_config.thorough_sanity_check = *site_config->GetBool("download", "thorough_sanity_check");
+	ddl_website_config.sanity_check_threads = *site_config->GetInt("download", "sanity_check_threads");
 	ddl_website_config.download_skip_existing_categories = *site_config->GetBool("download", "download_skip_existing_categories");
 	ddl_website_config.download_skip_existing_topics = *site_config->GetBool("download", "download_skip_existing_topics");
 	ddl_website_config.download_skip_existing_posts = *site_config->GetBool("download", "download_skip_existing_posts");
+	ddl_website_config.storage_backend = *site_config->GetString("download", "storage_backend");
+	ddl_website_config.archive_segment_size_mb = *site_config->GetInt("download", "archive_segment_size_mb");
+	ddl_website_config.resume_commit_interval = *site_config->GetInt("download", "resume_commit_interval");
+	ddl_website_config.incremental_sync = *site_config->GetBool("download", "incremental_sync");
 
 	// forums
 	ddl_website_config.max_get_more_topics = *site_config->GetInt("forums", "max_get_more_topics");
@@ -76,11 +88,33 @@ bool DDL::Settings::LoadAllConfigurations()
 	ddl_website_config.strict_topic_count_checks = *site_config->GetBool("forums", "strict_topic_count_checks");
 	ddl_website_config.download_all_tag_extras = *site_config->GetBool("forums", "download_all_tag_extras");
 	ddl_website_config.max_skipped_topic_urls = *site_config->GetInt("forums", "max_skipped_topic_urls");
+	ddl_website_config.max_pending_topics = *site_config->GetInt("forums", "max_pending_topics");
 
 	// users
 	ddl_website_config.download_all_user_actions = *site_config->GetBool("users", "download_all_user_actions");
 	ddl_website_config.download_all_avatar_sizes = *site_config->GetBool("users", "download_all_avatar_sizes");
 	ddl_website_config.download_private_messages = *site_config->GetBool("users", "download_private_messages");
+	ddl_website_config.max_pending_users = *site_config->GetInt("users", "max_pending_users");
+
+	// benchmark
+	ddl_website_config.benchmark_directory = *site_config->GetString("benchmark", "directory");
+	ddl_website_config.benchmark_category_count = *site_config->GetInt("benchmark", "category_count");
+	ddl_website_config.benchmark_topics_per_category = *site_config->GetInt("benchmark", "topics_per_category");
+	ddl_website_config.benchmark_posts_per_topic = *site_config->GetInt("benchmark", "posts_per_topic");
+	ddl_website_config.benchmark_user_count = *site_config->GetInt("benchmark", "user_count");
+	ddl_website_config.benchmark_tag_count = *site_config->GetInt("benchmark", "tag_count");
+	ddl_website_config.benchmark_group_count = *site_config->GetInt("benchmark", "group_count");
+	ddl_website_config.benchmark_post_request_limit = *site_config->GetInt("benchmark", "post_request_limit");
+	ddl_website_config.benchmark_latency_ms = *site_config->GetInt("benchmark", "latency_ms");
+	ddl_website_config.benchmark_latency_jitter_ms = *site_config->GetInt("benchmark", "latency_jitter_ms");
+	ddl_website_config.benchmark_rate_limit_percent = *site_config->GetInt("benchmark", "rate_limit_percent");
+	ddl_website_config.benchmark_server_error_percent = *site_config->GetInt("benchmark", "server_error_percent");
+	ddl_website_config.benchmark_seed = *site_config->GetInt("benchmark", "seed");
+
+	// metrics
+	ddl_website_config.metrics_enabled = *site_config->GetBool("metrics", "enabled");
+	ddl_website_config.metrics_textfile_path = *site_config->GetString("metrics", "textfile_path");
+	ddl_website_config.metrics_flush_interval = *site_config->GetInt("metrics", "flush_interval");
 
 	// paths
 	ddl_website_config.html_path = *site_config->GetString("paths", "html_dir");
@@ -93,6 +127,8 @@ bool DDL::Settings::LoadAllConfigurations()
 	// misc
 	ddl_website_config.disable_long_finish_message = *site_config->GetBool("misc", "disable_long_finish_message");
 	ddl_website_config.log_level_debug = *site_config->GetBool("misc", "log_level_debug");
+	ddl_website_config.log_level = *site_config->GetString("misc", "log_level");
+	ddl_website_config.log_history_limit = *site_config->GetInt("misc", "log_history_limit");
 	
 
 	// Perform any required alterations to config settings
@@ -120,6 +156,22 @@ bool DDL::Settings::LoadAllConfigurations()
 		ddl_website_config.html_path = ddl_website_config.site_directory_root + ddl_website_config.html_path;
 		ddl_website_config.json_path = ddl_website_config.site_directory_root + ddl_website_config.json_path;
 
+		// Topic list pages are only requested while fewer topics than this are pending, so anything below 1 would never request one
+		if (ddl_website_config.max_pending_topics < 1)
+		{
+			DDL::Logger::LogEvent("max_pending_topics must be at least 1, but was set to " + std::to_string(ddl_website_config.max_pending_topics)
+				+ " - 1 will be used instead", DDLLogLevel::Warning);
+			ddl_website_config.max_pending_topics = 1;
+		}
+
+		// Likewise for directory pages and users
+		if (ddl_website_config.max_pending_users < 1)
+		{
+			DDL::Logger::LogEvent("max_pending_users must be at least 1, but was set to " + std::to_string(ddl_website_config.max_pending_users)
+				+ " - 1 will be used instead", DDLLogLevel::Warning);
+			ddl_website_config.max_pending_users = 1;
+		}
+
 		if (ddl_website_config.use_category_id_filter)
 		{
 			std::vector<std::string> category_ids_str = DDL::Utils::String::Split(ddl_website_config.category_id_filter, ",");
@@ -17,6 +17,8 @@ struct WebsiteConfig
     bool download_topics = true;
     bool download_misc = true;
     bool perform_html_build = false;
+    int html_build_threads = 0;
+    bool build_search_index = false;
 
     // networking
     int max_http_retries = 60;
@@ -28,6 +30,11 @@ struct WebsiteConfig
     bool fail_on_403 = true;
     bool fail_on_404 = true;
     int max_404s = 5;
+    int max_concurrent_requests = 4;
+    bool enable_rate_limiter = true;
+    float initial_request_rate = 4.0f;
+    float min_request_rate = 0.5f;
+    float max_request_rate = 50.0f;
 
     // download
     bool resume_download = true;
@@ -37,13 +44,18 @@ struct WebsiteConfig
     bool redownload_if_missing_cache = false;
     bool sanity_check_on_finish = true;
     bool thorough_sanity_check = true;
+    int sanity_check_threads = 0;
     bool download_skip_existing_categories = false;
     bool download_skip_existing_topics = false;
     bool download_skip_existing_posts = true;
+    std::string storage_backend = "files";
+    int archive_segment_size_mb = 256;
+    int resume_commit_interval = 50;
+    bool incremental_sync = false;
 
     // forums
     int max_get_more_topics = -1;
-    int max_posts_per_request = 20;
+    int max_posts_per_request = 200;
     int topic_url_collection_notify_interval = 15;
     bool download_subcategory_topics = false;
     bool use_category_id_filter = false;
@@ -53,12 +65,34 @@ struct WebsiteConfig
     bool strict_topic_count_checks = false;
     bool download_all_tag_extras = false;
     int max_skipped_topic_urls = 100;
+    int max_pending_topics = 1000;
 
     // users
     bool download_all_user_actions = true;
     bool download_all_avatar_sizes = true;
     bool download_private_messages = false;
+    int max_pending_users = 200;
     
+    // benchmark
+    std::string benchmark_directory = "./benchmark/";
+    int benchmark_category_count = 4;
+    int benchmark_topics_per_category = 250;
+    int benchmark_posts_per_topic = 40;
+    int benchmark_user_count = 500;
+    int benchmark_tag_count = 20;
+    int benchmark_group_count = 5;
+    int benchmark_post_request_limit = 0;
+    int benchmark_latency_ms = 50;
+    int benchmark_latency_jitter_ms = 50;
+    int benchmark_rate_limit_percent = 0;
+    int benchmark_server_error_percent = 0;
+    int benchmark_seed = 1;
+
+    // metrics
+    bool metrics_enabled = false;
+    std::string metrics_textfile_path = "./discoursedl.prom";
+    int metrics_flush_interval = 15;
+
     // paths
     std::string html_path = "export/";
     std::string json_path = "json/";
@@ -70,6 +104,8 @@ struct WebsiteConfig
     // misc
     bool disable_long_finish_message = false;
     bool log_level_debug = false;
+    std::string log_level = "info";
+    int log_history_limit = 0;
 };
 
 /**
@@ -26,12 +26,8 @@ void DDL::Settings::Switches::ParseSwitches(int args_count, char* args[])
 			}
 
 			found_switch = true;
+			new_switch = BlamCommandSwitch();
 			new_switch.name = arg.substr(1, arg.length() - 1);
-
-			if (i == args_count - 1)
-			{
-				active_switches.push_back(new_switch);
-			}
 		}
 		else
 		{
@@ -57,6 +53,12 @@ void DDL::Settings::Switches::ParseSwitches(int args_count, char* args[])
 		}
 	}
 
+	// The last switch is only added here, as any value following it still needs to be read
+	if (found_switch)
+	{
+		active_switches.push_back(new_switch);
+	}
+
 	DDL::Logger::LogEvent("interpreted " + std::to_string(active_switches.size()) + " command line switches");
 }
 
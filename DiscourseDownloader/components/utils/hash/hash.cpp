@@ -0,0 +1,59 @@
+#include "hash.h"
+
+#include <array>
+
+std::array<uint32_t, 256> build_crc32_table()
+{
+	std::array<uint32_t, 256> table = std::array<uint32_t, 256>();
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc = i;
+
+		for (int bit = 0; bit < 8; bit++)
+		{
+			crc = (crc & 1) ? (0xEDB88320 ^ (crc >> 1)) : (crc >> 1);
+		}
+
+		table[i] = crc;
+	}
+
+	return table;
+}
+
+uint32_t DDL::Utils::Hash::CRC32(const char* data, size_t length)
+{
+	return CRC32(data, length, 0);
+}
+
+uint32_t DDL::Utils::Hash::CRC32(const char* data, size_t length, uint32_t previous)
+{
+	static const std::array<uint32_t, 256> crc32_table = build_crc32_table();
+
+	uint32_t crc = previous ^ 0xFFFFFFFF;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		crc = crc32_table[(crc ^ (uint8_t)data[i]) & 0xFF] ^ (crc >> 8);
+	}
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+uint32_t DDL::Utils::Hash::CRC32(std::string data)
+{
+	return CRC32(data.c_str(), data.length());
+}
+
+uint64_t DDL::Utils::Hash::FNV1a64(const char* data, size_t length)
+{
+	uint64_t hash = 0xCBF29CE484222325;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash ^= (uint8_t)data[i];
+		hash *= 0x100000001B3;
+	}
+
+	return hash;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <stdint.h>
+
+/**
+* Namespace containing functions for computing checksums and hashes.
+*/
+namespace DDL::Utils::Hash
+{
+	/**
+	* Computes the CRC-32 checksum of a block of data, using the standard (zlib) polynomial.
+	*
+	* @param data - The data to checksum.
+	* @param length - The length of the data.
+	*
+	* @returns The CRC-32 checksum of the data.
+	*/
+	uint32_t CRC32(const char* data, size_t length);
+
+	/**
+	* Continues a CRC-32 checksum over another block of data, so that several blocks can be checksummed as if they were
+	* one, without joining them together first.
+	*
+	* @param data - The data to checksum.
+	* @param length - The length of the data.
+	* @param previous - The checksum of every block before this one, or 0 if this is the first block.
+	*
+	* @returns The CRC-32 checksum of every block so far.
+	*/
+	uint32_t CRC32(const char* data, size_t length, uint32_t previous);
+
+	/**
+	* Computes the CRC-32 checksum of a string.
+	*
+	* @param data - The string to checksum.
+	*
+	* @returns The CRC-32 checksum of the string.
+	*/
+	uint32_t CRC32(std::string data);
+
+	/**
+	* Computes the 64-bit FNV-1a hash of a block of data. Unlike CRC-32, this is wide enough to identify files by their
+	* contents across a large archive without collisions becoming likely.
+	*
+	* @param data - The data to hash.
+	* @param length - The length of the data.
+	*
+	* @returns The FNV-1a hash of the data.
+	*/
+	uint64_t FNV1a64(const char* data, size_t length);
+}
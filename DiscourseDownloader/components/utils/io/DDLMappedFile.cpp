@@ -0,0 +1,89 @@
+#include "io.h"
+
+#include <Windows.h>
+
+DDLMappedFile::~DDLMappedFile()
+{
+	Close();
+}
+
+bool DDLMappedFile::Open(std::string path)
+{
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	file_handle = file;
+
+	LARGE_INTEGER file_size = LARGE_INTEGER();
+
+	if (!GetFileSizeEx(file, &file_size))
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)file_size.QuadPart;
+
+	// Windows refuses to map an empty file, but there is nothing to read from one anyway
+	if (size == 0)
+	{
+		return true;
+	}
+
+	mapping_handle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (!mapping_handle)
+	{
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void DDLMappedFile::Close()
+{
+	if (data)
+	{
+		UnmapViewOfFile(data);
+		data = nullptr;
+	}
+
+	if (mapping_handle)
+	{
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+
+	if (file_handle)
+	{
+		CloseHandle(file_handle);
+		file_handle = nullptr;
+	}
+
+	size = 0;
+}
+
+const char* DDLMappedFile::GetData()
+{
+	return data;
+}
+
+size_t DDLMappedFile::GetSize()
+{
+	return size;
+}
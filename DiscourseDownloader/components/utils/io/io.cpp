@@ -18,6 +18,8 @@
 #include <filesystem>
 
 #include "components/utils/string/string.h"
+#include "components/diagnostics/metrics/metrics.h"
+#include "components/diagnostics/trace/trace.h"
 
 bool DDL::Utils::IO::FileExists(std::string name)
 {
@@ -37,72 +39,131 @@ bool DDL::Utils::IO::FileExists(std::string name)
 
 bool DDL::Utils::IO::IsFile(std::string path)
 {
-	if (FileExists(path))
-	{
-		struct stat file_stat;
+	struct stat file_stat;
 
-		stat(path.c_str(), &file_stat);
+	return stat(path.c_str(), &file_stat) == 0 && S_ISREG(file_stat.st_mode);
+}
 
-		if (S_ISREG(file_stat.st_mode))
-		{
-			return true;
-		}
+bool DDL::Utils::IO::IsDirectory(std::string path)
+{
+	struct stat file_stat;
+
+	return stat(path.c_str(), &file_stat) == 0 && S_ISDIR(file_stat.st_mode);
+}
+
+bool DDL::Utils::IO::GetFileStamp(std::string path, uint64_t* stamp)
+{
+	struct stat file_stat;
+
+	if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+	{
+		return false;
 	}
 
-	return false;
+	*stamp = ((uint64_t)file_stat.st_mtime << 32) ^ (uint64_t)file_stat.st_size;
+	return true;
 }
 
-bool DDL::Utils::IO::IsDirectory(std::string path)
+bool DDL::Utils::IO::ListDirectory(std::string path, std::vector<std::string>* names)
 {
-	if (FileExists(path))
+	std::error_code error;
+	std::filesystem::directory_iterator iterator = std::filesystem::directory_iterator(path, error);
+
+	if (error)
 	{
-		struct stat file_stat;
+		return false;
+	}
 
-		stat(path.c_str(), &file_stat);
+	names->clear();
 
-		if (S_ISDIR(file_stat.st_mode))
-		{
-			return true;
-		}
+	for (; iterator != std::filesystem::directory_iterator(); iterator.increment(error))
+	{
+		names->push_back(iterator->path().filename().string());
 	}
 
-	return false;
+	return !error;
+}
+
+void DDL::Utils::IO::RecordWrittenFile(size_t length)
+{
+	static DDLMetricCounter* file_counter = DDL::Metrics::GetCounter("ddl_files_written_total", "The number of files written.");
+	static DDLMetricCounter* byte_counter = DDL::Metrics::GetCounter("ddl_file_bytes_written_total", "The total size of every file written.");
+
+	file_counter->Increment();
+	byte_counter->Increment(length);
 }
 
 bool DDL::Utils::IO::CreateNewFile(std::string filename, std::string file_contents)
 {
+	DDLTraceSpan write_span = DDLTraceSpan("write file", "io");
+	write_span.AddArg("path", filename);
+
 	std::ofstream file = std::ofstream(filename, std::ios::out | std::ios::trunc);
 
-	if (!file.bad())
+	if (!file.is_open())
 	{
-		file << file_contents;
-		file.close();
+		return false;
+	}
 
-		return true;
+	file << file_contents;
+	file.close();
+
+	// Closing flushes the stream, so a failed write may only show up here
+	if (!file.good())
+	{
+		return false;
 	}
-	else
+
+	RecordWrittenFile(file_contents.length());
+	return true;
+}
+
+bool DDL::Utils::IO::CreateNewFile(std::string filename, const char* data, size_t length)
+{
+	DDLTraceSpan write_span = DDLTraceSpan("write file", "io");
+	write_span.AddArg("path", filename);
+
+	std::ofstream file = std::ofstream(filename, std::ios::out | std::ios::trunc);
+
+	if (!file.is_open())
 	{
-		file.close();
 		return false;
 	}
+
+	file.write(data, length);
+	file.close();
+
+	if (!file.good())
+	{
+		return false;
+	}
+
+	RecordWrittenFile(length);
+	return true;
 }
 
 bool DDL::Utils::IO::CreateNewFileBinaryMode(std::string filename, std::string file_contents)
 {
+	DDLTraceSpan write_span = DDLTraceSpan("write file", "io");
+	write_span.AddArg("path", filename);
+
 	std::ofstream file = std::ofstream(filename, std::ios::out | std::ios::trunc | std::ios::binary);
 
-	if (!file.bad())
+	if (!file.is_open())
 	{
-		file << file_contents;
-		file.close();
-
-		return true;
+		return false;
 	}
-	else
+
+	file << file_contents;
+	file.close();
+
+	if (!file.good())
 	{
-		file.close();
 		return false;
 	}
+
+	RecordWrittenFile(file_contents.length());
+	return true;
 }
 
 std::vector<std::string> DDL::Utils::IO::GetFileContentsAsLines(std::string path)
@@ -137,7 +198,7 @@ std::string DDL::Utils::IO::GetFileContentsAsString(std::string path)
 	return file_contents;
 }
 
-bool DDL::Utils::IO::ReadBinaryFile(std::string path, void* data, int64_t* size)
+bool DDL::Utils::IO::ReadBinaryFile(std::string path, std::string* data)
 {
 	std::ifstream file;
 
@@ -145,14 +206,17 @@ bool DDL::Utils::IO::ReadBinaryFile(std::string path, void* data, int64_t* size)
 
 	if (file.good())
 	{
+		file.seekg(0, std::ios::end);
+		std::streamoff size = file.tellg();
 		file.seekg(0, std::ios::beg);
-		*size = file.tellg();
 
-		data = malloc(*size);
-		file.read((char*)data, *size);
+		data->resize(size);
+		file.read(data->data(), size);
+
+		bool read_result = file.good();
 
 		file.close();
-		return true;
+		return read_result;
 	}
 	else
 	{
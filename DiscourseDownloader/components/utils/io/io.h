@@ -1,5 +1,59 @@
+#pragma once
+
 #include <string>
 #include <vector>
+#include <stdint.h>
+
+/**
+* Class representing a read-only, memory-mapped view of a file. The file's contents can be read directly from memory
+* without copying, and pages are only loaded from disk as they are touched.
+*/
+class DDLMappedFile
+{
+private:
+	void* file_handle = nullptr; //!< Handle to the open file.
+	void* mapping_handle = nullptr; //!< Handle to the file mapping.
+	const char* data = nullptr; //!< The mapped contents of the file.
+	size_t size = 0; //!< The size of the file, in bytes.
+
+public:
+	DDLMappedFile() = default;
+	DDLMappedFile(const DDLMappedFile&) = delete;
+	DDLMappedFile& operator=(const DDLMappedFile&) = delete;
+
+	/**
+	* Unmaps the file, if one is open.
+	*/
+	~DDLMappedFile();
+
+	/**
+	* Maps a file into memory, closing any file which was already open.
+	*
+	* @param path - The path to the file.
+	*
+	* @returns `true` if the file was mapped, otherwise returns `false`.
+	*/
+	bool Open(std::string path);
+
+	/**
+	* Unmaps the file. Any pointers into its data are no longer valid after this.
+	*/
+	void Close();
+
+	/**
+	* Retrieves the mapped contents of the file.
+	*
+	* @returns Pointer to the start of the file, or `nullptr` if no file is open or the file is empty.
+	*/
+	const char* GetData();
+
+	/**
+	* Retrieves the size of the file.
+	*
+	* @returns The size of the file in bytes.
+	*/
+	size_t GetSize();
+};
 
 /**
 * Utilities relating to reading/writing to and from files.
@@ -35,6 +89,17 @@ namespace DDL::Utils::IO
 	*/
 	bool IsDirectory(std::string path);
 
+	/**
+	* Retrieves a stamp made from a file's size and last modification time, which changes whenever the file is rewritten
+	* without the file having to be read.
+	*
+	* @param path - The path of the file.
+	* @param stamp - Pointer to an integer, which the stamp will be written to.
+	*
+	* @returns `true` if the path refers to a regular file, otherwise returns `false`.
+	*/
+	bool GetFileStamp(std::string path, uint64_t* stamp);
+
 	/**
 	* Creates a file with the specified contents, or overwrites an existing file if it already exists.
 	*
@@ -45,6 +110,18 @@ namespace DDL::Utils::IO
 	*/
 	bool CreateNewFile(std::string filename, std::string file_contents);
 
+	/**
+	* Creates a file with the specified contents, or overwrites an existing file if it already exists. Useful
+	* for writing data straight from an existing buffer, without copying it into a string first.
+	*
+	* @param filename - The path to the file to create.
+	* @param data - The contents to write to the file.
+	* @param length - The length of the contents.
+	*
+	* @returns `true` if the file was created successfully, otherwise returns `false`.
+	*/
+	bool CreateNewFile(std::string filename, const char* data, size_t length);
+
 	/**
 	* Creates a file with the specified contents, or overwrites an existing file if it already exists.
 	* Identical to CreateNewFile, but with the `std::ios::binary` flag set.
@@ -56,16 +133,33 @@ namespace DDL::Utils::IO
 	*/
 	bool CreateNewFileBinaryMode(std::string filename, std::string file_contents);
 
+	/**
+	* Counts a file towards the files written metrics. Files written with the functions above are counted automatically,
+	* so this only needs to be called for files written some other way, such as downloads.
+	*
+	* @param length - The size of the file, in bytes.
+	*/
+	void RecordWrittenFile(size_t length);
+
+	/**
+	* Lists the names of everything in a directory with a single pass over it, rather than checking each file separately.
+	*
+	* @param path - The path of the directory.
+	* @param names - Pointer to a list, which the name of every file and subdirectory will be written to.
+	*
+	* @returns `true` if the directory was read, `false` if it does not exist or could not be read.
+	*/
+	bool ListDirectory(std::string path, std::vector<std::string>* names);
+
 	/**
 	* Reads a file as raw binary data.
 	*
 	* @param path - The path of the file to read from.
-	* @param data - Address to write data to.
-	* @param size - Pointer of the size of the resource.
+	* @param data - Pointer to a string, which the contents of the file will be written to.
 	*
 	* @returns `true` if the file was read without error, `false` if the file could not be read.
 	*/
-	bool ReadBinaryFile(std::string path, void* data, int64_t* size);
+	bool ReadBinaryFile(std::string path, std::string* data);
 
 	/**
 	* Reads a file as a list of strings. Can be used to easily read a set of lines from a plain
@@ -0,0 +1,168 @@
+#include "network.h"
+
+#include "components/diagnostics/logger/logger.h"
+
+DDLFixtureArchive::~DDLFixtureArchive()
+{
+	Close();
+}
+
+bool DDLFixtureArchive::OpenForRecording(std::string path)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(archive_mutex);
+
+	record_stream.open(path, std::ios::binary | std::ios::trunc);
+
+	if (!record_stream.is_open())
+	{
+		DDL::Logger::LogEvent("could not create fixture archive '" + path + "'", DDLLogLevel::Error);
+		return false;
+	}
+
+	return true;
+}
+
+bool DDLFixtureArchive::OpenForReplay(std::string path)
+{
+	Close();
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(archive_mutex);
+
+	if (!DDL::Utils::IO::IsFile(path) || !replay_file.Open(path))
+	{
+		DDL::Logger::LogEvent("could not open fixture archive '" + path + "'", DDLLogLevel::Error);
+		return false;
+	}
+
+	const char* data = replay_file.GetData();
+	size_t size = replay_file.GetSize();
+	size_t offset = 0;
+	int64_t response_count = 0;
+
+	while (size - offset >= sizeof(DDLFixtureRecordHeader))
+	{
+		const DDLFixtureRecordHeader* header = (const DDLFixtureRecordHeader*)(data + offset);
+		uint64_t record_size = sizeof(DDLFixtureRecordHeader) + (uint64_t)header->url_length + header->body_length;
+
+		if (header->magic != FIXTURE_RECORD_MAGIC || record_size > size - offset)
+		{
+			break;
+		}
+
+		std::string_view url = std::string_view(data + offset + sizeof(DDLFixtureRecordHeader), header->url_length);
+		fixtures[url].responses.push_back(header);
+
+		offset += record_size;
+		response_count++;
+	}
+
+	if (offset != size)
+	{
+		DDL::Logger::LogEvent("fixture archive '" + path + "' ends with an incomplete response, which will be ignored", DDLLogLevel::Warning);
+	}
+
+	DDL::Logger::LogEvent("replaying " + std::to_string(response_count) + " recorded responses for " + std::to_string(fixtures.size())
+		+ " urls from fixture archive '" + path + "'");
+
+	return true;
+}
+
+void DDLFixtureArchive::Close()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(archive_mutex);
+
+	if (record_stream.is_open())
+	{
+		record_stream.close();
+		DDL::Logger::LogEvent("recorded " + std::to_string(recorded_count) + " responses into fixture archive");
+	}
+
+	if (replay_file.GetData() || fixtures.size() > 0)
+	{
+		DDL::Logger::LogEvent("replayed " + std::to_string(replayed_count) + " responses from fixture archive, "
+			+ std::to_string(missing_count) + " requests had no recorded response");
+	}
+
+	fixtures.clear();
+	replay_file.Close();
+
+	recorded_count = 0;
+	replayed_count = 0;
+	missing_count = 0;
+}
+
+bool DDLFixtureArchive::Record(DDLNetworkRequest* request)
+{
+	std::string downloaded_file = "";
+	const std::string* body = &request->response;
+
+	// Downloads never hold the response in memory, so it's read back from the saved file instead
+	if (request->output_path != "" && request->http_code == 200)
+	{
+		if (!DDL::Utils::IO::ReadBinaryFile(request->output_path, &downloaded_file))
+		{
+			DDL::Logger::LogEvent("could not read '" + request->output_path + "', it will be missing from the fixture archive", DDLLogLevel::Warning);
+			return false;
+		}
+
+		body = &downloaded_file;
+	}
+
+	DDLFixtureRecordHeader header = DDLFixtureRecordHeader();
+	header.http_code = request->http_code;
+	header.url_length = request->url.length();
+	header.body_length = body->length();
+
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(archive_mutex);
+
+	if (!record_stream.is_open())
+	{
+		return false;
+	}
+
+	record_stream.write((const char*)&header, sizeof(DDLFixtureRecordHeader));
+	record_stream.write(request->url.data(), request->url.length());
+	record_stream.write(body->data(), body->length());
+
+	if (!record_stream.good())
+	{
+		DDL::Logger::LogEvent("failed to write to fixture archive, no further responses will be recorded", DDLLogLevel::Error);
+		record_stream.close();
+		return false;
+	}
+
+	recorded_count++;
+	return true;
+}
+
+int DDLFixtureArchive::Replay(DDLNetworkRequest* request)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(archive_mutex);
+
+	std::unordered_map<std::string_view, fixture_entry>::iterator it = fixtures.find(request->url);
+
+	if (it == fixtures.end())
+	{
+		DDL::Logger::LogEvent("no recorded response for '" + request->url + "' in fixture archive", DDLLogLevel::Warning);
+
+		request->http_code = -1;
+		missing_count++;
+		return 0;
+	}
+
+	fixture_entry& entry = it->second;
+	const DDLFixtureRecordHeader* header = entry.responses.at(entry.next_response);
+
+	if (entry.next_response + 1 < entry.responses.size())
+	{
+		entry.next_response++;
+	}
+
+	request->http_code = header->http_code;
+	request->response.assign((const char*)header + sizeof(DDLFixtureRecordHeader) + header->url_length, header->body_length);
+
+	replayed_count++;
+	return 0;
+}
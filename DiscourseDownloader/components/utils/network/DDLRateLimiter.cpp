@@ -0,0 +1,135 @@
+#include "network.h"
+
+#include <algorithm>
+
+#include "components/settings/settings.h"
+#include "components/diagnostics/logger/logger.h"
+
+void DDLRateLimiter::Configure()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(limiter_mutex);
+
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		return;
+	}
+
+	enabled = config->enable_rate_limiter;
+	request_rate = config->initial_request_rate;
+	min_request_rate = config->min_request_rate;
+	max_request_rate = config->max_request_rate;
+
+	if (min_request_rate <= 0)
+	{
+		min_request_rate = 0.1;
+	}
+
+	if (max_request_rate < min_request_rate)
+	{
+		max_request_rate = min_request_rate;
+	}
+
+	request_rate = std::clamp(request_rate, min_request_rate, max_request_rate);
+	tokens = 1.0;
+	last_refill_time = std::chrono::steady_clock::now();
+}
+
+bool DDLRateLimiter::TryAcquire(std::chrono::steady_clock::time_point* next_available)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(limiter_mutex);
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	if (now < blocked_until)
+	{
+		*next_available = blocked_until;
+		return false;
+	}
+
+	if (!enabled)
+	{
+		return true;
+	}
+
+	refill_tokens();
+
+	if (tokens >= 1.0)
+	{
+		tokens -= 1.0;
+		return true;
+	}
+
+	double seconds_until_token = (1.0 - tokens) / request_rate;
+	*next_available = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds_until_token));
+
+	return false;
+}
+
+void DDLRateLimiter::OnResponse(DDLNetworkRequest* request)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(limiter_mutex);
+
+	if (request->http_code == 429 || request->http_code == 503)
+	{
+		double previous_rate = request_rate;
+
+		request_rate = std::max(min_request_rate, request_rate * multiplicative_decrease);
+		tokens = 0.0;
+
+		if (request->retry_after > 0)
+		{
+			std::chrono::steady_clock::time_point retry_time = std::chrono::steady_clock::now() + std::chrono::seconds(request->retry_after);
+
+			if (retry_time > blocked_until)
+			{
+				blocked_until = retry_time;
+			}
+		}
+
+		std::string message = "server asked us to slow down (http " + std::to_string(request->http_code);
+
+		if (request->rate_limit_code.length() > 0)
+		{
+			message += ", " + request->rate_limit_code;
+		}
+
+		message += "), reducing request rate from " + std::to_string(previous_rate) + "/s to " + std::to_string(request_rate) + "/s";
+
+		if (request->retry_after > 0)
+		{
+			message += " and pausing all requests for " + std::to_string(request->retry_after) + "s";
+		}
+
+		DDL::Logger::LogEvent(message, DDLLogLevel::Warning);
+	}
+	else if (request->http_code == 200)
+	{
+		// Grow by roughly additive_increase for every second's worth of successful requests
+		request_rate = std::min(max_request_rate, request_rate + (additive_increase / request_rate));
+	}
+}
+
+double DDLRateLimiter::GetRequestRate()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(limiter_mutex);
+	return request_rate;
+}
+
+void DDLRateLimiter::SetEnabled(bool _enabled)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(limiter_mutex);
+	enabled = _enabled;
+}
+
+void DDLRateLimiter::refill_tokens()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	double elapsed_seconds = std::chrono::duration<double>(now - last_refill_time).count();
+
+	last_refill_time = now;
+
+	// Allow a small burst, but never more than one second's worth of requests
+	tokens = std::min(std::max(1.0, request_rate), tokens + (elapsed_seconds * request_rate));
+}
@@ -0,0 +1,495 @@
+#include "network.h"
+
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include "components/3rdparty/rapidjson/document.h"
+
+#include "components/3rdparty/curlpp/cURLpp.hpp"
+#include "components/3rdparty/curlpp/Easy.hpp"
+#include "components/3rdparty/curlpp/Multi.hpp"
+#include "components/3rdparty/curlpp/Options.hpp"
+#include "components/3rdparty/curlpp/Infos.hpp"
+
+#include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
+#include "components/diagnostics/trace/trace.h"
+
+DDLRequestQueue::DDLRequestQueue(int _max_concurrent_requests)
+{
+	max_concurrent_requests = _max_concurrent_requests;
+
+	if (max_concurrent_requests < 1)
+	{
+		max_concurrent_requests = 1;
+	}
+
+	multi = new curlpp::Multi();
+}
+
+DDLRequestQueue::~DDLRequestQueue()
+{
+	std::map<curlpp::Easy*, DDLNetworkRequest*>::iterator it;
+
+	for (it = active_requests.begin(); it != active_requests.end(); it++)
+	{
+		multi->remove(it->first);
+		close_output_file(it->second, false);
+		delete it->first;
+		delete it->second;
+	}
+
+	active_requests.clear();
+
+	for (DDLNetworkRequest* request : pending_requests)
+	{
+		delete request;
+	}
+
+	pending_requests.clear();
+
+	while (retry_requests.size() > 0)
+	{
+		delete retry_requests.top();
+		retry_requests.pop();
+	}
+
+	while (simulated_requests.size() > 0)
+	{
+		close_output_file(simulated_requests.top(), false);
+		delete simulated_requests.top();
+		simulated_requests.pop();
+	}
+
+	for (curlpp::Easy* handle : idle_handles)
+	{
+		delete handle;
+	}
+
+	idle_handles.clear();
+
+	delete multi;
+
+	update_queue_metrics();
+}
+
+void DDLRequestQueue::AddRequest(std::string url, std::function<void(DDLNetworkRequest*)> callback)
+{
+	DDLNetworkRequest* request = new DDLNetworkRequest();
+	request->url = url;
+	request->callback = callback;
+
+	pending_requests.push_back(request);
+}
+
+void DDLRequestQueue::AddDownload(std::string url, std::string output_path, std::function<void(DDLNetworkRequest*)> callback)
+{
+	DDLNetworkRequest* request = new DDLNetworkRequest();
+	request->url = url;
+	request->output_path = output_path;
+	request->callback = callback;
+
+	pending_requests.push_back(request);
+}
+
+void DDLRequestQueue::Run()
+{
+	while (pending_requests.size() > 0 || active_requests.size() > 0 || retry_requests.size() > 0 || simulated_requests.size() > 0)
+	{
+		schedule_due_retries();
+		start_pending_requests();
+		update_queue_metrics();
+
+		int running_handles = 0;
+		while (!multi->perform(&running_handles)) {}
+
+		process_finished_requests();
+		process_simulated_requests();
+
+		if (active_requests.size() > 0)
+		{
+			wait_for_activity();
+		}
+		else
+		{
+			wait_for_next_event();
+		}
+	}
+
+	update_queue_metrics();
+}
+
+int DDLRequestQueue::GetUnfinishedRequestCount()
+{
+	return pending_requests.size() + active_requests.size() + retry_requests.size() + simulated_requests.size();
+}
+
+void DDLRequestQueue::start_pending_requests()
+{
+	DDLRateLimiter* rate_limiter = DDL::Utils::Network::GetRateLimiter();
+	DDLResponseSource* response_source = DDL::Utils::Network::GetResponseSource();
+
+	while (active_requests.size() + simulated_requests.size() < max_concurrent_requests && pending_requests.size() > 0)
+	{
+		if (!rate_limiter->TryAcquire(&throttled_until))
+		{
+			break;
+		}
+
+		DDLNetworkRequest* request = pending_requests.front();
+		pending_requests.pop_front();
+
+		if (request->output_path != "" && fopen_s(&request->output_file, (request->output_path + DOWNLOAD_PARTIAL_FILE_SUFFIX).c_str(), "wb") != 0)
+		{
+			DDL::Logger::LogEvent("could not create '" + request->output_path + DOWNLOAD_PARTIAL_FILE_SUFFIX + "', file will not be downloaded",
+				DDLLogLevel::Error);
+
+			request->output_file = nullptr;
+			request->http_code = -1;
+
+			if (request->callback)
+			{
+				request->callback(request);
+			}
+
+			delete request;
+			continue;
+		}
+
+		request->received_bytes = 0;
+		request->start_time = std::chrono::steady_clock::now();
+
+		if (response_source)
+		{
+			start_simulated_request(request, response_source);
+			continue;
+		}
+
+		curlpp::Easy* handle = nullptr;
+
+		if (idle_handles.size() > 0)
+		{
+			handle = idle_handles.back();
+			idle_handles.pop_back();
+		}
+		else
+		{
+			handle = new curlpp::Easy();
+		}
+
+		DDL::Utils::Network::ApplyRequestOptions(handle, request->url);
+
+		handle->setOpt<curlpp::options::WriteFunction>([request, handle](char* data, size_t size, size_t count)
+		{
+			request->received_bytes += size * count;
+
+			// Error pages are kept in memory as usual, since they are small and rate limit responses need to be parsed
+			if (request->output_file && curlpp::Infos::ResponseCode::get(*handle) == 200)
+			{
+				if (fwrite(data, 1, size * count, request->output_file) != size * count)
+				{
+					// Returning a short count makes curl abort the transfer
+					request->output_failed = true;
+					return (size_t)0;
+				}
+
+				return size * count;
+			}
+
+			request->response.append(data, size * count);
+			return size * count;
+		});
+
+		handle->setOpt<curlpp::options::HeaderFunction>([request](char* data, size_t size, size_t count)
+		{
+			DDL::Utils::Network::ParseRateLimitHeader(request, std::string(data, size * count));
+			return size * count;
+		});
+
+		multi->add(handle);
+		active_requests.insert(std::pair<curlpp::Easy*, DDLNetworkRequest*>(handle, request));
+	}
+}
+
+void DDLRequestQueue::process_finished_requests()
+{
+	curlpp::Multi::Msgs messages = multi->info();
+
+	for (std::pair<const curlpp::Easy*, curlpp::Multi::Info> message : messages)
+	{
+		if (message.second.msg != CURLMSG_DONE)
+		{
+			continue;
+		}
+
+		curlpp::Easy* handle = (curlpp::Easy*)message.first;
+
+		if (!active_requests.contains(handle))
+		{
+			continue;
+		}
+
+		DDLNetworkRequest* request = active_requests.at(handle);
+
+		if (message.second.code == CURLE_OK)
+		{
+			request->http_code = curlpp::Infos::ResponseCode::get(*handle);
+			DDL::Utils::Network::RecordConnectionUsage(handle);
+		}
+		else
+		{
+			DDL::Logger::LogEvent("network request to '" + request->url + "' failed: " + std::string(curl_easy_strerror(message.second.code)),
+				DDLLogLevel::Warning);
+			request->http_code = -1;
+		}
+
+		multi->remove(handle);
+		active_requests.erase(handle);
+		idle_handles.push_back(handle);
+
+		finish_request(request);
+	}
+}
+
+void DDLRequestQueue::start_simulated_request(DDLNetworkRequest* request, DDLResponseSource* response_source)
+{
+	int latency_ms = (*response_source)(request);
+	request->received_bytes = request->response.length();
+
+	// Written out in one go, as the partial file is otherwise handled exactly like a streamed download
+	if (request->output_file && request->http_code == 200)
+	{
+		if (fwrite(request->response.data(), 1, request->response.length(), request->output_file) != request->response.length())
+		{
+			request->output_failed = true;
+		}
+
+		request->response.clear();
+	}
+
+	request->next_attempt_time = std::chrono::steady_clock::now() + std::chrono::milliseconds(latency_ms);
+	simulated_requests.push(request);
+}
+
+void DDLRequestQueue::process_simulated_requests()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	while (simulated_requests.size() > 0 && simulated_requests.top()->next_attempt_time <= now)
+	{
+		DDLNetworkRequest* request = simulated_requests.top();
+		simulated_requests.pop();
+
+		finish_request(request);
+	}
+}
+
+void DDLRequestQueue::finish_request(DDLNetworkRequest* request)
+{
+	if (request->output_path != "" && !close_output_file(request, request->http_code == 200))
+	{
+		// The file could not be saved even though the server sent it, which is treated like any other failed attempt
+		if (request->http_code == 200)
+		{
+			request->http_code = -1;
+		}
+	}
+
+	// Discourse also reports how long to wait in the body of a rate limit response
+	if (request->http_code == 429 && request->retry_after <= 0)
+	{
+		rapidjson::Document error_document = rapidjson::Document();
+		error_document.Parse(request->response.c_str());
+
+		if (!error_document.HasParseError() && error_document.IsObject() && error_document.HasMember("extras")
+			&& error_document["extras"].IsObject() && error_document["extras"].HasMember("wait_seconds")
+			&& error_document["extras"]["wait_seconds"].IsInt())
+		{
+			request->retry_after = error_document["extras"]["wait_seconds"].GetInt();
+		}
+	}
+
+	DDL::Utils::Network::GetRateLimiter()->OnResponse(request);
+	DDL::Utils::Network::RecordRequestStatistics(request);
+	DDL::Utils::Network::RecordRequestMetrics(request);
+
+	if (DDL::Trace::IsTracing())
+	{
+		DDL::Trace::RecordAsyncSpan("GET " + DDL::Utils::Network::GetRequestEndpoint(request->url), "http", request->start_time, {
+			{ "url", request->url },
+			{ "status", std::to_string(request->http_code) },
+			{ "bytes", std::to_string(request->received_bytes) },
+			{ "retries", std::to_string(request->retries) }
+		});
+	}
+
+	if (request->http_code != 200)
+	{
+		int retry_delay = 0;
+
+		if (DDL::Utils::Network::ShouldRetryRequest(request, &retry_delay))
+		{
+			static DDLMetricCounter* retry_counter = DDL::Metrics::GetCounter("ddl_http_retries_total", "The number of failed requests which were retried.");
+			retry_counter->Increment();
+
+			request->response.clear();
+			request->retry_after = -1;
+			request->rate_limit_code = "";
+			request->next_attempt_time = std::chrono::steady_clock::now() + std::chrono::seconds(retry_delay);
+
+			retry_requests.push(request);
+			return;
+		}
+	}
+
+	DDL::Utils::Network::RecordFixture(request);
+
+	if (request->callback)
+	{
+		request->callback(request);
+	}
+
+	delete request;
+}
+
+bool DDLRequestQueue::close_output_file(DDLNetworkRequest* request, bool keep)
+{
+	std::string partial_path = request->output_path + DOWNLOAD_PARTIAL_FILE_SUFFIX;
+	bool close_result = true;
+
+	if (request->output_file)
+	{
+		close_result = (fclose(request->output_file) == 0);
+		request->output_file = nullptr;
+	}
+
+	std::error_code error;
+
+	if (keep && close_result && !request->output_failed)
+	{
+		std::filesystem::rename(partial_path, request->output_path, error);
+
+		if (!error)
+		{
+			DDL::Utils::IO::RecordWrittenFile(request->received_bytes);
+			return true;
+		}
+
+		DDL::Logger::LogEvent("could not move downloaded file into place at '" + request->output_path + "': " + error.message(), DDLLogLevel::Error);
+	}
+	else if (keep)
+	{
+		DDL::Logger::LogEvent("could not write downloaded file '" + partial_path + "', file will not be saved", DDLLogLevel::Error);
+	}
+
+	std::filesystem::remove(partial_path, error);
+	request->output_failed = false;
+
+	return false;
+}
+
+void DDLRequestQueue::schedule_due_retries()
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	while (retry_requests.size() > 0 && retry_requests.top()->next_attempt_time <= now)
+	{
+		pending_requests.push_front(retry_requests.top());
+		retry_requests.pop();
+	}
+}
+
+std::chrono::steady_clock::time_point DDLRequestQueue::get_next_event_time()
+{
+	std::chrono::steady_clock::time_point event_time = std::chrono::steady_clock::time_point::max();
+
+	// Pending requests with room to start are only left waiting when the rate limiter is holding them back
+	if (pending_requests.size() > 0 && active_requests.size() + simulated_requests.size() < max_concurrent_requests)
+	{
+		event_time = throttled_until;
+	}
+
+	if (retry_requests.size() > 0 && retry_requests.top()->next_attempt_time < event_time)
+	{
+		event_time = retry_requests.top()->next_attempt_time;
+	}
+
+	if (simulated_requests.size() > 0 && simulated_requests.top()->next_attempt_time < event_time)
+	{
+		event_time = simulated_requests.top()->next_attempt_time;
+	}
+
+	return event_time;
+}
+
+void DDLRequestQueue::wait_for_next_event()
+{
+	std::chrono::steady_clock::time_point wake_time = get_next_event_time();
+
+	if (wake_time != std::chrono::steady_clock::time_point::max())
+	{
+		std::this_thread::sleep_until(wake_time);
+	}
+}
+
+void DDLRequestQueue::wait_for_activity()
+{
+	long curl_timeout_ms = -1;
+	multi->timeout(&curl_timeout_ms);
+
+	// curl reports -1 when it has no timers of its own running, leaving the sockets to wake us
+	int timeout_ms = (curl_timeout_ms < 0) ? REQUEST_QUEUE_MAX_WAIT_MS : (int)std::min<long>(curl_timeout_ms, REQUEST_QUEUE_MAX_WAIT_MS);
+
+	std::chrono::steady_clock::time_point event_time = get_next_event_time();
+
+	if (event_time != std::chrono::steady_clock::time_point::max())
+	{
+		// Rounded up, so that the retry or rate limiter is due by the time the wait ends
+		std::chrono::steady_clock::duration until_event = event_time - std::chrono::steady_clock::now();
+		int64_t event_timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(until_event).count();
+
+		timeout_ms = (int)std::clamp<int64_t>(event_timeout_ms, 0, timeout_ms);
+	}
+
+	if (timeout_ms == 0)
+	{
+		return;
+	}
+
+	// Unlike select, this also waits out the timeout when curl has no sockets yet (ie, while resolving a hostname)
+	int ready_count = 0;
+	multi->poll(timeout_ms, &ready_count);
+}
+
+void DDLRequestQueue::update_queue_metrics()
+{
+	static DDLMetricGauge* pending_gauge = DDL::Metrics::GetGauge("ddl_request_queue_depth", "The number of requests in each state across every request queue.",
+		DDL::Metrics::FormatLabel("state", "pending"));
+	static DDLMetricGauge* active_gauge = DDL::Metrics::GetGauge("ddl_request_queue_depth", "The number of requests in each state across every request queue.",
+		DDL::Metrics::FormatLabel("state", "active"));
+	static DDLMetricGauge* retry_gauge = DDL::Metrics::GetGauge("ddl_request_queue_depth", "The number of requests in each state across every request queue.",
+		DDL::Metrics::FormatLabel("state", "retrying"));
+
+	int pending_count = pending_requests.size();
+	int active_count = active_requests.size() + simulated_requests.size();
+	int retry_count = retry_requests.size();
+
+	if (pending_count != reported_pending_requests)
+	{
+		pending_gauge->Add(pending_count - reported_pending_requests);
+		reported_pending_requests = pending_count;
+	}
+
+	if (active_count != reported_active_requests)
+	{
+		active_gauge->Add(active_count - reported_active_requests);
+		reported_active_requests = active_count;
+	}
+
+	if (retry_count != reported_retry_requests)
+	{
+		retry_gauge->Add(retry_count - reported_retry_requests);
+		reported_retry_requests = retry_count;
+	}
+}
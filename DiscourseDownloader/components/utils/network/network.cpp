@@ -1,22 +1,119 @@
 #include "network.h"
 
 #include <sstream>
+#include <mutex>
+#include <atomic>
+#include <memory>
 
 #include "components/3rdparty/curlpp/cURLpp.hpp"
 #include "components/3rdparty/curlpp/Easy.hpp"
 #include "components/3rdparty/curlpp/Options.hpp"
 #include "components/3rdparty/curlpp/Infos.hpp"
 
+#include "components/3rdparty/rapidjson/document.h"
+
 #include "components/settings/settings.h"
+#include "components/utils/converters/converters.h"
 #include "components/utils/string/string.h"
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
 #include "main.h"
 
+CURLSH* shared_cache = nullptr;
+std::once_flag shared_cache_init_flag;
+std::mutex shared_cache_locks[CURL_LOCK_DATA_LAST];
+
+DDLRateLimiter rate_limiter = DDLRateLimiter();
+std::once_flag rate_limiter_init_flag;
+
+std::atomic<int> reused_connection_count = 0;
+std::atomic<int> new_connection_count = 0;
+
+DDLResponseSource response_source = nullptr;
+
+bool request_statistics_enabled = false;
+DDLRequestStatistics request_statistics = DDLRequestStatistics();
+std::mutex request_statistics_mutex;
+
+DDLFixtureArchive fixture_archive;
+bool fixture_recording_enabled = false;
+bool fixture_replay_enabled = false;
+
+thread_local std::unique_ptr<curlpp::Easy> thread_request_handle = nullptr;
+thread_local std::unique_ptr<DDLRequestQueue> thread_request_queue = nullptr;
+
+void lock_shared_cache(CURL* handle, curl_lock_data data, curl_lock_access access, void* user_data)
+{
+	shared_cache_locks[data].lock();
+}
+
+void unlock_shared_cache(CURL* handle, curl_lock_data data, void* user_data)
+{
+	shared_cache_locks[data].unlock();
+}
+
 std::string DDL::Utils::Network::PerformHTTPRequestWithRetries(std::string url, int* http_code)
 {
+	std::string response = "";
+	int response_code = -1;
+
+	// The queue is kept around for the lifetime of the thread, so that its connections can be reused
+	if (!thread_request_queue)
+	{
+		thread_request_queue = std::make_unique<DDLRequestQueue>(1);
+	}
+
+	thread_request_queue->AddRequest(url, [&](DDLNetworkRequest* request)
+	{
+		response = request->response;
+		response_code = request->http_code;
+	});
+
+	thread_request_queue->Run();
+
+	if (http_code)
+	{
+		*http_code = response_code;
+	}
+
+	return response;
+}
+
+bool DDL::Utils::Network::DownloadFileWithRetries(std::string url, std::string output_path, int* http_code)
+{
+	int response_code = -1;
+
+	if (!thread_request_queue)
+	{
+		thread_request_queue = std::make_unique<DDLRequestQueue>(1);
+	}
+
+	thread_request_queue->AddDownload(url, output_path, [&](DDLNetworkRequest* request)
+	{
+		response_code = request->http_code;
+	});
+
+	thread_request_queue->Run();
+
+	if (http_code)
+	{
+		*http_code = response_code;
+	}
+
+	return response_code == 200;
+}
+
+bool DDL::Utils::Network::ShouldRetryRequest(DDLNetworkRequest* request, int* retry_delay)
+{
+	// Only the final response of each request is recorded, so another attempt would just get the same response again
+	if (fixture_replay_enabled)
+	{
+		return false;
+	}
+
 	bool retry_backoff = true;
 	int backoff_increment = 5;
-	int retry_delay = 1;
+	int request_retry_delay = 1;
 	int max_retries = 60;
 	bool fail_on_403 = true;
 	bool fail_on_404 = false;
@@ -27,7 +124,7 @@ std::string DDL::Utils::Network::PerformHTTPRequestWithRetries(std::string url,
 		if (config)
 		{
 			max_retries = config->max_http_retries;
-			retry_delay = config->request_retry_delay;
+			request_retry_delay = config->request_retry_delay;
 			retry_backoff = config->http_retry_use_backoff;
 			backoff_increment = config->http_backoff_increment;
 			fail_on_403 = config->fail_on_403;
@@ -36,67 +133,55 @@ std::string DDL::Utils::Network::PerformHTTPRequestWithRetries(std::string url,
 		}
 	}
 
-	std::string response = DDL::Utils::Network::PerformHTTPRequest(url, http_code);
-
-	// If we get an invalid response, retry as many times as specified in config or until a successful response
+	if (fail_on_403 && request->http_code == 403)
 	{
-		int retries = 0;
-		int next_retry_backoff_delay = retry_delay;
-		int remaining_404s = max_404s;
+		DDL::Logger::LogEvent("stopping further network connection attempts due to http 403 - if you want, you "
+			"can disable this in website.cfg but this could result in a permanent soft-lock of the application", DDLLogLevel::Error);
+		return false;
+	}
 
-		while (*http_code != 200)
+	if (request->http_code == 404)
+	{
+		if (fail_on_404)
 		{
-			if (fail_on_403 && *http_code == 403)
-			{
-				DDL::Logger::LogEvent("stopping further network connection attempts due to http 403 - if you want, you "
-					"can disable this in website.cfg but this could result in a permanent soft-lock of the application", DDLLogLevel::Error);
-				break;
-			}
-
-			if (*http_code == 404)
-			{
-				if (fail_on_404)
-				{
-					DDL::Logger::LogEvent("stopping further network connection attempts due to http 404 - if you want, you "
-						"can disable this in website.cfg but this could result in a permanent soft-lock of the application", DDLLogLevel::Error);
-					break;
-				}
-
-				if (remaining_404s <= 0 && max_404s != -1)
-				{
-					DDL::Logger::LogEvent("stopping further retries due to reaching maximum 404 count () - if you want, you"
-						"can increase this amount or set it to -1 to disable this limit in website.cfg", DDLLogLevel::Error);
-					break;
-				}
-
-				remaining_404s--;
-			}
+			DDL::Logger::LogEvent("stopping further network connection attempts due to http 404 - if you want, you "
+				"can disable this in website.cfg but this could result in a permanent soft-lock of the application", DDLLogLevel::Error);
+			return false;
+		}
 
-			
+		if (request->received_404s >= max_404s && max_404s != -1)
+		{
+			DDL::Logger::LogEvent("stopping further retries due to reaching maximum 404 count (" + std::to_string(max_404s) + ") - if you want, you "
+				"can increase this amount or set it to -1 to disable this limit in website.cfg", DDLLogLevel::Error);
+			return false;
+		}
 
-			if (retry_backoff)
-			{
-				next_retry_backoff_delay = backoff_increment * (retries + 1);
-			}
+		request->received_404s++;
+	}
 
-			DDL::Logger::LogEvent("network request returned http " + std::to_string(*http_code)
-				+ ", retrying in " + std::to_string(next_retry_backoff_delay) + "s (" + std::to_string(retries) + "/" + std::to_string(max_retries) + ")", DDLLogLevel::Warning);
+	if (request->retries >= max_retries && max_retries != -1)
+	{
+		DDL::Logger::LogEvent("retry limit reached - returning failed response", DDLLogLevel::Warning);
+		return false;
+	}
 
-			Sleep(1000 * next_retry_backoff_delay);
+	*retry_delay = request_retry_delay;
 
-			// warn about retrying
-			response = DDL::Utils::Network::PerformHTTPRequest(url, http_code);
-			retries++;
+	if (retry_backoff)
+	{
+		*retry_delay = backoff_increment * (request->retries + 1);
+	}
 
-			if (retries >= max_retries && max_retries != -1)
-			{
-				DDL::Logger::LogEvent("retry limit reached - returning failed response", DDLLogLevel::Warning);
-				break;
-			}
-		}
+	if (request->retry_after > *retry_delay)
+	{
+		*retry_delay = request->retry_after;
 	}
 
-	return response;
+	DDL::Logger::LogEvent("network request returned http " + std::to_string(request->http_code)
+		+ ", retrying in " + std::to_string(*retry_delay) + "s (" + std::to_string(request->retries) + "/" + std::to_string(max_retries) + ")", DDLLogLevel::Warning);
+
+	request->retries++;
+	return true;
 }
 
 std::string DDL::Utils::Network::PerformHTTPRequest(std::string url, int* http_code)
@@ -109,31 +194,16 @@ std::string DDL::Utils::Network::PerformHTTPRequest(std::string url, float backo
 	std::string response = "";
 	std::stringstream response_stream = std::stringstream();
 
-	curlpp::Easy request = curlpp::Easy();
+	// Each thread keeps its own handle alive between requests, so that curl can reuse the existing connection
+	if (!thread_request_handle)
 	{
-		request.setOpt<cURLpp::Options::WriteStream>(&response_stream);
-		request.setOpt<curlpp::options::Url>(url);
-
-		WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+		thread_request_handle = std::make_unique<curlpp::Easy>();
+	}
 
-		if (!config)
-		{
-			request.setOpt<curlpp::options::UserAgent>("DiscourseDL v" + std::string(DISCOURSEDL_VERSION));
-		}
-		else
-		{
-			if (config->override_user_agent)
-			{
-				request.setOpt<curlpp::options::UserAgent>(config->user_agent);
-			}
-			else
-			{
-				request.setOpt<curlpp::options::UserAgent>("DiscourseDL v" + std::string(DISCOURSEDL_VERSION));
-			}
-		}
-		
-		request.setOpt<curlpp::options::SslVerifyPeer>(false);
-		request.setOpt<curlpp::options::FollowLocation>(true);
+	curlpp::Easy& request = *thread_request_handle;
+	{
+		request.setOpt<cURLpp::Options::WriteStream>(&response_stream);
+		DDL::Utils::Network::ApplyRequestOptions(&request, url);
 	}
 
 	float next_attempt_delay = 0.0f;
@@ -151,6 +221,7 @@ std::string DDL::Utils::Network::PerformHTTPRequest(std::string url, float backo
 			request.perform();
 
 			int code = curlpp::Infos::ResponseCode::get(request);
+			DDL::Utils::Network::RecordConnectionUsage(&request);
 
 			response = response_stream.str();
 
@@ -198,4 +269,301 @@ std::string DDL::Utils::Network::PerformHTTPRequest(std::string url, float backo
 	}
 
 	return response;
+}
+
+void DDL::Utils::Network::ApplyRequestOptions(curlpp::Easy* request, std::string url)
+{
+	request->setOpt<curlpp::options::Url>(url);
+
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config)
+	{
+		request->setOpt<curlpp::options::UserAgent>("DiscourseDL v" + std::string(DISCOURSEDL_VERSION));
+	}
+	else
+	{
+		if (config->override_user_agent)
+		{
+			request->setOpt<curlpp::options::UserAgent>(config->user_agent);
+		}
+		else
+		{
+			request->setOpt<curlpp::options::UserAgent>("DiscourseDL v" + std::string(DISCOURSEDL_VERSION));
+		}
+	}
+
+	request->setOpt<curlpp::options::SslVerifyPeer>(false);
+	request->setOpt<curlpp::options::FollowLocation>(true);
+
+	curl_easy_setopt(request->getHandle(), CURLOPT_TCP_KEEPALIVE, 1L);
+	curl_easy_setopt(request->getHandle(), CURLOPT_SHARE, DDL::Utils::Network::GetSharedCache());
+}
+
+int DDL::Utils::Network::GetMaxConcurrentRequests()
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+
+	if (!config || config->max_concurrent_requests < 1)
+	{
+		return 1;
+	}
+
+	return config->max_concurrent_requests;
+}
+
+CURLSH* DDL::Utils::Network::GetSharedCache()
+{
+	std::call_once(shared_cache_init_flag, []()
+	{
+		shared_cache = curl_share_init();
+
+		curl_share_setopt(shared_cache, CURLSHOPT_LOCKFUNC, lock_shared_cache);
+		curl_share_setopt(shared_cache, CURLSHOPT_UNLOCKFUNC, unlock_shared_cache);
+		curl_share_setopt(shared_cache, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(shared_cache, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+	});
+
+	return shared_cache;
+}
+
+DDLRateLimiter* DDL::Utils::Network::GetRateLimiter()
+{
+	std::call_once(rate_limiter_init_flag, []()
+	{
+		rate_limiter.Configure();
+	});
+
+	return &rate_limiter;
+}
+
+void DDL::Utils::Network::ParseRateLimitHeader(DDLNetworkRequest* request, std::string header)
+{
+	size_t separator = header.find(':');
+
+	if (separator == std::string::npos)
+	{
+		return;
+	}
+
+	std::string name = DDL::Utils::String::ToLower(header.substr(0, separator));
+	std::string value = header.substr(separator + 1);
+	{
+		value.erase(0, value.find_first_not_of(" \t"));
+		value.erase(value.find_last_not_of(" \t\r\n") + 1);
+	}
+
+	// Retry-After may also be given as an HTTP date, which Discourse does not use - only seconds are handled
+	if (name == "retry-after")
+	{
+		if (DDL::Converters::IsStringInt(value))
+		{
+			request->retry_after = DDL::Converters::StringToInt(value);
+		}
+	}
+	else if (name == "discourse-rate-limit-error-code")
+	{
+		request->rate_limit_code = value;
+	}
+}
+
+void DDL::Utils::Network::RecordConnectionUsage(curlpp::Easy* request)
+{
+	long connects = 0;
+	curl_easy_getinfo(request->getHandle(), CURLINFO_NUM_CONNECTS, &connects);
+
+	if (connects > 0)
+	{
+		new_connection_count += connects;
+	}
+	else
+	{
+		reused_connection_count++;
+	}
+}
+
+void DDL::Utils::Network::LogConnectionStatistics()
+{
+	int reused = reused_connection_count;
+	int created = new_connection_count;
+	int total = reused + created;
+
+	if (total == 0)
+	{
+		return;
+	}
+
+	DDL::Logger::LogEvent("network connection statistics: " + std::to_string(reused) + " requests reused an existing connection, "
+		+ std::to_string(created) + " new connections were opened (" + std::to_string((reused * 100) / total) + "% reused)");
+}
+
+void DDL::Utils::Network::SetResponseSource(DDLResponseSource source)
+{
+	response_source = source;
+}
+
+DDLResponseSource* DDL::Utils::Network::GetResponseSource()
+{
+	return response_source ? &response_source : nullptr;
+}
+
+void DDL::Utils::Network::EnableRequestStatistics()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(request_statistics_mutex);
+	request_statistics_enabled = true;
+}
+
+void DDL::Utils::Network::RecordRequestStatistics(DDLNetworkRequest* request)
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(request_statistics_mutex);
+
+	if (!request_statistics_enabled)
+	{
+		return;
+	}
+
+	request_statistics.request_count++;
+	request_statistics.received_bytes += request->received_bytes;
+	request_statistics.latencies_ms.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - request->start_time).count());
+
+	if (request->http_code != 200)
+	{
+		request_statistics.error_count++;
+	}
+}
+
+DDLRequestStatistics DDL::Utils::Network::GetRequestStatistics()
+{
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(request_statistics_mutex);
+	return request_statistics;
+}
+
+/**
+* Retrieves the host of a URL, ie `forums.example.com`.
+*/
+std::string_view get_url_host(std::string_view url)
+{
+	size_t scheme_end = url.find("://");
+
+	if (scheme_end != std::string_view::npos)
+	{
+		url.remove_prefix(scheme_end + 3);
+	}
+
+	return url.substr(0, url.find_first_of("/?#"));
+}
+
+std::string DDL::Utils::Network::GetRequestEndpoint(std::string url)
+{
+	WebsiteConfig* config = DDL::Settings::GetSiteConfig();
+	std::string_view host = get_url_host(url);
+
+	if (!config || host != get_url_host(config->website_url))
+	{
+		return "external";
+	}
+
+	std::string_view path = std::string_view(url);
+	path.remove_prefix((host.data() + host.length()) - url.data());
+	path = path.substr(0, path.find_first_of("?#"));
+
+	if (path.starts_with("/"))
+	{
+		path.remove_prefix(1);
+	}
+
+	std::string_view segment = path.substr(0, path.find('/'));
+
+	if (segment.ends_with(".json"))
+	{
+		segment.remove_suffix(5);
+	}
+
+	return "/" + std::string(segment);
+}
+
+void DDL::Utils::Network::RecordRequestMetrics(DDLNetworkRequest* request)
+{
+	std::string endpoint_label = DDL::Metrics::FormatLabel("endpoint", GetRequestEndpoint(request->url));
+	std::string status_label = DDL::Metrics::FormatLabel("status", (request->http_code > 0) ? std::to_string(request->http_code) : "error");
+
+	DDL::Metrics::GetCounter("ddl_http_requests_total", "The number of request attempts, by endpoint and http status.",
+		endpoint_label + "," + status_label)->Increment();
+
+	DDL::Metrics::GetHistogram("ddl_http_request_duration_seconds", "The time taken by each request attempt, by endpoint.", endpoint_label)
+		->Record(std::chrono::duration<double>(std::chrono::steady_clock::now() - request->start_time).count());
+
+	static DDLMetricCounter* received_bytes = DDL::Metrics::GetCounter("ddl_http_received_bytes_total", "The total size of every response received.");
+	received_bytes->Increment(request->received_bytes);
+}
+
+bool DDL::Utils::Network::StartFixtureRecording(std::string path)
+{
+	if (!fixture_archive.OpenForRecording(path))
+	{
+		return false;
+	}
+
+	DDL::Logger::LogEvent("recording every response into fixture archive '" + path + "'");
+
+	fixture_recording_enabled = true;
+	return true;
+}
+
+bool DDL::Utils::Network::StartFixtureReplay(std::string path)
+{
+	if (!fixture_archive.OpenForReplay(path))
+	{
+		return false;
+	}
+
+	SetResponseSource([](DDLNetworkRequest* request)
+	{
+		return fixture_archive.Replay(request);
+	});
+
+	// Responses are served from disk, so there is no server to be polite to
+	GetRateLimiter()->SetEnabled(false);
+
+	fixture_replay_enabled = true;
+	return true;
+}
+
+bool DDL::Utils::Network::IsReplayingFixtures()
+{
+	return fixture_replay_enabled;
+}
+
+void DDL::Utils::Network::RecordFixture(DDLNetworkRequest* request)
+{
+	if (!fixture_recording_enabled)
+	{
+		return;
+	}
+
+	fixture_archive.Record(request);
+}
+
+void DDL::Utils::Network::Cleanup()
+{
+	thread_request_handle.reset();
+	thread_request_queue.reset();
+
+	if (fixture_recording_enabled || fixture_replay_enabled)
+	{
+		if (fixture_replay_enabled)
+		{
+			SetResponseSource(nullptr);
+		}
+
+		fixture_archive.Close();
+		fixture_recording_enabled = false;
+		fixture_replay_enabled = false;
+	}
+
+	if (shared_cache)
+	{
+		curl_share_cleanup(shared_cache);
+		shared_cache = nullptr;
+	}
 }
\ No newline at end of file
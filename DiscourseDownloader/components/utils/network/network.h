@@ -1,25 +1,590 @@
 #pragma once
 
 #include <string>
+#include <deque>
+#include <map>
+#include <functional>
+#include <vector>
+#include <queue>
+#include <chrono>
+#include <mutex>
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+#include <unordered_map>
+
+#include <curl/curl.h>
+
+#include "components/utils/io/io.h"
 
 #define BACKOFF_FACTOR_MAX 60.0f
+#define DOWNLOAD_PARTIAL_FILE_SUFFIX std::string(".part") //!< Suffix of the temporary file a download is written to until it finishes.
+#define FIXTURE_RECORD_MAGIC 0x52464444 //!< Magic number at the start of every record in a fixture archive ("DDFR").
+#define FIXTURE_ARCHIVE_DEFAULT_FILENAME std::string("fixtures.ddlf")
+#define REQUEST_QUEUE_MAX_WAIT_MS 1000 //!< Longest a request queue waits on its transfers when neither curl nor the queue has a deadline.
+
+namespace curlpp
+{
+	class Easy;
+	class Multi;
+}
+
+/**
+* Structure representing a single HTTP request queued in a DDLRequestQueue.
+*/
+struct DDLNetworkRequest
+{
+	std::string url = "";      //!< The URL to send the request to.
+	std::string response = ""; //!< The response text. Only valid once the request has finished.
+	int http_code = -1;        //!< The HTTP response code, or -1 if the request failed before a response was received.
+	int retries = 0;           //!< The number of times this request has been retried.
+	int received_404s = 0;     //!< The number of times this request has returned http 404.
+	int retry_after = -1;      //!< The number of seconds the server asked us to wait before retrying, or -1 if not specified.
+	std::string rate_limit_code = ""; //!< The Discourse rate limit error code returned by the server, if any.
+
+	std::string output_path = ""; //!< If set, a successful response is written straight to this file rather than into #response.
+	FILE* output_file = nullptr;  //!< The partial file that the response is being written to, while the request is in flight.
+	bool output_failed = false;   //!< Set if the response could not be written to the partial file.
+	int64_t received_bytes = 0;   //!< The number of response bytes received by the latest attempt, including any written to the partial file.
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::time_point(); //!< The time the latest attempt was started.
+	std::chrono::steady_clock::time_point next_attempt_time = std::chrono::steady_clock::time_point(); //!< The earliest time the request may be retried, or the time a simulated response arrives.
+	std::function<void(DDLNetworkRequest*)> callback = nullptr; //!< Function to call once the request has finished.
+};
+
+/**
+* Function which answers requests in place of the network, such as the synthetic forum used by `-benchmark`. It should set
+* the request's http code and response (along with any rate limit information), and return the number of milliseconds the
+* response should take to arrive.
+*/
+typedef std::function<int(DDLNetworkRequest*)> DDLResponseSource;
+
+/**
+* Structure holding the outcome of every request attempt, collected once enabled with
+* DDL::Utils::Network::EnableRequestStatistics.
+*/
+struct DDLRequestStatistics
+{
+	int64_t request_count = 0;  //!< The number of finished attempts, including any which were retried afterwards.
+	int64_t error_count = 0;    //!< The number of attempts which did not end with http 200.
+	int64_t received_bytes = 0; //!< The total size of every response received.
+	std::vector<float> latencies_ms = std::vector<float>(); //!< The time each attempt took from being started to finishing.
+};
+
+#pragma pack(push, 1)
+
+/**
+* Header written before every response in a fixture archive, followed by the request URL and then the response body.
+*/
+struct DDLFixtureRecordHeader
+{
+	uint32_t magic = FIXTURE_RECORD_MAGIC; //!< Always #FIXTURE_RECORD_MAGIC.
+	int32_t http_code = -1;   //!< The HTTP response code.
+	uint32_t url_length = 0;  //!< The length of the request URL.
+	uint32_t body_length = 0; //!< The length of the response body.
+};
+
+#pragma pack(pop)
+
+/**
+* Comparator used to order requests awaiting a retry, such that the request with the earliest retry time is
+* at the top of the retry queue.
+*/
+struct DDLNetworkRequestRetryOrder
+{
+	bool operator()(DDLNetworkRequest* a, DDLNetworkRequest* b)
+	{
+		return a->next_attempt_time > b->next_attempt_time;
+	}
+};
+
+/**
+* Class representing a token bucket rate limiter, shared by all requests.
+*
+* Each request consumes one token, and tokens are refilled at the current request rate. The rate adapts to the
+* server using AIMD - it is increased slightly after each successful request, and cut down sharply whenever the
+* server responds with http 429 or 503. If the server specifies how long to wait (using `Retry-After` or the
+* `wait_seconds` field in a Discourse rate limit response), all requests are held back until that time passes.
+*/
+class DDLRateLimiter
+{
+private:
+	std::mutex limiter_mutex;
+
+	double tokens = 1.0;          //!< The number of requests that may currently be started.
+	double request_rate = 4.0;    //!< The current number of requests allowed per second.
+	double min_request_rate = 0.5; //!< The lowest the request rate may be reduced to.
+	double max_request_rate = 50.0; //!< The highest the request rate may be increased to.
+	double additive_increase = 0.5; //!< How much the request rate grows over one second of successful requests.
+	double multiplicative_decrease = 0.5; //!< Factor applied to the request rate when the server asks us to slow down.
+	bool enabled = true; //!< Whether or not requests should be limited at all.
+
+	std::chrono::steady_clock::time_point last_refill_time = std::chrono::steady_clock::now(); //!< The last time tokens were refilled.
+	std::chrono::steady_clock::time_point blocked_until = std::chrono::steady_clock::time_point(); //!< No requests may start before this time.
+
+	/**
+	* Adds any tokens earned since the last refill. The limiter mutex must be held when calling this.
+	*/
+	void refill_tokens();
+
+public:
+	/**
+	* Loads the rate limiter settings from website.cfg.
+	*/
+	void Configure();
+
+	/**
+	* Attempts to take a token for a new request, without blocking.
+	*
+	* @param next_available - Pointer to a time point, which will be set to the earliest time another attempt
+	*     may succeed if no token is currently available.
+	*
+	* @returns `true` if the request may be started now, otherwise returns `false`.
+	*/
+	bool TryAcquire(std::chrono::steady_clock::time_point* next_available);
+
+	/**
+	* Updates the request rate based on the result of a finished request.
+	*
+	* @param request - The finished request.
+	*/
+	void OnResponse(DDLNetworkRequest* request);
+
+	/**
+	* Retrieves the current request rate.
+	*
+	* @returns The number of requests currently allowed per second.
+	*/
+	double GetRequestRate();
+
+	/**
+	* Enables or disables the rate limiter, overriding the `enable_rate_limiter` setting.
+	*
+	* @param _enabled - Whether or not requests should be limited.
+	*/
+	void SetEnabled(bool _enabled);
+};
+
+/**
+* Class representing a fixture archive, which holds the responses to every request made during a crawl so that the crawl
+* can be replayed later without the network.
+*
+* While recording, the final response to each request (after any retries) is appended to the archive along with its URL
+* and http code. Downloads are recorded from the saved file. While replaying, the archive is memory-mapped and indexed by
+* URL. If a URL was requested more than once while recording, its responses are replayed in the order they were recorded,
+* with the last one repeated once they run out.
+*/
+class DDLFixtureArchive
+{
+private:
+	/**
+	* Structure holding the recorded responses for a single URL.
+	*/
+	struct fixture_entry
+	{
+		std::vector<const DDLFixtureRecordHeader*> responses = std::vector<const DDLFixtureRecordHeader*>(); //!< The responses, in the order they were recorded.
+		size_t next_response = 0; //!< The index of the response to replay next.
+	};
+
+	std::mutex archive_mutex;
+
+	std::ofstream record_stream; //!< Output stream for the archive, while recording.
+	DDLMappedFile replay_file;   //!< The mapped archive, while replaying.
+	std::unordered_map<std::string_view, fixture_entry> fixtures = std::unordered_map<std::string_view, fixture_entry>(); //!< Recorded responses keyed by URL, pointing into the mapped archive.
+
+	int64_t recorded_count = 0; //!< The number of responses recorded.
+	int64_t replayed_count = 0; //!< The number of requests answered from the archive.
+	int64_t missing_count = 0;  //!< The number of requests with no recorded response.
+
+public:
+	DDLFixtureArchive() = default;
+	DDLFixtureArchive(const DDLFixtureArchive&) = delete;
+	DDLFixtureArchive& operator=(const DDLFixtureArchive&) = delete;
+
+	~DDLFixtureArchive();
+
+	/**
+	* Creates a new archive to record responses into, replacing any existing archive at the path.
+	*
+	* @param path - The path to the archive.
+	*
+	* @returns `true` if the archive was created, otherwise returns `false`.
+	*/
+	bool OpenForRecording(std::string path);
+
+	/**
+	* Maps an existing archive and indexes its responses for replay. If the recording was interrupted, any incomplete
+	* response at the end of the archive is ignored.
+	*
+	* @param path - The path to the archive.
+	*
+	* @returns `true` if the archive was opened, otherwise returns `false`.
+	*/
+	bool OpenForReplay(std::string path);
+
+	/**
+	* Closes the archive, logging the number of responses recorded or replayed.
+	*/
+	void Close();
+
+	/**
+	* Appends the final response of a request to the archive.
+	*
+	* @param request - The finished request.
+	*
+	* @returns `true` if the response was recorded, otherwise returns `false`.
+	*/
+	bool Record(DDLNetworkRequest* request);
+
+	/**
+	* Answers a request from the archive. Intended to be used as the network layer's response source. Requests with no
+	* recorded response fail as though the network was unavailable.
+	*
+	* @param request - The request to answer.
+	*
+	* @returns The number of milliseconds the response should take to arrive, which is always 0.
+	*/
+	int Replay(DDLNetworkRequest* request);
+};
+
+/**
+* Class representing a queue of HTTP requests, which are performed concurrently using a curl multi handle.
+*
+* Requests are added with #AddRequest and performed once #Run is called. Callbacks are always invoked on the
+* thread that called #Run, one at a time, so they may freely add further requests to the queue without any
+* additional synchronization.
+*
+* Failed requests are retried according to the retry settings in website.cfg. Rather than blocking, a request
+* waiting to be retried is parked in a queue ordered by its next attempt time, so that other requests continue
+* to be performed in the meantime.
+*/
+class DDLRequestQueue
+{
+private:
+	curlpp::Multi* multi = nullptr; //!< The curl multi handle used to perform requests.
+	std::deque<DDLNetworkRequest*> pending_requests = std::deque<DDLNetworkRequest*>(); //!< Requests which have not yet been started.
+	std::map<curlpp::Easy*, DDLNetworkRequest*> active_requests = std::map<curlpp::Easy*, DDLNetworkRequest*>(); //!< Requests currently in flight.
+	std::vector<curlpp::Easy*> idle_handles = std::vector<curlpp::Easy*>(); //!< Finished handles, kept around so their connections can be reused.
+	std::priority_queue<DDLNetworkRequest*, std::vector<DDLNetworkRequest*>, DDLNetworkRequestRetryOrder> retry_requests; //!< Failed requests waiting for their next attempt.
+	std::priority_queue<DDLNetworkRequest*, std::vector<DDLNetworkRequest*>, DDLNetworkRequestRetryOrder> simulated_requests; //!< Requests answered by the response source, waiting for their response to arrive.
+	int max_concurrent_requests = 1; //!< The maximum number of requests that may be in flight at once.
+	std::chrono::steady_clock::time_point throttled_until = std::chrono::steady_clock::time_point(); //!< Set when the rate limiter holds back pending requests.
+
+	int reported_pending_requests = 0; //!< The number of pending requests last added to the queue depth metrics.
+	int reported_active_requests = 0;  //!< The number of in-flight requests last added to the queue depth metrics.
+	int reported_retry_requests = 0;   //!< The number of requests awaiting a retry last added to the queue depth metrics.
+
+	/**
+	* Starts as many pending requests as the concurrency limit allows.
+	*/
+	void start_pending_requests();
+
+	/**
+	* Collects any finished transfers from the multi handle and invokes their callbacks.
+	*/
+	void process_finished_requests();
+
+	/**
+	* Answers a request using the response source rather than the network. The request is held back until its
+	* simulated response arrives, and counts towards the concurrency limit until then.
+	*
+	* @param request - The request to answer.
+	* @param response_source - The response source to answer it with.
+	*/
+	void start_simulated_request(DDLNetworkRequest* request, DDLResponseSource* response_source);
+
+	/**
+	* Finishes any requests whose simulated response has arrived.
+	*/
+	void process_simulated_requests();
+
+	/**
+	* Handles a request which has received its response, either retrying it or invoking its callback.
+	*
+	* @param request - The request. Deleted unless it is going to be retried.
+	*/
+	void finish_request(DDLNetworkRequest* request);
+
+	/**
+	* Waits until there is activity on any in-flight transfer, or until curl, a retry or the rate limiter next needs
+	* attention, whichever comes first.
+	*/
+	void wait_for_activity();
+
+	/**
+	* Closes the partial file of a download, and either moves it into place or removes it.
+	*
+	* @param request - The download.
+	* @param keep - Whether or not the download succeeded, and the file should be kept.
+	*
+	* @returns `true` if the file was kept and moved into place, otherwise returns `false`.
+	*/
+	bool close_output_file(DDLNetworkRequest* request, bool keep);
+
+	/**
+	* Moves any requests whose retry delay has elapsed back into the pending queue.
+	*/
+	void schedule_due_retries();
+
+	/**
+	* Retrieves the time at which the queue next has work to do other than servicing its transfers, ie when the next
+	* retry becomes due or the rate limiter allows more requests.
+	*
+	* @returns The time of the next event, or `time_point::max()` if there is none.
+	*/
+	std::chrono::steady_clock::time_point get_next_event_time();
+
+	/**
+	* Waits for the next retry to become due, or for the rate limiter to allow more requests, when there are
+	* no transfers in flight.
+	*/
+	void wait_for_next_event();
+
+	/**
+	* Updates the queue depth metrics with this queue's current size. As several queues may be running at once, each
+	* queue adds the change since its last update rather than setting the metrics outright.
+	*/
+	void update_queue_metrics();
+
+public:
+	/**
+	* Creates a new request queue.
+	*
+	* @param _max_concurrent_requests - The maximum number of requests that may be in flight at once. Values
+	*     below 1 are treated as 1.
+	*/
+	DDLRequestQueue(int _max_concurrent_requests);
+
+	~DDLRequestQueue();
+
+	/**
+	* Adds a new request to the queue. The request will not be performed until #Run is called.
+	*
+	* @param url - The URL to send the request to.
+	* @param callback - Function to call once the request has finished. The request (and its response) is
+	*     only valid for the duration of the callback.
+	*/
+	void AddRequest(std::string url, std::function<void(DDLNetworkRequest*)> callback);
+
+	/**
+	* Adds a new download to the queue. The response is streamed into a partial file alongside the output path as it is
+	* received, and only renamed to the output path once the whole response has been received with http 200. If the
+	* request fails, the partial file is removed, so an existing file at the output path is never left half-written.
+	*
+	* @param url - The URL to download.
+	* @param output_path - The path to save the response to. Its directory must already exist.
+	* @param callback - Function to call once the request has finished. The file has been saved if the request's
+	*     http code is 200. The response text will be empty, unless the server responded with an error.
+	*/
+	void AddDownload(std::string url, std::string output_path, std::function<void(DDLNetworkRequest*)> callback);
+
+	/**
+	* Performs all queued requests, including any added by callbacks while running, and returns once the
+	* queue is empty.
+	*/
+	void Run();
+
+	/**
+	* Retrieves the number of requests that are either pending or in flight.
+	*
+	* @returns The number of unfinished requests in the queue.
+	*/
+	int GetUnfinishedRequestCount();
+};
 
 /**
 * Namespace containing functions for interacting with network-based services.
 */
 namespace DDL::Utils::Network
 {
+	/**
+	* Performs an HTTP request, retrying it according to the retry settings in website.cfg if it fails.
+	*
+	* @param url - The URL to send the request to.
+	* @param http_code - An optional pointer to an integer. This will be set to the final HTTP response code if specified.
+	*
+	* @returns A string containing the response text of the final attempt.
+	*/
 	std::string PerformHTTPRequestWithRetries(std::string url, int* http_code = nullptr);
 
+	/**
+	* Downloads a file straight to disk, retrying it according to the retry settings in website.cfg if it fails. The
+	* response is never held in memory, so this should be preferred for images and other uploads.
+	*
+	* @param url - The URL to download.
+	* @param output_path - The path to save the file to. Its directory must already exist.
+	* @param http_code - An optional pointer to an integer. This will be set to the final HTTP response code if specified.
+	*
+	* @returns `true` if the file was downloaded and saved, otherwise returns `false`.
+	*/
+	bool DownloadFileWithRetries(std::string url, std::string output_path, int* http_code = nullptr);
+
 	/**
 	* Performs an HTTP request and stores the output.
-	* 
+	*
 	* @param url - The URL to send the request to.
 	* @param http_code - An optional pointer to an integer. This will be set to the HTTP response code if specified.
-	* 
+	*
 	* @returns A string containing the response text. If the request failed for any reason, an empty string is returned.
 	*/
 	std::string PerformHTTPRequest(std::string url, int* http_code = nullptr);
 
 	std::string PerformHTTPRequest(std::string url, float backoff_factor, int max_retries, int* http_code);
-}
\ No newline at end of file
+
+	/**
+	* Applies the common request options (URL, user agent, etc) to a curl handle.
+	*
+	* @param request - The curl handle to configure.
+	* @param url - The URL to send the request to.
+	*/
+	void ApplyRequestOptions(curlpp::Easy* request, std::string url);
+
+	/**
+	* Retrieves the configured maximum number of concurrent requests.
+	*
+	* @returns The value of `max_concurrent_requests` from website.cfg, or 1 if the configuration is unavailable.
+	*/
+	int GetMaxConcurrentRequests();
+
+	/**
+	* Determines whether a failed request should be retried, based on the retry settings in website.cfg. The
+	* request's retry counters are updated accordingly.
+	*
+	* @param request - The request which failed.
+	* @param retry_delay - Pointer to an integer, which will be set to the number of seconds to wait before retrying.
+	*
+	* @returns `true` if the request should be retried, otherwise returns `false`.
+	*/
+	bool ShouldRetryRequest(DDLNetworkRequest* request, int* retry_delay);
+
+	/**
+	* Retrieves the rate limiter shared by all requests.
+	*
+	* @returns The global rate limiter.
+	*/
+	DDLRateLimiter* GetRateLimiter();
+
+	/**
+	* Reads the rate limit information from a response header line, such as `Retry-After`, and stores it
+	* on the request.
+	*
+	* @param request - The request that the header belongs to.
+	* @param header - The raw header line.
+	*/
+	void ParseRateLimitHeader(DDLNetworkRequest* request, std::string header);
+
+	/**
+	* Retrieves the curl share handle used by all requests. This allows DNS lookups and TLS sessions to be
+	* reused between handles, and is created on first use.
+	*
+	* @returns The shared curl cache handle.
+	*/
+	CURLSH* GetSharedCache();
+
+	/**
+	* Records whether a finished request reused an existing connection or had to open a new one.
+	*
+	* @param request - The curl handle of the finished request.
+	*/
+	void RecordConnectionUsage(curlpp::Easy* request);
+
+	/**
+	* Logs the number of requests which reused an existing connection, along with the number of new
+	* connections that were opened.
+	*/
+	void LogConnectionStatistics();
+
+	/**
+	* Answers every request with the given response source instead of the network. Must be set before any requests
+	* are made.
+	*
+	* @param source - The response source, or `nullptr` to use the network again.
+	*/
+	void SetResponseSource(DDLResponseSource source);
+
+	/**
+	* Retrieves the response source set with #SetResponseSource.
+	*
+	* @returns The response source, or `nullptr` if requests are sent over the network.
+	*/
+	DDLResponseSource* GetResponseSource();
+
+	/**
+	* Starts collecting the outcome and timing of every request attempt. Disabled by default, as the latency of every
+	* request is kept until the application exits.
+	*/
+	void EnableRequestStatistics();
+
+	/**
+	* Records the outcome of a finished request attempt, if request statistics are enabled.
+	*
+	* @param request - The request whose attempt has just finished.
+	*/
+	void RecordRequestStatistics(DDLNetworkRequest* request);
+
+	/**
+	* Retrieves the statistics collected since #EnableRequestStatistics was called.
+	*
+	* @returns A copy of the collected request statistics.
+	*/
+	DDLRequestStatistics GetRequestStatistics();
+
+	/**
+	* Retrieves the endpoint a request was sent to, for grouping requests in metrics. This is the first segment of the
+	* URL's path, so that topics (`/t/...`), users (`/u/...`) and so on are each grouped together no matter which topic or
+	* user was requested. Requests to any other host are grouped together as `external`.
+	*
+	* @param url - The URL of the request.
+	*
+	* @returns The endpoint, ie `/t`.
+	*/
+	std::string GetRequestEndpoint(std::string url);
+
+	/**
+	* Records the outcome of a finished request attempt in the metrics registry.
+	*
+	* @param request - The request whose attempt has just finished.
+	*/
+	void RecordRequestMetrics(DDLNetworkRequest* request);
+
+	/**
+	* Starts recording the final response of every request into a fixture archive. Must be called before any requests
+	* are made.
+	*
+	* @param path - The path to the archive. Any existing archive at this path is replaced.
+	*
+	* @returns `true` if recording has started, otherwise returns `false`.
+	*/
+	bool StartFixtureRecording(std::string path);
+
+	/**
+	* Answers every request from a fixture archive recorded with #StartFixtureRecording, rather than the network. The rate
+	* limiter is disabled and failed requests are not retried, as a recorded response never changes between attempts.
+	* Must be called before any requests are made.
+	*
+	* @param path - The path to the archive.
+	*
+	* @returns `true` if the archive was opened for replay, otherwise returns `false`.
+	*/
+	bool StartFixtureReplay(std::string path);
+
+	/**
+	* Checks whether requests are being answered from a fixture archive.
+	*
+	* @returns `true` if a fixture archive is being replayed, otherwise returns `false`.
+	*/
+	bool IsReplayingFixtures();
+
+	/**
+	* Records the final response of a request into the fixture archive, if recording has been started.
+	*
+	* @param request - The finished request.
+	*/
+	void RecordFixture(DDLNetworkRequest* request);
+
+	/**
+	* Releases the calling thread's request handles and the shared curl cache, and closes any fixture archive. Should
+	* only be called once all other network activity has finished.
+	*/
+	void Cleanup();
+}
@@ -150,6 +150,30 @@ bool DDL::Utils::String::MemoryStringCompare(char* address, char* to_compare, in
 	return false;
 }
 
+std::string DDL::Utils::String::EscapeHTML(std::string string)
+{
+	std::string escaped = "";
+	AppendEscapedHTML(&escaped, string);
+
+	return escaped;
+}
+
+void DDL::Utils::String::AppendEscapedHTML(std::string* output, std::string_view string)
+{
+	for (char character : string)
+	{
+		switch (character)
+		{
+			case '&': output->append("&amp;"); break;
+			case '<': output->append("&lt;"); break;
+			case '>': output->append("&gt;"); break;
+			case '"': output->append("&quot;"); break;
+			case '\'': output->append("&#39;"); break;
+			default: output->push_back(character); break;
+		}
+	}
+}
+
 std::string DDL::Utils::String::ConvertBoolToString(bool value)
 {
 	if (value)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
 /**
@@ -121,6 +122,24 @@ namespace DDL::Utils::String
 	*/
 	bool MemoryStringCompare(char* address, char* to_compare, int size);
 
+	/**
+	* Escapes the characters in a string which have special meaning in HTML, so that it can be safely inserted into
+	* a page as text or as an attribute value.
+	*
+	* @param string - The original string.
+	*
+	* @returns The escaped string.
+	*/
+	std::string EscapeHTML(std::string string);
+
+	/**
+	* Identical to EscapeHTML, but appends the escaped string to the end of an existing buffer.
+	*
+	* @param output - The buffer to append to.
+	* @param string - The original string.
+	*/
+	void AppendEscapedHTML(std::string* output, std::string_view string);
+
 	std::string ConvertBoolToString(bool value);
 
 	bool StringListContains(std::vector<std::string> list, std::string string);
@@ -0,0 +1,183 @@
+#include "threading.h"
+
+thread_local DDLWorkStealingPool* current_pool = nullptr;
+thread_local int current_worker_index = -1;
+
+DDLWorkStealingPool::DDLWorkStealingPool(int thread_count)
+{
+	if (thread_count < 1)
+	{
+		thread_count = std::thread::hardware_concurrency();
+	}
+
+	if (thread_count < 1)
+	{
+		thread_count = 1;
+	}
+
+	for (int i = 0; i < thread_count; i++)
+	{
+		queues.push_back(new DDLWorkerQueue());
+	}
+
+	for (int i = 0; i < thread_count; i++)
+	{
+		workers.push_back(std::thread(&DDLWorkStealingPool::worker_main, this, i));
+	}
+}
+
+DDLWorkStealingPool::~DDLWorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(wake_mutex);
+		running = false;
+	}
+
+	wake_condition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+
+	for (DDLWorkerQueue* queue : queues)
+	{
+		delete queue;
+	}
+
+	queues.clear();
+}
+
+void DDLWorkStealingPool::Submit(std::function<void()> task)
+{
+	int queue_index = 0;
+
+	if (current_pool == this)
+	{
+		queue_index = current_worker_index;
+	}
+	else
+	{
+		queue_index = next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+	}
+
+	unfinished_tasks.fetch_add(1, std::memory_order_acq_rel);
+
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(queues[queue_index]->queue_mutex);
+		queues[queue_index]->tasks.push_back(task);
+	}
+
+	// Taking the wake mutex here ensures a worker can't miss this task between checking the queues and going to sleep
+	{
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(wake_mutex);
+	}
+
+	wake_condition.notify_one();
+}
+
+void DDLWorkStealingPool::Wait()
+{
+	std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(wake_mutex);
+
+	idle_condition.wait(lock, [this]()
+	{
+		return unfinished_tasks.load(std::memory_order_acquire) == 0;
+	});
+}
+
+int DDLWorkStealingPool::GetThreadCount()
+{
+	return workers.size();
+}
+
+bool DDLWorkStealingPool::try_pop(int worker_index, std::function<void()>* task)
+{
+	DDLWorkerQueue* queue = queues[worker_index];
+	std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(queue->queue_mutex);
+
+	if (queue->tasks.size() == 0)
+	{
+		return false;
+	}
+
+	*task = std::move(queue->tasks.back());
+	queue->tasks.pop_back();
+
+	return true;
+}
+
+bool DDLWorkStealingPool::try_steal(int worker_index, std::function<void()>* task)
+{
+	for (int i = 1; i < queues.size(); i++)
+	{
+		DDLWorkerQueue* queue = queues[(worker_index + i) % queues.size()];
+		std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(queue->queue_mutex);
+
+		if (queue->tasks.size() > 0)
+		{
+			*task = std::move(queue->tasks.front());
+			queue->tasks.pop_front();
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void DDLWorkStealingPool::worker_main(int worker_index)
+{
+	current_pool = this;
+	current_worker_index = worker_index;
+
+	std::function<void()> task = nullptr;
+
+	while (true)
+	{
+		if (try_pop(worker_index, &task) || try_steal(worker_index, &task))
+		{
+			task();
+			task = nullptr;
+
+			if (unfinished_tasks.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				std::lock_guard<std::mutex> lock = std::lock_guard<std::mutex>(wake_mutex);
+				idle_condition.notify_all();
+			}
+
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock = std::unique_lock<std::mutex>(wake_mutex);
+
+		if (!running)
+		{
+			break;
+		}
+
+		// Check the queues again while holding the wake mutex, in case a task was submitted after they were last checked
+		wake_condition.wait(lock, [this, worker_index]()
+		{
+			if (!running)
+			{
+				return true;
+			}
+
+			for (DDLWorkerQueue* queue : queues)
+			{
+				std::lock_guard<std::mutex> queue_lock = std::lock_guard<std::mutex>(queue->queue_mutex);
+
+				if (queue->tasks.size() > 0)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		});
+	}
+
+	current_pool = nullptr;
+	current_worker_index = -1;
+}
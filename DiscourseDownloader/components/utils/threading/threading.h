@@ -0,0 +1,89 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+* Structure containing the task queue owned by a single worker thread.
+*/
+struct DDLWorkerQueue
+{
+	std::mutex queue_mutex; //!< Mutex protecting #tasks.
+	std::deque<std::function<void()>> tasks = std::deque<std::function<void()>>(); //!< Tasks waiting to be run.
+};
+
+/**
+* Class representing a pool of worker threads which share work by stealing.
+*
+* Every worker owns a queue. Tasks submitted from outside the pool are spread across the queues, while tasks
+* submitted from within a running task go to the current worker's own queue. Workers take their newest task first,
+* which keeps related work together, and once their own queue is empty they steal the oldest task from another
+* worker. This keeps every core busy even when tasks vary wildly in size, such as topics with 1 post versus 10,000.
+*/
+class DDLWorkStealingPool
+{
+private:
+	std::vector<std::thread> workers = std::vector<std::thread>(); //!< The worker threads.
+	std::vector<DDLWorkerQueue*> queues = std::vector<DDLWorkerQueue*>(); //!< The task queue of each worker.
+
+	std::atomic<bool> running = true; //!< Whether or not the workers should keep running.
+	std::atomic<int> unfinished_tasks = 0; //!< The number of tasks which have been submitted but not yet finished.
+	std::atomic<unsigned int> next_queue = 0; //!< The queue that the next task from outside the pool is added to.
+
+	std::mutex wake_mutex; //!< Mutex used to wait on #wake_condition and #idle_condition.
+	std::condition_variable wake_condition; //!< Used to wake idle workers when tasks are submitted.
+	std::condition_variable idle_condition; //!< Used to wake #Wait once every task has finished.
+
+	/**
+	* Takes the newest task from a worker's own queue.
+	*/
+	bool try_pop(int worker_index, std::function<void()>* task);
+
+	/**
+	* Takes the oldest task from any other worker's queue.
+	*/
+	bool try_steal(int worker_index, std::function<void()>* task);
+
+	/**
+	* Runs tasks until the pool is destroyed. Runs on each worker thread.
+	*/
+	void worker_main(int worker_index);
+
+public:
+	/**
+	* Creates a new pool and starts its worker threads.
+	*
+	* @param thread_count - The number of worker threads. If less than 1, one thread per hardware thread is used.
+	*/
+	DDLWorkStealingPool(int thread_count);
+
+	/**
+	* Stops the worker threads. Any tasks which have not yet started are discarded, so #Wait should be called first.
+	*/
+	~DDLWorkStealingPool();
+
+	/**
+	* Adds a task to the pool. Safe to call from any thread, including from within another task.
+	*
+	* @param task - The task to run.
+	*/
+	void Submit(std::function<void()> task);
+
+	/**
+	* Blocks until every submitted task, including any tasks those tasks submitted, has finished. Must not be called
+	* from within a task.
+	*/
+	void Wait();
+
+	/**
+	* Retrieves the number of worker threads in the pool.
+	*
+	* @returns The number of worker threads.
+	*/
+	int GetThreadCount();
+};
@@ -5,9 +5,15 @@
 
 #include "components/settings/settings.h"
 #include "components/diagnostics/logger/logger.h"
+#include "components/diagnostics/metrics/metrics.h"
+#include "components/diagnostics/trace/trace.h"
 #include "components/utils/network/network.h"
 #include "components/utils/io/io.h"
+#include "components/utils/string/string.h"
 #include "components/discourse/discourse.h"
+#include "components/discourse/storage/storage.h"
+#include "components/discourse/search/search.h"
+#include "components/discourse/benchmark/benchmark.h"
 #include "components/settings/switches/switches.h"
 
 int main(int args_count, char* args[])
@@ -66,6 +72,9 @@ int main(int args_count, char* args[])
 		return -1;
 	}
 
+	DDL::Logger::SetMinimumLogLevel(DDL::Logger::Utils::ParseLogLevel(config->log_level));
+	DDL::Logger::SetHistoryLimit(config->log_history_limit);
+
 	if (config->log_level_debug)
 	{
 		DDL::Logger::LogEvent("log level debug :: info", DDLLogLevel::Info);
@@ -73,9 +82,119 @@ int main(int args_count, char* args[])
 		DDL::Logger::LogEvent("log level debug :: error", DDLLogLevel::Error);
 	}
 
+	// Unpack the archive store back into the regular directory layout, without downloading anything
+	if (DDL::Settings::Switches::IsSwitchPresent("export_archive"))
+	{
+		std::string export_path = DDL::Settings::Switches::GetSwitchValue("export_archive");
+
+		if (export_path == "")
+		{
+			export_path = config->json_path;
+		}
+
+		DDLResult export_result = DDL::Discourse::Storage::ExportArchive(export_path);
+
+		DDL::Discourse::Storage::Cleanup();
+		DDL::Utils::Network::Cleanup();
+		DDL::Settings::CleanupConfigurations();
+		DDL::Logger::ShutdownLogger();
+		return DR_FAILED(export_result) ? -1 : 0;
+	}
+
+	// Search an index built by a previous run, without downloading anything. Switch values can't contain spaces, so
+	// search terms are separated with commas instead (ie, `-search halo,reach`)
+	if (DDL::Settings::Switches::IsSwitchPresent("search"))
+	{
+		std::string query = DDL::Utils::String::Replace(DDL::Settings::Switches::GetSwitchValue("search"), ",", " ");
+
+		std::vector<DDLSearchResult> results = std::vector<DDLSearchResult>();
+		bool search_result = DDL::Discourse::Search::Search(query, SEARCH_DEFAULT_RESULT_COUNT, &results);
+
+		if (search_result)
+		{
+			DDL::Logger::LogEvent(std::to_string(results.size()) + " results for '" + query + "':");
+
+			for (int i = 0; i < results.size(); i++)
+			{
+				char score[16] = { 0 };
+				sprintf_s(score, sizeof(score), "%.2f", results[i].score);
+
+				DDL::Logger::LogEvent(std::to_string(i + 1) + ". [" + score + "] " + results[i].title + " - "
+					+ DDL::Discourse::Search::GetResultPagePath(&results[i]));
+			}
+		}
+
+		DDL::Discourse::Storage::Cleanup();
+		DDL::Utils::Network::Cleanup();
+		DDL::Settings::CleanupConfigurations();
+		DDL::Logger::ShutdownLogger();
+		return search_result ? 0 : -1;
+	}
+
+	// Record every response of this run into a fixture archive, or answer every request from one recorded earlier. Replaying
+	// should use the same website.cfg as the recording, as any request which wasn't recorded will fail
+	{
+		std::string fixture_switch = DDL::Settings::Switches::IsSwitchPresent("replay_fixtures") ? "replay_fixtures" : "record_fixtures";
+
+		if (DDL::Settings::Switches::IsSwitchPresent(fixture_switch))
+		{
+			std::string fixture_path = DDL::Settings::Switches::GetSwitchValue(fixture_switch);
+
+			if (fixture_path == "")
+			{
+				fixture_path = FIXTURE_ARCHIVE_DEFAULT_FILENAME;
+			}
+
+			bool fixture_result = (fixture_switch == "replay_fixtures") ? DDL::Utils::Network::StartFixtureReplay(fixture_path)
+				: DDL::Utils::Network::StartFixtureRecording(fixture_path);
+
+			if (!fixture_result)
+			{
+				DDL::Logger::LogEvent("could not start fixture " + std::string(fixture_switch == "replay_fixtures" ? "replay" : "recording")
+					+ ", program will exit", DDLLogLevel::Error);
+
+				DDL::Utils::Network::Cleanup();
+				DDL::Settings::CleanupConfigurations();
+				DDL::Logger::ShutdownLogger();
+				return -1;
+			}
+		}
+	}
+
+	// Record where time is spent over the whole run, to be opened in Perfetto or chrome://tracing once finished
+	if (DDL::Settings::Switches::IsSwitchPresent("trace"))
+	{
+		std::string trace_path = DDL::Settings::Switches::GetSwitchValue("trace");
+
+		if (trace_path == "")
+		{
+			trace_path = TRACE_DEFAULT_FILENAME;
+		}
+
+		DDL::Trace::StartTrace(trace_path);
+	}
+
+	DDL::Metrics::StartMetricsExport();
+
+	// Download a synthetic forum to measure the download pipeline, without sending any requests to a real forum
+	if (DDL::Settings::Switches::IsSwitchPresent("benchmark"))
+	{
+		DDLResult benchmark_result = DDL::Discourse::Benchmark::RunBenchmark();
+
+		DDL::Metrics::StopMetricsExport();
+		DDL::Trace::StopTrace();
+		DDL::Discourse::Storage::Cleanup();
+		DDL::Utils::Network::Cleanup();
+		DDL::Settings::CleanupConfigurations();
+		DDL::Logger::ShutdownLogger();
+		return DR_FAILED(benchmark_result) ? -1 : 0;
+	}
+
 	if (!config->skip_download)
 	{
+		std::chrono::steady_clock::time_point phase_start = DDL::Metrics::StartPhase("download");
 		DDL::Discourse::DownloadWebContent();
+		DDL::Metrics::FinishPhase("download", phase_start);
 	}
 	else
 	{
@@ -84,13 +203,22 @@ int main(int args_count, char* args[])
 
 	if (config->perform_html_build)
 	{
+		std::chrono::steady_clock::time_point phase_start = DDL::Metrics::StartPhase("html_build");
 		DDL::Discourse::BuildArchiveWebsite();
+		DDL::Metrics::FinishPhase("html_build", phase_start);
 	}
 	else
 	{
 		DDL::Logger::LogEvent("skipping html build step based on configuration");
 	}
 
+	if (config->build_search_index)
+	{
+		std::chrono::steady_clock::time_point phase_start = DDL::Metrics::StartPhase("search_index");
+		DDL::Discourse::Search::BuildSearchIndex();
+		DDL::Metrics::FinishPhase("search_index", phase_start);
+	}
+
 	DDL::Logger::LogEvent("######################### DOWNLOAD COMPLETE #########################");
 
 	if (!config->disable_long_finish_message)
@@ -125,6 +253,11 @@ int main(int args_count, char* args[])
 
 	// Shutdown
 	{
+		DDL::Metrics::StopMetricsExport();
+		DDL::Trace::StopTrace();
+		DDL::Discourse::Downloader::FlushResumeJournal();
+		DDL::Discourse::Storage::Cleanup();
+		DDL::Utils::Network::Cleanup();
 		DDL::Settings::CleanupConfigurations();
 		DDL::Logger::ShutdownLogger();
 	}